@@ -16,6 +16,8 @@
 #include "abcgApplication.hpp"
 #include "abcgException.hpp"
 #include "abcgExternal.hpp"
+#include "abcgProfiler.hpp"
+#include "abcgTrace.hpp"
 #include "abcgTrackball.hpp"
 #include "abcgUtil.hpp"
 #include "abcgWindow.hpp"
@@ -110,6 +110,30 @@ void abcg::Application::run(Window &window) {
   SDL_Quit();
 }
 
+/**
+ * @brief Runs the application without a window.
+ *
+ * Initializes only the SDL core library, with no video, audio or input
+ * subsystems, no SDL_image and no Dear ImGui, and then calls @a step
+ * repeatedly, as fast as possible, until it returns false. This is meant for
+ * simulations that run on machines without a display server.
+ *
+ * @param step Function to be called at each iteration of the loop. The loop
+ * ends when it returns false.
+ *
+ * @throw abcg::SDLError if `SDL_Init` failed.
+ */
+void abcg::Application::runHeadless(std::function<bool()> const &step) {
+  if (SDL_Init(0) != 0) {
+    throw abcg::SDLError("SDL_Init failed");
+  }
+
+  while (step()) {
+  }
+
+  SDL_Quit();
+}
+
 /**
  * @brief Returns the path to the application's assets directory, relative to
  * the directory the executable is launched from.
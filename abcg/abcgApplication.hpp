@@ -11,6 +11,7 @@
 #ifndef ABCG_APPLICATION_HPP_
 #define ABCG_APPLICATION_HPP_
 
+#include <functional>
 #include <string>
 
 #define ABCG_VERSION_MAJOR 3
@@ -32,13 +33,16 @@ void mainLoopCallback(void *userData);
  * @brief Manages the application's control flow.
  *
  * This is the class that starts an ABCg application, initializes the SDL
- * modules and enters the main event loop.
+ * modules and enters the main event loop. Applications that do not need a
+ * window (e.g., batch simulations) can use abcg::Application::runHeadless
+ * instead.
  */
 class abcg::Application {
 public:
   Application(int argc, char **argv);
 
   void run(Window &window);
+  void runHeadless(std::function<bool()> const &step);
 
   static std::string const &getAssetsPath() noexcept;
   static std::string const &getBasePath() noexcept;
@@ -10,11 +10,184 @@
 
 #include "abcgImage.hpp"
 
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <vector>
+
 #include <cppitertools/itertools.hpp>
 #include <gsl/gsl>
 
-#include <span>
-#include <vector>
+// Hand-written kernels with runtime CPU dispatch. Other platforms (and the
+// pixel sizes without a kernel) use the portable loops, which compilers
+// vectorize for 4 bytes per pixel.
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__)) &&       \
+    !defined(__EMSCRIPTEN__)
+#define ABCG_IMAGE_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+namespace {
+using RowFunction = void (*)(std::byte *row, std::size_t width);
+
+// Minimum number of rows per thread, so that small images are not split
+constexpr std::size_t minRowsPerThread{64};
+
+// Portable in-place reversal of a row of pixels of N bytes
+template <std::size_t N>
+void reverseRowPortable(std::byte *row, std::size_t width) {
+  if (width < 2)
+    return;
+  auto *left{row};
+  auto *right{row + (width - 1) * N};
+  while (left < right) {
+    if constexpr (N == 4) {
+      std::uint32_t a{};
+      std::uint32_t b{};
+      std::memcpy(&a, left, N);
+      std::memcpy(&b, right, N);
+      std::memcpy(left, &b, N);
+      std::memcpy(right, &a, N);
+    } else {
+      std::swap_ranges(left, left + N, right);
+    }
+    left += N;
+    right -= N;
+  }
+}
+
+void reverseRowGeneric(std::byte *row, std::size_t width,
+                       std::size_t bytesPerPixel) {
+  if (width < 2)
+    return;
+  auto *left{row};
+  auto *right{row + (width - 1) * bytesPerPixel};
+  while (left < right) {
+    std::swap_ranges(left, left + bytesPerPixel, right);
+    left += bytesPerPixel;
+    right -= bytesPerPixel;
+  }
+}
+
+#if defined(ABCG_IMAGE_X86_KERNELS)
+// 3 bytes per pixel: reverses 4 pixels (12 bytes) from each end of the row per
+// iteration with one pshufb each. The 16-byte loads of the right end are
+// aligned to the end of the row so they never read past it.
+__attribute__((target("ssse3"))) void reverseRow3SSSE3(std::byte *row,
+                                                       std::size_t width) {
+  auto const maskLeft{
+      _mm_setr_epi8(9, 10, 11, 6, 7, 8, 3, 4, 5, 0, 1, 2, -1, -1, -1, -1)};
+  auto const maskRight{
+      _mm_setr_epi8(13, 14, 15, 10, 11, 12, 7, 8, 9, 4, 5, 6, -1, -1, -1, -1)};
+
+  auto const store12{[](std::byte *destination, __m128i value) {
+    _mm_storel_epi64(reinterpret_cast<__m128i *>(destination), value);
+    auto const tail{_mm_cvtsi128_si32(_mm_srli_si128(value, 8))};
+    std::memcpy(destination + 8, &tail, 4);
+  }};
+
+  std::size_t left{};
+  std::size_t right{width};
+  while (right - left >= 8) {
+    auto *const leftBytes{row + left * 3};
+    auto *const rightBytes{row + right * 3};
+    auto const leftPixels{
+        _mm_loadu_si128(reinterpret_cast<__m128i const *>(leftBytes))};
+    auto const rightPixels{
+        _mm_loadu_si128(reinterpret_cast<__m128i const *>(rightBytes - 16))};
+    store12(leftBytes, _mm_shuffle_epi8(rightPixels, maskRight));
+    store12(rightBytes - 12, _mm_shuffle_epi8(leftPixels, maskLeft));
+    left += 4;
+    right -= 4;
+  }
+  reverseRowPortable<3>(row + left * 3, right - left);
+}
+
+// 4 bytes per pixel, SSE2 (always available on x86-64): 4 pixels per side
+void reverseRow4SSE2(std::byte *row, std::size_t width) {
+  std::size_t left{};
+  std::size_t right{width};
+  while (right - left >= 8) {
+    auto *const leftBytes{reinterpret_cast<__m128i *>(row + left * 4)};
+    auto *const rightBytes{reinterpret_cast<__m128i *>(row + right * 4 - 16)};
+    auto const leftPixels{_mm_loadu_si128(leftBytes)};
+    auto const rightPixels{_mm_loadu_si128(rightBytes)};
+    _mm_storeu_si128(leftBytes, _mm_shuffle_epi32(rightPixels, 0x1B));
+    _mm_storeu_si128(rightBytes, _mm_shuffle_epi32(leftPixels, 0x1B));
+    left += 4;
+    right -= 4;
+  }
+  reverseRowPortable<4>(row + left * 4, right - left);
+}
+
+// 4 bytes per pixel, AVX2: 8 pixels per side
+__attribute__((target("avx2"))) void reverseRow4AVX2(std::byte *row,
+                                                     std::size_t width) {
+  auto const reverse{_mm256_setr_epi32(7, 6, 5, 4, 3, 2, 1, 0)};
+  std::size_t left{};
+  std::size_t right{width};
+  while (right - left >= 16) {
+    auto *const leftBytes{reinterpret_cast<__m256i *>(row + left * 4)};
+    auto *const rightBytes{reinterpret_cast<__m256i *>(row + right * 4 - 32)};
+    auto const leftPixels{_mm256_loadu_si256(leftBytes)};
+    auto const rightPixels{_mm256_loadu_si256(rightBytes)};
+    _mm256_storeu_si256(leftBytes,
+                        _mm256_permutevar8x32_epi32(rightPixels, reverse));
+    _mm256_storeu_si256(rightBytes,
+                        _mm256_permutevar8x32_epi32(leftPixels, reverse));
+    left += 8;
+    right -= 8;
+  }
+  reverseRow4SSE2(row + left * 4, right - left);
+}
+#endif
+
+// Returns the best row reversal kernel for the pixel size, or nullptr if there
+// is none
+RowFunction selectRowFunction(int bytesPerPixel) {
+#if defined(ABCG_IMAGE_X86_KERNELS)
+  static bool const hasSSSE3{__builtin_cpu_supports("ssse3") != 0};
+  static bool const hasAVX2{__builtin_cpu_supports("avx2") != 0};
+  if (bytesPerPixel == 3) {
+    return hasSSSE3 ? reverseRow3SSSE3 : reverseRowPortable<3>;
+  }
+  if (bytesPerPixel == 4) {
+    return hasAVX2 ? reverseRow4AVX2 : reverseRow4SSE2;
+  }
+#else
+  if (bytesPerPixel == 3) {
+    return reverseRowPortable<3>;
+  }
+  if (bytesPerPixel == 4) {
+    return reverseRowPortable<4>;
+  }
+#endif
+  return nullptr;
+}
+
+// Calls function(first, last) on ranges of [0, count) split among up to
+// threadCount threads, including the calling thread
+template <typename Function>
+void parallelFor(std::size_t count, unsigned int threadCount,
+                 Function const &function) {
+  auto const chunks{std::clamp<std::size_t>(count / minRowsPerThread, 1,
+                                            std::max(threadCount, 1U))};
+  if (chunks == 1) {
+    function(std::size_t{}, count);
+    return;
+  }
+
+  std::vector<std::jthread> threads;
+  threads.reserve(chunks - 1);
+  for (auto const chunk : iter::range(std::size_t{1}, chunks)) {
+    threads.emplace_back([&function, count, chunk, chunks] {
+      function(count * chunk / chunks, count * (chunk + 1) / chunks);
+    });
+  }
+  function(std::size_t{}, count / chunks);
+}
+} // namespace
 
 /**
  * @brief Flips an image horizontally.
@@ -22,37 +195,15 @@
  * Reverses each row of the image, in place.
  *
  * @param surface SDL surface of a RGB or RGBA image.
+ * @param threadCount Maximum number of threads to use, including the calling
+ * thread.
  */
-void abcg::flipHorizontally(SDL_Surface &surface) {
-  auto const bytesPerPixel{gsl::narrow<int>(surface.format->BytesPerPixel)};
-  auto const widthInBytes{gsl::narrow<std::size_t>(surface.w * bytesPerPixel)};
-  auto const height{gsl::narrow<std::size_t>(surface.h)};
-  std::span const pixels{static_cast<std::byte *>(surface.pixels),
-                         widthInBytes * height};
-
-  // Temporary row of pixels for the swap
-  std::vector<std::byte> pixelRow(gsl::narrow<std::size_t>(widthInBytes), {});
-
+void abcg::flipHorizontally(SDL_Surface &surface, unsigned int threadCount) {
   SDL_LockSurface(&surface);
-
-  // For each row
-  for (auto const rowIndex : iter::range(height)) {
-    auto const rowStart{widthInBytes * rowIndex};
-    auto const rowEnd{rowStart + widthInBytes};
-    // For each pixel (RGB/RGA) of current row
-    auto srcBegin{pixels.begin() + gsl::narrow<long>(rowEnd)};
-    auto dstBegin{pixelRow.begin()};
-    for ([[maybe_unused]] auto const pixelIndex : iter::range(surface.w)) {
-      srcBegin -= bytesPerPixel;
-      std::copy(srcBegin, srcBegin + bytesPerPixel, dstBegin);
-      dstBegin += bytesPerPixel;
-    }
-    // std::ranges::copy(pixelRow, pixels.subspan(rowStart).begin());
-    std::copy(pixelRow.begin(),
-              pixelRow.begin() + gsl::narrow<long>(widthInBytes),
-              pixels.subspan(rowStart).begin());
-  }
-
+  std::span const pixels{static_cast<std::byte *>(surface.pixels),
+                         gsl::narrow<std::size_t>(surface.pitch * surface.h)};
+  flipHorizontally(pixels, surface.w, surface.h, surface.pitch,
+                   surface.format->BytesPerPixel, threadCount);
   SDL_UnlockSurface(&surface);
 }
 
@@ -62,41 +213,83 @@ void abcg::flipHorizontally(SDL_Surface &surface) {
  * Reverses each column of the image, in place.
  *
  * @param surface SDL surface of a RGB or RGBA image.
+ * @param threadCount Maximum number of threads to use, including the calling
+ * thread.
  */
-void abcg::flipVertically(SDL_Surface &surface) {
-  auto const bytesPerPixel{gsl::narrow<int>(surface.format->BytesPerPixel)};
-  auto const widthInBytes{gsl::narrow<std::size_t>(surface.w * bytesPerPixel)};
-  auto const height{gsl::narrow<std::size_t>(surface.h)};
+void abcg::flipVertically(SDL_Surface &surface, unsigned int threadCount) {
+  SDL_LockSurface(&surface);
   std::span const pixels{static_cast<std::byte *>(surface.pixels),
-                         gsl::narrow<std::size_t>(widthInBytes * height)};
+                         gsl::narrow<std::size_t>(surface.pitch * surface.h)};
+  flipVertically(pixels, surface.w, surface.h, surface.pitch,
+                 surface.format->BytesPerPixel, threadCount);
+  SDL_UnlockSurface(&surface);
+}
 
-  // Temporary row of pixels for the swap
-  std::vector<std::byte> pixelRow(widthInBytes, std::byte{});
+/**
+ * @brief Flips an image horizontally.
+ *
+ * Reverses each row of the image, in place. Rows of 3 and 4 bytes per pixel
+ * are reversed with SIMD shuffles where available (SSSE3, SSE2 or AVX2 on
+ * x86-64, selected at runtime).
+ *
+ * @param pixels Pixel data, with at least `pitch * height` bytes.
+ * @param width Image width, in pixels.
+ * @param height Image height, in pixels.
+ * @param pitch Distance between the start of consecutive rows, in bytes.
+ * @param bytesPerPixel Number of bytes per pixel.
+ * @param threadCount Maximum number of threads to use, including the calling
+ * thread.
+ */
+void abcg::flipHorizontally(std::span<std::byte> pixels, int width, int height,
+                            int pitch, int bytesPerPixel,
+                            unsigned int threadCount) {
+  auto const rowWidth{gsl::narrow<std::size_t>(width)};
+  auto const rowPitch{gsl::narrow<std::size_t>(pitch)};
+  auto const pixelSize{gsl::narrow<std::size_t>(bytesPerPixel)};
+  auto *const data{pixels.data()};
+  auto const reverseRow{selectRowFunction(bytesPerPixel)};
 
-  SDL_LockSurface(&surface);
+  parallelFor(gsl::narrow<std::size_t>(height), threadCount,
+              [=](std::size_t first, std::size_t last) {
+                for (auto const rowIndex : iter::range(first, last)) {
+                  auto *const row{data + rowIndex * rowPitch};
+                  if (reverseRow != nullptr) {
+                    reverseRow(row, rowWidth);
+                  } else {
+                    reverseRowGeneric(row, rowWidth, pixelSize);
+                  }
+                }
+              });
+}
 
-  // If height is odd, won't swap the middle row
-  for (auto const halfHeight{height / 2};
-       auto const rowIndex : iter::range(halfHeight)) {
-    auto const rowStartFromTop{widthInBytes * rowIndex};
-    auto const rowStartFromBottom{widthInBytes * (height - rowIndex - 1)};
-
-    auto const &topSpan{pixels.subspan(rowStartFromTop)};
-    auto const &bottomSpan{pixels.subspan(rowStartFromBottom)};
-
-    // std::ranges::copy(topSpan.subspan(0, widthInBytes), pixelRow.begin());
-    // std::ranges::copy(bottomSpan.subspan(0, widthInBytes), topSpan.begin());
-    // std::ranges::copy(pixelRow, bottomSpan.begin());
-    std::copy(topSpan.begin(),
-              topSpan.begin() + gsl::narrow<long>(widthInBytes),
-              pixelRow.begin());
-    std::copy(bottomSpan.begin(),
-              bottomSpan.begin() + gsl::narrow<long>(widthInBytes),
-              topSpan.begin());
-    std::copy(pixelRow.begin(),
-              pixelRow.begin() + gsl::narrow<long>(widthInBytes),
-              bottomSpan.begin());
-  }
+/**
+ * @brief Flips an image vertically.
+ *
+ * Reverses each column of the image, in place, by swapping rows without a
+ * temporary buffer.
+ *
+ * @param pixels Pixel data, with at least `pitch * height` bytes.
+ * @param width Image width, in pixels.
+ * @param height Image height, in pixels.
+ * @param pitch Distance between the start of consecutive rows, in bytes.
+ * @param bytesPerPixel Number of bytes per pixel.
+ * @param threadCount Maximum number of threads to use, including the calling
+ * thread.
+ */
+void abcg::flipVertically(std::span<std::byte> pixels, int width, int height,
+                          int pitch, int bytesPerPixel,
+                          unsigned int threadCount) {
+  auto const widthInBytes{gsl::narrow<std::size_t>(width * bytesPerPixel)};
+  auto const rowPitch{gsl::narrow<std::size_t>(pitch)};
+  auto const rows{gsl::narrow<std::size_t>(height)};
+  auto *const data{pixels.data()};
 
-  SDL_UnlockSurface(&surface);
-}
\ No newline at end of file
+  // If height is odd, won't swap the middle row
+  parallelFor(rows / 2, threadCount, [=](std::size_t first, std::size_t last) {
+    for (auto const rowIndex : iter::range(first, last)) {
+      auto *const top{data + rowIndex * rowPitch};
+      auto *const bottom{data + (rows - rowIndex - 1) * rowPitch};
+      std::swap_ranges(top, top + widthInBytes, bottom);
+    }
+  });
+}
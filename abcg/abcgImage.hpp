@@ -11,11 +11,19 @@
 #ifndef ABCG_IMAGE_HPP_
 #define ABCG_IMAGE_HPP_
 
+#include <cstddef>
+#include <span>
+
 #include <SDL_image.h>
 
 namespace abcg {
-void flipHorizontally(SDL_Surface &surface);
-void flipVertically(SDL_Surface &surface);
+void flipHorizontally(SDL_Surface &surface, unsigned int threadCount = 1);
+void flipVertically(SDL_Surface &surface, unsigned int threadCount = 1);
+void flipHorizontally(std::span<std::byte> pixels, int width, int height,
+                      int pitch, int bytesPerPixel,
+                      unsigned int threadCount = 1);
+void flipVertically(std::span<std::byte> pixels, int width, int height,
+                    int pitch, int bytesPerPixel, unsigned int threadCount = 1);
 } // namespace abcg
 
 #endif
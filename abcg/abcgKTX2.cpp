@@ -0,0 +1,462 @@
+/**
+ * @file abcgKTX2.cpp
+ * @brief Definition of abcg::KTX2Texture members.
+ *
+ * This file is part of ABCg (https://github.com/hbatagelo/abcg).
+ *
+ * @copyright (c) 2021--2023 Harlen Batagelo. All rights reserved.
+ * This project is released under the MIT License.
+ */
+
+#include "abcgKTX2.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cstring>
+#include <string>
+
+#include <cppitertools/itertools.hpp>
+#include <fmt/core.h>
+#include <gsl/gsl>
+
+#include "abcgException.hpp"
+#include "abcgTrace.hpp"
+
+namespace {
+constexpr std::array<unsigned char, 12> identifier{
+    0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A};
+
+// Sizes of the header (identifier, 9 uint32 fields and the index of the data
+// format descriptor, key/value data and supercompression global data) and of
+// each entry of the level index
+constexpr std::size_t headerSize{80};
+constexpr std::size_t levelIndexEntrySize{24};
+
+// Offsets into the header
+constexpr std::size_t vkFormatOffset{12};
+constexpr std::size_t pixelWidthOffset{20};
+constexpr std::size_t pixelHeightOffset{24};
+constexpr std::size_t pixelDepthOffset{28};
+constexpr std::size_t layerCountOffset{32};
+constexpr std::size_t faceCountOffset{36};
+constexpr std::size_t levelCountOffset{40};
+constexpr std::size_t supercompressionOffset{44};
+constexpr std::size_t kvdByteOffsetOffset{56};
+constexpr std::size_t kvdByteLengthOffset{60};
+
+// VkFormat values of the ranges of compressed formats
+constexpr std::uint32_t formatBC1First{131};  // BC1_RGB_UNORM_BLOCK
+constexpr std::uint32_t formatBC7Last{146};   // BC7_SRGB_BLOCK
+constexpr std::uint32_t formatETC2First{147}; // ETC2_R8G8B8_UNORM_BLOCK
+constexpr std::uint32_t formatEACLast{156};   // EAC_R11G11_SNORM_BLOCK
+constexpr std::uint32_t formatASTCFirst{157}; // ASTC_4x4_UNORM_BLOCK
+constexpr std::uint32_t formatASTCLast{184};  // ASTC_12x12_SRGB_BLOCK
+
+// Block dimensions of the ASTC formats, in the order of their VkFormat values
+constexpr std::array<std::array<std::uint32_t, 2>, 14> astcBlocks{
+    {{4, 4},
+     {5, 4},
+     {5, 5},
+     {6, 5},
+     {6, 6},
+     {8, 5},
+     {8, 6},
+     {8, 8},
+     {10, 5},
+     {10, 6},
+     {10, 8},
+     {10, 10},
+     {12, 10},
+     {12, 12}}};
+
+struct UncompressedFormat {
+  std::uint32_t vkFormat{};
+  std::uint32_t bytesPerTexel{};
+  bool sRGB{};
+};
+
+constexpr std::array uncompressedFormats{
+    UncompressedFormat{9, 1, false},   // VK_FORMAT_R8_UNORM
+    UncompressedFormat{15, 1, true},   // VK_FORMAT_R8_SRGB
+    UncompressedFormat{16, 2, false},  // VK_FORMAT_R8G8_UNORM
+    UncompressedFormat{22, 2, true},   // VK_FORMAT_R8G8_SRGB
+    UncompressedFormat{23, 3, false},  // VK_FORMAT_R8G8B8_UNORM
+    UncompressedFormat{29, 3, true},   // VK_FORMAT_R8G8B8_SRGB
+    UncompressedFormat{37, 4, false},  // VK_FORMAT_R8G8B8A8_UNORM
+    UncompressedFormat{43, 4, true},   // VK_FORMAT_R8G8B8A8_SRGB
+    UncompressedFormat{97, 8, false},  // VK_FORMAT_R16G16B16A16_SFLOAT
+    UncompressedFormat{109, 16, false} // VK_FORMAT_R32G32B32A32_SFLOAT
+};
+
+// KTX2 files are little-endian, as are all platforms supported by ABCg
+template <typename T>
+T read(std::span<std::byte const> data, std::size_t offset) {
+  T value{};
+  std::memcpy(&value, data.subspan(offset, sizeof(T)).data(), sizeof(T));
+  return value;
+}
+
+// Returns the value of a key of the key/value data, or an empty string if the
+// key is not found
+std::string findValue(std::span<std::byte const> keyValueData,
+                      std::string_view key) {
+  std::size_t offset{};
+  while (offset + sizeof(std::uint32_t) <= keyValueData.size()) {
+    auto const length{read<std::uint32_t>(keyValueData, offset)};
+    offset += sizeof(std::uint32_t);
+    if (length > keyValueData.size() - offset)
+      break;
+
+    std::string_view const pair{
+        reinterpret_cast<char const *>(keyValueData.data() + offset), length};
+    if (auto const separator{pair.find('\0')};
+        separator != std::string_view::npos &&
+        pair.substr(0, separator) == key) {
+      auto value{pair.substr(separator + 1)};
+      value = value.substr(0, value.find('\0'));
+      return std::string{value};
+    }
+
+    // Entries are padded to 4 bytes
+    offset += (length + 3U) & ~std::size_t{3};
+  }
+  return {};
+}
+} // namespace
+
+/**
+ * @brief Returns whether a path names a KTX2 file.
+ *
+ * @param path Path to a file.
+ *
+ * @return True if the extension of the file is `.ktx2`, case-insensitively.
+ */
+bool abcg::isKTX2Path(std::string_view path) noexcept {
+  constexpr std::string_view extension{".ktx2"};
+  if (path.size() < extension.size())
+    return false;
+  return std::ranges::equal(path.substr(path.size() - extension.size()),
+                            extension, [](char lhs, char rhs) {
+                              return std::tolower(
+                                         static_cast<unsigned char>(lhs)) ==
+                                     rhs;
+                            });
+}
+
+/**
+ * @brief Returns the description of a format.
+ *
+ * @param vkFormat `VkFormat` value of the format.
+ *
+ * @return Description of the format, or `std::nullopt` if the format is not
+ * supported. The supported formats are the 8-bit UNORM and sRGB formats with
+ * 1 to 4 channels, RGBA16F, RGBA32F, and all BC, ETC2/EAC and ASTC LDR
+ * formats.
+ */
+std::optional<abcg::KTX2FormatInfo>
+abcg::KTX2FormatInfo::find(std::uint32_t vkFormat) noexcept {
+  if (auto const format{std::ranges::find(
+          uncompressedFormats, vkFormat, &UncompressedFormat::vkFormat)};
+      format != uncompressedFormats.end()) {
+    return KTX2FormatInfo{.vkFormat = vkFormat,
+                          .bytesPerBlock = format->bytesPerTexel,
+                          .sRGB = format->sRGB};
+  }
+
+  KTX2FormatInfo info{.vkFormat = vkFormat,
+                      .blockWidth = 4,
+                      .blockHeight = 4,
+                      .bytesPerBlock = 16,
+                      .compressed = true};
+
+  if (vkFormat >= formatBC1First && vkFormat <= formatBC7Last) {
+    // BC1 and BC4 have 8-byte blocks
+    if (vkFormat <= 134 || vkFormat == 139 || vkFormat == 140) {
+      info.bytesPerBlock = 8;
+    }
+    info.sRGB = vkFormat == 132 || vkFormat == 134 || vkFormat == 136 ||
+                vkFormat == 138 || vkFormat == 146;
+    return info;
+  }
+
+  if (vkFormat >= formatETC2First && vkFormat <= formatEACLast) {
+    // ETC2 RGB, ETC2 RGB A1 and EAC R11 have 8-byte blocks
+    if (vkFormat <= 150 || vkFormat == 153 || vkFormat == 154) {
+      info.bytesPerBlock = 8;
+    }
+    info.sRGB = vkFormat == 148 || vkFormat == 150 || vkFormat == 152;
+    return info;
+  }
+
+  if (vkFormat >= formatASTCFirst && vkFormat <= formatASTCLast) {
+    // UNORM and sRGB variants alternate
+    auto const index{vkFormat - formatASTCFirst};
+    auto const &block{astcBlocks.at(index / 2)};
+    info.blockWidth = block.at(0);
+    info.blockHeight = block.at(1);
+    info.sRGB = index % 2 == 1;
+    return info;
+  }
+
+  return std::nullopt;
+}
+
+/**
+ * @brief Returns the size of an image in this format.
+ *
+ * @param width Image width, in texels.
+ * @param height Image height, in texels.
+ *
+ * @return Size in bytes, with partial blocks rounded up and rows tightly
+ * packed, as stored in KTX2 files.
+ */
+std::size_t
+abcg::KTX2FormatInfo::getImageSize(std::uint32_t width,
+                                   std::uint32_t height) const noexcept {
+  std::size_t const blocksX{(width + blockWidth - 1) / blockWidth};
+  std::size_t const blocksY{(height + blockHeight - 1) / blockHeight};
+  return blocksX * blocksY * bytesPerBlock;
+}
+
+/**
+ * @brief Opens a KTX2 file.
+ *
+ * The file is memory-mapped and its header and level index are validated.
+ * The image data is read from disk only when accessed.
+ *
+ * @param path Path to the KTX2 file.
+ *
+ * @throw abcg::RuntimeError if the file could not be opened, is not a valid
+ * KTX2 file, or uses a feature that is not supported (supercompression, 3D
+ * textures, or a format not listed in abcg::KTX2FormatInfo::find).
+ */
+void abcg::KTX2Texture::open(std::string_view path) {
+  ABCG_TRACE_ZONE("openKTX2", "texture", path);
+
+  close();
+  m_file.open(path);
+  auto const data{m_file.getData()};
+
+  auto const fail{[&](std::string_view reason) {
+    close();
+    return abcg::RuntimeError(
+        fmt::format("Failed to load KTX2 file {}: {}", path, reason));
+  }};
+
+  if (data.size() < headerSize ||
+      std::memcmp(data.data(), identifier.data(), identifier.size()) != 0) {
+    throw fail("invalid identifier");
+  }
+
+  auto const vkFormat{read<std::uint32_t>(data, vkFormatOffset)};
+  auto const pixelDepth{read<std::uint32_t>(data, pixelDepthOffset)};
+  auto const layerCount{read<std::uint32_t>(data, layerCountOffset)};
+  auto const faceCount{read<std::uint32_t>(data, faceCountOffset)};
+  auto const levelCount{read<std::uint32_t>(data, levelCountOffset)};
+  m_width = read<std::uint32_t>(data, pixelWidthOffset);
+  m_height = read<std::uint32_t>(data, pixelHeightOffset);
+
+  if (read<std::uint32_t>(data, supercompressionOffset) != 0) {
+    throw fail("supercompression is not supported");
+  }
+  if (m_width == 0 || m_height == 0 || pixelDepth != 0) {
+    throw fail("only 2D textures are supported");
+  }
+  if (faceCount != 1 && faceCount != 6) {
+    throw fail(fmt::format("invalid face count {}", faceCount));
+  }
+  if (auto const format{KTX2FormatInfo::find(vkFormat)}) {
+    m_format = *format;
+  } else {
+    throw fail(fmt::format("unsupported VkFormat {}", vkFormat));
+  }
+  m_layerCount = std::max(layerCount, 1U);
+  m_faceCount = faceCount;
+
+  // A level count of zero asks the loader to generate the mip levels. Only
+  // the base level is stored.
+  auto const storedLevels{std::max(levelCount, 1U)};
+  if (storedLevels > 32 ||
+      data.size() < headerSize + storedLevels * levelIndexEntrySize) {
+    throw fail("invalid level index");
+  }
+
+  m_levels.reserve(storedLevels);
+  for (auto const level : iter::range(storedLevels)) {
+    auto const entry{headerSize + level * levelIndexEntrySize};
+    auto const byteOffset{read<std::uint64_t>(data, entry)};
+    auto const byteLength{read<std::uint64_t>(data, entry + 8)};
+
+    auto const expectedLength{
+        m_format.getImageSize(getWidth(level), getHeight(level)) *
+        m_layerCount * m_faceCount};
+    if (byteOffset > data.size() || byteLength > data.size() - byteOffset ||
+        byteLength < expectedLength) {
+      throw fail(fmt::format("invalid data of level {}", level));
+    }
+    m_levels.push_back(data.subspan(gsl::narrow<std::size_t>(byteOffset),
+                                    gsl::narrow<std::size_t>(byteLength)));
+  }
+
+  // KTXorientation is "rd" (y down, the default) or "ru" (y up)
+  auto const kvdOffset{read<std::uint32_t>(data, kvdByteOffsetOffset)};
+  auto const kvdLength{read<std::uint32_t>(data, kvdByteLengthOffset)};
+  if (kvdLength > 0 && kvdOffset <= data.size() &&
+      kvdLength <= data.size() - kvdOffset) {
+    auto const orientation{
+        findValue(data.subspan(kvdOffset, kvdLength), "KTXorientation")};
+    m_upsideDown = orientation.size() >= 2 && orientation.at(1) == 'u';
+  }
+}
+
+/**
+ * @brief Unmaps the file.
+ *
+ * Views returned by abcg::KTX2Texture::getImage and
+ * abcg::KTX2Texture::getLevel are no longer valid.
+ */
+void abcg::KTX2Texture::close() noexcept {
+  m_file.close();
+  m_levels.clear();
+  m_format = {};
+  m_width = 0;
+  m_height = 0;
+  m_layerCount = 1;
+  m_faceCount = 1;
+  m_upsideDown = false;
+}
+
+/**
+ * @brief Reads the whole file from disk in the calling thread.
+ *
+ * @sa abcg::MappedFile::prefetch.
+ */
+void abcg::KTX2Texture::prefetch() const noexcept { m_file.prefetch(); }
+
+/**
+ * @brief Returns the pixel format of the texture.
+ *
+ * @return Description of the format.
+ */
+abcg::KTX2FormatInfo const &abcg::KTX2Texture::getFormat() const noexcept {
+  return m_format;
+}
+
+/**
+ * @brief Returns the width of a mip level.
+ *
+ * @param level Mip level, where 0 is the base level.
+ *
+ * @return Width in texels.
+ */
+std::uint32_t abcg::KTX2Texture::getWidth(std::uint32_t level) const noexcept {
+  return std::max(m_width >> level, 1U);
+}
+
+/**
+ * @brief Returns the height of a mip level.
+ *
+ * @param level Mip level, where 0 is the base level.
+ *
+ * @return Height in texels.
+ */
+std::uint32_t
+abcg::KTX2Texture::getHeight(std::uint32_t level) const noexcept {
+  return std::max(m_height >> level, 1U);
+}
+
+/**
+ * @brief Returns the number of mip levels stored in the file.
+ *
+ * @return Number of mip levels, at least 1.
+ */
+std::uint32_t abcg::KTX2Texture::getLevelCount() const noexcept {
+  return gsl::narrow_cast<std::uint32_t>(m_levels.size());
+}
+
+/**
+ * @brief Returns the number of array layers.
+ *
+ * @return Number of array layers, at least 1.
+ */
+std::uint32_t abcg::KTX2Texture::getLayerCount() const noexcept {
+  return m_layerCount;
+}
+
+/**
+ * @brief Returns the number of cube faces.
+ *
+ * @return 6 for a cubemap, 1 otherwise.
+ */
+std::uint32_t abcg::KTX2Texture::getFaceCount() const noexcept {
+  return m_faceCount;
+}
+
+/**
+ * @brief Returns whether the first row of the images is the bottom row.
+ *
+ * @return True if the `KTXorientation` metadata of the file is `ru`, as
+ * written by `abcg-ktx2convert --flip-y`. KTX2 files are top-down by default.
+ */
+bool abcg::KTX2Texture::isUpsideDown() const noexcept { return m_upsideDown; }
+
+/**
+ * @brief Returns the data of one image.
+ *
+ * @param level Mip level, where 0 is the base level.
+ * @param layer Array layer.
+ * @param face Cube face, in the order +x, -x, +y, -y, +z, -z.
+ *
+ * @return View into the mapped file of abcg::KTX2FormatInfo::getImageSize
+ * bytes.
+ *
+ * @throw abcg::RuntimeError if any index is out of range.
+ */
+std::span<std::byte const>
+abcg::KTX2Texture::getImage(std::uint32_t level, std::uint32_t layer,
+                            std::uint32_t face) const {
+  if (level >= m_levels.size() || layer >= m_layerCount ||
+      face >= m_faceCount) {
+    throw abcg::RuntimeError(
+        fmt::format("Invalid KTX2 image (level {}, layer {}, face {})", level,
+                    layer, face));
+  }
+  auto const imageSize{
+      m_format.getImageSize(getWidth(level), getHeight(level))};
+  auto const index{std::size_t{layer} * m_faceCount + face};
+  return m_levels.at(level).subspan(index * imageSize, imageSize);
+}
+
+/**
+ * @brief Returns the data of all images of a mip level.
+ *
+ * @param level Mip level, where 0 is the base level.
+ *
+ * @return View into the mapped file. The images are ordered by layer, then
+ * by face.
+ *
+ * @throw abcg::RuntimeError if the level is out of range.
+ */
+std::span<std::byte const>
+abcg::KTX2Texture::getLevel(std::uint32_t level) const {
+  if (level >= m_levels.size()) {
+    throw abcg::RuntimeError(fmt::format("Invalid KTX2 level {}", level));
+  }
+  auto const imageSize{
+      m_format.getImageSize(getWidth(level), getHeight(level))};
+  return m_levels.at(level).first(imageSize * m_layerCount * m_faceCount);
+}
+
+/**
+ * @brief Returns the size of the image data of all mip levels.
+ *
+ * @return Size in bytes.
+ */
+std::size_t abcg::KTX2Texture::getByteSize() const noexcept {
+  std::size_t size{};
+  for (auto const &level : m_levels) {
+    size += level.size();
+  }
+  return size;
+}
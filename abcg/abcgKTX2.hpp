@@ -0,0 +1,102 @@
+/**
+ * @file abcgKTX2.hpp
+ * @brief Header file of abcg::KTX2Texture.
+ *
+ * Declaration of abcg::KTX2Texture and abcg::KTX2FormatInfo.
+ *
+ * This file is part of ABCg (https://github.com/hbatagelo/abcg).
+ *
+ * @copyright (c) 2021--2023 Harlen Batagelo. All rights reserved.
+ * This project is released under the MIT License.
+ */
+
+#ifndef ABCG_KTX2_HPP_
+#define ABCG_KTX2_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <vector>
+
+#include "abcgMappedFile.hpp"
+
+namespace abcg {
+struct KTX2FormatInfo;
+class KTX2Texture;
+
+[[nodiscard]] bool isKTX2Path(std::string_view path) noexcept;
+} // namespace abcg
+
+/**
+ * @brief Description of a pixel format that can be stored in a KTX2 file.
+ *
+ * The format is identified by its `VkFormat` value, as in the KTX2 header.
+ * Uncompressed formats have blocks of 1x1 texel.
+ */
+struct abcg::KTX2FormatInfo {
+  /** @brief `VkFormat` value of the format. */
+  std::uint32_t vkFormat{};
+  /** @brief Width of a block, in texels. */
+  std::uint32_t blockWidth{1};
+  /** @brief Height of a block, in texels. */
+  std::uint32_t blockHeight{1};
+  /** @brief Size of a block, in bytes. */
+  std::uint32_t bytesPerBlock{};
+  /** @brief Whether the format is block-compressed (BC, ETC2/EAC or ASTC). */
+  bool compressed{};
+  /** @brief Whether the color channels are sRGB-encoded. */
+  bool sRGB{};
+
+  [[nodiscard]] static std::optional<KTX2FormatInfo>
+  find(std::uint32_t vkFormat) noexcept;
+
+  [[nodiscard]] std::size_t getImageSize(std::uint32_t width,
+                                         std::uint32_t height) const noexcept;
+};
+
+/**
+ * @brief A texture stored in a KTX2 container.
+ *
+ * The file is memory-mapped with abcg::MappedFile, and the images of each mip
+ * level are views into the mapping, so they can be uploaded to the GPU
+ * without being decoded or copied. Only files without supercompression are
+ * supported.
+ *
+ * The texture can have any number of mip levels, array layers and cube faces,
+ * but must be 2D.
+ */
+class abcg::KTX2Texture {
+public:
+  void open(std::string_view path);
+  void close() noexcept;
+  void prefetch() const noexcept;
+
+  [[nodiscard]] KTX2FormatInfo const &getFormat() const noexcept;
+  [[nodiscard]] std::uint32_t getWidth(std::uint32_t level = 0) const noexcept;
+  [[nodiscard]] std::uint32_t getHeight(std::uint32_t level = 0) const noexcept;
+  [[nodiscard]] std::uint32_t getLevelCount() const noexcept;
+  [[nodiscard]] std::uint32_t getLayerCount() const noexcept;
+  [[nodiscard]] std::uint32_t getFaceCount() const noexcept;
+  [[nodiscard]] bool isUpsideDown() const noexcept;
+
+  [[nodiscard]] std::span<std::byte const>
+  getImage(std::uint32_t level, std::uint32_t layer = 0,
+           std::uint32_t face = 0) const;
+  [[nodiscard]] std::span<std::byte const>
+  getLevel(std::uint32_t level) const;
+  [[nodiscard]] std::size_t getByteSize() const noexcept;
+
+private:
+  MappedFile m_file;
+  KTX2FormatInfo m_format;
+  std::uint32_t m_width{};
+  std::uint32_t m_height{};
+  std::uint32_t m_layerCount{1};
+  std::uint32_t m_faceCount{1};
+  bool m_upsideDown{};
+  std::vector<std::span<std::byte const>> m_levels;
+};
+
+#endif
@@ -0,0 +1,205 @@
+/**
+ * @file abcgMappedFile.cpp
+ * @brief Definition of abcg::MappedFile members.
+ *
+ * This file is part of ABCg (https://github.com/hbatagelo/abcg).
+ *
+ * @copyright (c) 2021--2023 Harlen Batagelo. All rights reserved.
+ * This project is released under the MIT License.
+ */
+
+#include "abcgMappedFile.hpp"
+
+#include <fstream>
+#include <string>
+#include <utility>
+
+#include <fmt/core.h>
+#include <gsl/gsl>
+
+#include "abcgException.hpp"
+
+#if defined(__EMSCRIPTEN__)
+// Files are read into memory
+#elif defined(_WIN32)
+#if !defined(WIN32_LEAN_AND_MEAN)
+#define WIN32_LEAN_AND_MEAN
+#endif
+#if !defined(NOMINMAX)
+#define NOMINMAX
+#endif
+#include <windows.h>
+#define ABCG_MAPPED_FILE_WIN32
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define ABCG_MAPPED_FILE_POSIX
+#endif
+
+namespace {
+// Returns the view of the whole file, or nullptr if it could not be mapped.
+// Throws if the file could not be opened.
+std::byte const *mapFile(std::string const &path, std::size_t &size) {
+#if defined(ABCG_MAPPED_FILE_POSIX)
+  auto const descriptor{::open(path.c_str(), O_RDONLY)};
+  if (descriptor < 0) {
+    throw abcg::RuntimeError(fmt::format("Failed to open file {}", path));
+  }
+  auto const closeDescriptor{gsl::finally([=] { ::close(descriptor); })};
+
+  struct stat status {};
+  if (fstat(descriptor, &status) != 0 || status.st_size <= 0)
+    return nullptr;
+  size = gsl::narrow<std::size_t>(status.st_size);
+
+  auto *const data{
+      mmap(nullptr, size, PROT_READ, MAP_PRIVATE, descriptor, 0)};
+  if (data == MAP_FAILED)
+    return nullptr;
+  return static_cast<std::byte const *>(data);
+#elif defined(ABCG_MAPPED_FILE_WIN32)
+  auto *const file{CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ,
+                               nullptr, OPEN_EXISTING,
+                               FILE_ATTRIBUTE_NORMAL, nullptr)};
+  if (file == INVALID_HANDLE_VALUE) {
+    throw abcg::RuntimeError(fmt::format("Failed to open file {}", path));
+  }
+  auto const closeFile{gsl::finally([=] { CloseHandle(file); })};
+
+  LARGE_INTEGER fileSize{};
+  if (GetFileSizeEx(file, &fileSize) == 0 || fileSize.QuadPart <= 0)
+    return nullptr;
+  size = gsl::narrow<std::size_t>(fileSize.QuadPart);
+
+  // The view keeps a reference to the mapping object
+  auto *const mapping{
+      CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr)};
+  if (mapping == nullptr)
+    return nullptr;
+  auto *const data{MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0)};
+  CloseHandle(mapping);
+  return static_cast<std::byte const *>(data);
+#else
+  (void)path;
+  (void)size;
+  return nullptr;
+#endif
+}
+
+void unmapFile(std::byte const *data, [[maybe_unused]] std::size_t size) {
+#if defined(ABCG_MAPPED_FILE_POSIX)
+  // NOLINTNEXTLINE(cppcoreguidelines-pro-type-const-cast)
+  munmap(const_cast<std::byte *>(data), size);
+#elif defined(ABCG_MAPPED_FILE_WIN32)
+  UnmapViewOfFile(data);
+#else
+  (void)data;
+#endif
+}
+} // namespace
+
+abcg::MappedFile::MappedFile(MappedFile &&other) noexcept
+    : m_data{std::exchange(other.m_data, nullptr)},
+      m_size{std::exchange(other.m_size, 0)},
+      m_mapped{std::exchange(other.m_mapped, false)},
+      m_buffer{std::move(other.m_buffer)} {}
+
+abcg::MappedFile::~MappedFile() { close(); }
+
+abcg::MappedFile &abcg::MappedFile::operator=(MappedFile &&other) noexcept {
+  if (this != &other) {
+    close();
+    m_data = std::exchange(other.m_data, nullptr);
+    m_size = std::exchange(other.m_size, 0);
+    m_mapped = std::exchange(other.m_mapped, false);
+    m_buffer = std::move(other.m_buffer);
+  }
+  return *this;
+}
+
+/**
+ * @brief Maps a file into memory.
+ *
+ * If the file cannot be mapped (for instance, if it is empty or the platform
+ * has no support for it), it is read into memory instead.
+ *
+ * @param path Path to the file.
+ *
+ * @throw abcg::RuntimeError if the file could not be opened or read.
+ */
+void abcg::MappedFile::open(std::string_view path) {
+  close();
+
+  std::string const pathString{path};
+  std::size_t size{};
+  if (auto const *const data{mapFile(pathString, size)}) {
+    m_data = data;
+    m_size = size;
+    m_mapped = true;
+    return;
+  }
+
+  std::ifstream stream{pathString, std::ios::binary | std::ios::ate};
+  if (!stream) {
+    throw abcg::RuntimeError(fmt::format("Failed to open file {}", path));
+  }
+  m_buffer.resize(gsl::narrow<std::size_t>(std::streamoff{stream.tellg()}));
+  stream.seekg(0);
+  if (!stream.read(reinterpret_cast<char *>(m_buffer.data()),
+                   gsl::narrow<std::streamsize>(m_buffer.size()))) {
+    m_buffer.clear();
+    throw abcg::RuntimeError(fmt::format("Failed to read file {}", path));
+  }
+  m_data = m_buffer.data();
+  m_size = m_buffer.size();
+}
+
+/**
+ * @brief Unmaps the file.
+ *
+ * Views returned by abcg::MappedFile::getData are no longer valid.
+ */
+void abcg::MappedFile::close() noexcept {
+  if (m_mapped) {
+    unmapFile(m_data, m_size);
+  }
+  m_data = nullptr;
+  m_size = 0;
+  m_mapped = false;
+  m_buffer.clear();
+  m_buffer.shrink_to_fit();
+}
+
+/**
+ * @brief Reads the pages of the file from disk.
+ *
+ * Touches one byte of each page, so that the pages are read by the calling
+ * thread (for instance, a loader thread) instead of the thread that later
+ * accesses the data.
+ */
+void abcg::MappedFile::prefetch() const noexcept {
+  constexpr std::size_t pageSize{4096};
+  for (std::size_t offset{}; offset < m_size; offset += pageSize) {
+    [[maybe_unused]] auto const value{
+        *static_cast<std::byte const volatile *>(m_data + offset)};
+  }
+}
+
+/**
+ * @brief Returns whether a file is open.
+ *
+ * @return True if abcg::MappedFile::open succeeded and the file was not
+ * closed.
+ */
+bool abcg::MappedFile::isOpen() const noexcept { return m_data != nullptr; }
+
+/**
+ * @brief Returns the contents of the file.
+ *
+ * @return View of the whole file. Empty if no file is open.
+ */
+std::span<std::byte const> abcg::MappedFile::getData() const noexcept {
+  return {m_data, m_size};
+}
@@ -0,0 +1,60 @@
+/**
+ * @file abcgMappedFile.hpp
+ * @brief Header file of abcg::MappedFile.
+ *
+ * Declaration of abcg::MappedFile.
+ *
+ * This file is part of ABCg (https://github.com/hbatagelo/abcg).
+ *
+ * @copyright (c) 2021--2023 Harlen Batagelo. All rights reserved.
+ * This project is released under the MIT License.
+ */
+
+#ifndef ABCG_MAPPED_FILE_HPP_
+#define ABCG_MAPPED_FILE_HPP_
+
+#include <cstddef>
+#include <span>
+#include <string_view>
+#include <vector>
+
+namespace abcg {
+class MappedFile;
+} // namespace abcg
+
+/**
+ * @brief Read-only view of the contents of a file.
+ *
+ * On Linux, macOS and Windows, the file is memory-mapped, so its pages are
+ * only read from disk when accessed, and are shared with the page cache
+ * instead of being copied. On Emscripten, the file is read into memory.
+ *
+ * The object is movable but not copyable. The view is unmapped when the
+ * object is destroyed.
+ */
+class abcg::MappedFile {
+public:
+  MappedFile() = default;
+  MappedFile(MappedFile const &) = delete;
+  MappedFile(MappedFile &&other) noexcept;
+  ~MappedFile();
+
+  MappedFile &operator=(MappedFile const &) = delete;
+  MappedFile &operator=(MappedFile &&other) noexcept;
+
+  void open(std::string_view path);
+  void close() noexcept;
+  void prefetch() const noexcept;
+
+  [[nodiscard]] bool isOpen() const noexcept;
+  [[nodiscard]] std::span<std::byte const> getData() const noexcept;
+
+private:
+  std::byte const *m_data{};
+  std::size_t m_size{};
+  bool m_mapped{};
+  // Used only if the file could not be mapped
+  std::vector<std::byte> m_buffer;
+};
+
+#endif
@@ -0,0 +1,449 @@
+/**
+ * @file abcgMesh.cpp
+ * @brief Definition of abcg::Mesh members.
+ *
+ * This file is part of ABCg (https://github.com/hbatagelo/abcg).
+ *
+ * @copyright (c) 2021--2023 Harlen Batagelo. All rights reserved.
+ * This project is released under the MIT License.
+ */
+
+#include "abcgMesh.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+#include "abcgException.hpp"
+#include "abcgMeshOptimizer.hpp"
+#include "abcgUtil.hpp"
+
+namespace {
+// Header of a binary mesh file. The vertex and index buffers follow the
+// header, in the native byte order
+struct MeshFileHeader {
+  std::array<char, 4> magic{'A', 'B', 'M', 'F'};
+  // Incremented whenever the layout or the processing of the mesh changes,
+  // so that older files are rebuilt
+  std::uint32_t version{2};
+  std::uint32_t flags{};
+  std::uint32_t vertexStride{sizeof(abcg::MeshVertex)};
+  std::uint32_t indexSize{};
+  std::uint32_t reserved{};
+  std::uint64_t vertexCount{};
+  std::uint64_t vertexOffset{};
+  std::uint64_t indexCount{};
+  std::uint64_t indexOffset{};
+};
+static_assert(sizeof(abcg::MeshVertex) == 32);
+static_assert(sizeof(MeshFileHeader) == 56);
+
+constexpr std::uint32_t hasNormalsFlag{1U << 0};
+constexpr std::uint32_t hasTexCoordsFlag{1U << 1};
+// Offset of the vertex buffer in the file. The mapping is page-aligned, so
+// this keeps the vertices aligned to a cache line
+constexpr std::uint64_t vertexBufferOffset{64};
+
+// Returns `count` * `elementSize`, or nothing if the product overflows
+[[nodiscard]] std::optional<std::uint64_t>
+checkedMultiply(std::uint64_t count, std::uint64_t elementSize) noexcept {
+  if (elementSize != 0 &&
+      count > std::numeric_limits<std::uint64_t>::max() / elementSize) {
+    return std::nullopt;
+  }
+  return count * elementSize;
+}
+
+struct MeshVertexHash {
+  std::size_t operator()(abcg::MeshVertex const &vertex) const noexcept {
+    return abcg::hashCombine(vertex.position, vertex.normal, vertex.texCoord);
+  }
+};
+
+// Computes smooth normals by accumulating the area-weighted normals of the
+// triangles that share each vertex
+void computeNormals(std::vector<abcg::MeshVertex> &vertices,
+                    std::vector<std::uint32_t> const &indices) {
+  for (auto &vertex : vertices) {
+    vertex.normal = glm::vec3{0.0f};
+  }
+  for (std::size_t offset{}; offset + 2 < indices.size(); offset += 3) {
+    auto &a{vertices.at(indices.at(offset + 0))};
+    auto &b{vertices.at(indices.at(offset + 1))};
+    auto &c{vertices.at(indices.at(offset + 2))};
+    auto const normal{
+        glm::cross(b.position - a.position, c.position - b.position)};
+    a.normal += normal;
+    b.normal += normal;
+    c.normal += normal;
+  }
+  for (auto &vertex : vertices) {
+    if (auto const length{glm::length(vertex.normal)}; length > 0.0f) {
+      vertex.normal /= length;
+    }
+  }
+}
+} // namespace
+
+/**
+ * @brief Loads a mesh from a Wavefront OBJ file.
+ *
+ * The faces of all shapes are triangulated and merged into a single indexed
+ * triangle list. Vertices with the same attributes are shared. If the file
+ * has no normals, smooth normals are computed from the triangles.
+ *
+ * @param path Path to the OBJ file.
+ *
+ * @throw abcg::RuntimeError if the file could not be parsed.
+ */
+void abcg::Mesh::loadOBJ(std::string_view path) {
+  clear();
+
+  tinyobj::ObjReader reader;
+  if (!reader.ParseFromFile(std::string{path})) {
+    throw abcg::RuntimeError(
+        fmt::format("Failed to load model {} ({})", path, reader.Error()));
+  }
+
+  auto const &attrib{reader.GetAttrib()};
+  auto const &shapes{reader.GetShapes()};
+
+  std::size_t indexCount{};
+  for (auto const &shape : shapes) {
+    indexCount += shape.mesh.indices.size();
+  }
+
+  std::vector<std::uint32_t> indices;
+  indices.reserve(indexCount);
+  std::unordered_map<MeshVertex, std::uint32_t, MeshVertexHash> vertexIndex;
+  vertexIndex.reserve(indexCount);
+
+  m_hasNormals = !attrib.normals.empty();
+  m_hasTexCoords = !attrib.texcoords.empty();
+
+  for (auto const &shape : shapes) {
+    for (auto const &index : shape.mesh.indices) {
+      MeshVertex vertex{};
+      auto const position{3 * gsl::narrow<std::size_t>(index.vertex_index)};
+      vertex.position = {attrib.vertices.at(position + 0),
+                         attrib.vertices.at(position + 1),
+                         attrib.vertices.at(position + 2)};
+      if (m_hasNormals && index.normal_index >= 0) {
+        auto const normal{3 * gsl::narrow<std::size_t>(index.normal_index)};
+        vertex.normal = {attrib.normals.at(normal + 0),
+                         attrib.normals.at(normal + 1),
+                         attrib.normals.at(normal + 2)};
+      }
+      if (m_hasTexCoords && index.texcoord_index >= 0) {
+        auto const texCoord{
+            2 * gsl::narrow<std::size_t>(index.texcoord_index)};
+        vertex.texCoord = {attrib.texcoords.at(texCoord + 0),
+                           attrib.texcoords.at(texCoord + 1)};
+      }
+
+      auto const [iter, inserted]{vertexIndex.try_emplace(
+          vertex, gsl::narrow<std::uint32_t>(m_ownedVertices.size()))};
+      if (inserted) {
+        m_ownedVertices.push_back(vertex);
+      }
+      indices.push_back(iter->second);
+    }
+  }
+
+  if (!m_hasNormals) {
+    computeNormals(m_ownedVertices, indices);
+    m_hasNormals = true;
+  }
+
+  m_indexSize = selectIndexSize(m_ownedVertices.size());
+  m_ownedIndexData = packIndices(indices, m_indexSize);
+  m_vertices = m_ownedVertices;
+  m_indexData = m_ownedIndexData;
+}
+
+/**
+ * @brief Loads a mesh from a binary mesh file.
+ *
+ * The file is memory-mapped, and the vertex and index buffers are views into
+ * the mapping. No parsing or copying is done, but the indices are read once
+ * to check that they are within the vertex buffer.
+ *
+ * @param path Path to a file written by abcg::Mesh::save.
+ *
+ * @throw abcg::RuntimeError if the file could not be read, if it is not a
+ * binary mesh file of the current version, or if its buffers are invalid.
+ */
+void abcg::Mesh::load(std::string_view path) {
+  clear();
+
+  m_file.open(path);
+  auto const data{m_file.getData()};
+  auto const fail{[&](std::string_view reason) {
+    clear();
+    return abcg::RuntimeError(
+        fmt::format("Failed to load mesh {}: {}", path, reason));
+  }};
+
+  MeshFileHeader header{};
+  if (data.size() < sizeof(header)) {
+    throw fail("file is too small");
+  }
+  std::memcpy(&header, data.data(), sizeof(header));
+  if (header.magic != MeshFileHeader{}.magic) {
+    throw fail("not a binary mesh file");
+  }
+  if (header.version != MeshFileHeader{}.version ||
+      header.vertexStride != sizeof(MeshVertex)) {
+    throw fail(fmt::format("unsupported version {}", header.version));
+  }
+  if (header.indexSize != sizeof(std::uint16_t) &&
+      header.indexSize != sizeof(std::uint32_t)) {
+    throw fail(fmt::format("invalid index size {}", header.indexSize));
+  }
+
+  auto const vertexBytes{
+      checkedMultiply(header.vertexCount, sizeof(MeshVertex))};
+  auto const indexBytes{checkedMultiply(header.indexCount, header.indexSize)};
+  if (!vertexBytes || !indexBytes ||
+      header.vertexOffset % alignof(MeshVertex) != 0 ||
+      header.vertexOffset > data.size() ||
+      *vertexBytes > data.size() - header.vertexOffset ||
+      header.indexOffset > data.size() ||
+      *indexBytes > data.size() - header.indexOffset) {
+    throw fail("buffers out of bounds");
+  }
+
+  m_vertices = {
+      reinterpret_cast<MeshVertex const *>(data.data() + header.vertexOffset),
+      gsl::narrow<std::size_t>(header.vertexCount)};
+  m_indexData = data.subspan(gsl::narrow<std::size_t>(header.indexOffset),
+                             gsl::narrow<std::size_t>(*indexBytes));
+  m_indexSize = header.indexSize;
+  m_hasNormals = (header.flags & hasNormalsFlag) != 0;
+  m_hasTexCoords = (header.flags & hasTexCoordsFlag) != 0;
+
+  // An index out of range would make the optimizers and the draw calls read
+  // past the vertex buffer
+  std::uint32_t maxIndex{};
+  for (auto const position : iter::range(getIndexCount())) {
+    maxIndex = std::max(maxIndex, getIndex(position));
+  }
+  if (getIndexCount() > 0 && maxIndex >= header.vertexCount) {
+    throw fail(fmt::format("index {} out of range", maxIndex));
+  }
+}
+
+/**
+ * @brief Loads a mesh from a binary mesh file, creating it from an OBJ file
+ * if needed.
+ *
+ * The binary file is used if it is at least as recent as the OBJ file and has
+ * the current version. Otherwise, the OBJ file is loaded with
+ * abcg::Mesh::loadOBJ, optimized with abcg::Mesh::optimize, and saved to the
+ * binary file for the next runs.
+ *
+ * @param objPath Path to the OBJ file.
+ * @param cachePath Path to the binary mesh file.
+ *
+ * @throw abcg::RuntimeError if the OBJ file is needed and could not be
+ * parsed. Failing to write the binary file is not an error.
+ */
+void abcg::Mesh::loadCached(std::string_view objPath,
+                            std::string_view cachePath) {
+  std::filesystem::path const objFile{objPath};
+  std::filesystem::path const cacheFile{cachePath};
+
+  std::error_code errorCode;
+  auto const objTime{std::filesystem::last_write_time(objFile, errorCode)};
+  auto const objExists{!errorCode};
+  auto const cacheTime{std::filesystem::last_write_time(cacheFile, errorCode)};
+  if (!errorCode && (!objExists || cacheTime >= objTime)) {
+    try {
+      load(cachePath);
+      return;
+    } catch (abcg::RuntimeError const &) {
+      // Outdated or corrupted: rebuild it below
+    }
+  }
+
+  loadOBJ(objPath);
+  optimize();
+  try {
+    save(cachePath);
+  } catch (abcg::RuntimeError const &exception) {
+    fmt::print("Warning: {}\n", exception.what());
+  }
+}
+
+/**
+ * @brief Reorders the triangles and vertices for rendering.
+ *
+ * Applies abcg::optimizeVertexCache, abcg::optimizeOverdraw and
+ * abcg::optimizeVertexFetch, and selects the smallest index size. Vertices
+ * that are not used by any triangle are removed.
+ *
+ * If the mesh was loaded from a binary mesh file, the buffers are copied and
+ * the file is closed.
+ */
+void abcg::Mesh::optimize() {
+  std::vector<std::uint32_t> indices(getIndexCount());
+  for (auto const position : iter::range(indices.size())) {
+    indices[position] = getIndex(position);
+  }
+  std::vector<glm::vec3> positions;
+  positions.reserve(m_vertices.size());
+  for (auto const &vertex : m_vertices) {
+    positions.push_back(vertex.position);
+  }
+
+  optimizeVertexCache(indices, m_vertices.size());
+  optimizeOverdraw(indices, positions);
+  auto const remap{optimizeVertexFetch(indices, m_vertices.size())};
+
+  auto vertices{remapVertices(m_vertices, remap)};
+  m_indexSize = selectIndexSize(vertices.size());
+  m_ownedIndexData = packIndices(indices, m_indexSize);
+  m_ownedVertices = std::move(vertices);
+  m_vertices = m_ownedVertices;
+  m_indexData = m_ownedIndexData;
+  m_file.close();
+}
+
+/**
+ * @brief Saves the mesh to a binary mesh file.
+ *
+ * The file can be loaded with abcg::Mesh::load. It is meant as a cache for
+ * the machine that wrote it, as the buffers are stored in the native byte
+ * order.
+ *
+ * @param path Path to the binary mesh file.
+ *
+ * @throw abcg::RuntimeError if the file could not be written.
+ */
+void abcg::Mesh::save(std::string_view path) const {
+  MeshFileHeader header{
+      .flags = (m_hasNormals ? hasNormalsFlag : 0U) |
+               (m_hasTexCoords ? hasTexCoordsFlag : 0U),
+      .indexSize = gsl::narrow<std::uint32_t>(m_indexSize),
+      .vertexCount = m_vertices.size(),
+      .vertexOffset = vertexBufferOffset,
+      .indexCount = getIndexCount(),
+      .indexOffset = vertexBufferOffset + m_vertices.size_bytes()};
+
+  // Write to a temporary file first, so that a mapped file with the same
+  // name (possibly this mesh) is not truncated, and an interrupted write
+  // does not leave a corrupted cache
+  std::filesystem::path const file{path};
+  auto temporaryFile{file};
+  temporaryFile += ".tmp";
+  {
+    std::ofstream stream(temporaryFile, std::ios::binary | std::ios::trunc);
+    std::array<char, vertexBufferOffset - sizeof(header)> const padding{};
+    stream.write(reinterpret_cast<char const *>(&header), sizeof(header));
+    stream.write(padding.data(), padding.size());
+    stream.write(reinterpret_cast<char const *>(m_vertices.data()),
+                 gsl::narrow<std::streamsize>(m_vertices.size_bytes()));
+    stream.write(reinterpret_cast<char const *>(m_indexData.data()),
+                 gsl::narrow<std::streamsize>(m_indexData.size()));
+    if (!stream) {
+      throw abcg::RuntimeError(
+          fmt::format("Failed to write mesh {}", path));
+    }
+  }
+
+  std::error_code errorCode;
+  std::filesystem::rename(temporaryFile, file, errorCode);
+  if (errorCode) {
+    std::filesystem::remove(temporaryFile, errorCode);
+    throw abcg::RuntimeError(fmt::format("Failed to write mesh {}", path));
+  }
+}
+
+/**
+ * @brief Releases the vertex and index buffers.
+ */
+void abcg::Mesh::clear() noexcept {
+  m_vertices = {};
+  m_indexData = {};
+  m_indexSize = sizeof(std::uint32_t);
+  m_hasNormals = false;
+  m_hasTexCoords = false;
+  m_ownedVertices.clear();
+  m_ownedIndexData.clear();
+  m_file.close();
+}
+
+/**
+ * @brief Returns the vertex buffer.
+ *
+ * @return View of the interleaved vertices.
+ */
+std::span<abcg::MeshVertex const> abcg::Mesh::getVertices() const noexcept {
+  return m_vertices;
+}
+
+/**
+ * @brief Returns the index buffer.
+ *
+ * @return View of the indices of the triangle list, as 16-bit or 32-bit
+ * unsigned integers (see abcg::Mesh::getIndexSize).
+ */
+std::span<std::byte const> abcg::Mesh::getIndexData() const noexcept {
+  return m_indexData;
+}
+
+/**
+ * @brief Returns the number of indices.
+ *
+ * @return Number of indices, which is three times the number of triangles.
+ */
+std::size_t abcg::Mesh::getIndexCount() const noexcept {
+  return m_indexData.size() / m_indexSize;
+}
+
+/**
+ * @brief Returns the size of each index.
+ *
+ * @return 2 for 16-bit indices, or 4 for 32-bit indices.
+ */
+std::size_t abcg::Mesh::getIndexSize() const noexcept { return m_indexSize; }
+
+/**
+ * @brief Returns an index of the index buffer.
+ *
+ * @param position Position of the index, less than abcg::Mesh::getIndexCount.
+ *
+ * @return Index, regardless of the index size.
+ */
+std::uint32_t abcg::Mesh::getIndex(std::size_t position) const noexcept {
+  auto const *const source{m_indexData.data() + position * m_indexSize};
+  if (m_indexSize == sizeof(std::uint16_t)) {
+    std::uint16_t index{};
+    std::memcpy(&index, source, sizeof(index));
+    return index;
+  }
+  std::uint32_t index{};
+  std::memcpy(&index, source, sizeof(index));
+  return index;
+}
+
+/**
+ * @brief Returns whether the vertices have normals.
+ *
+ * @return True if the normals were loaded or computed.
+ */
+bool abcg::Mesh::hasNormals() const noexcept { return m_hasNormals; }
+
+/**
+ * @brief Returns whether the vertices have texture coordinates.
+ *
+ * @return True if the OBJ file had texture coordinates.
+ */
+bool abcg::Mesh::hasTexCoords() const noexcept { return m_hasTexCoords; }
@@ -0,0 +1,105 @@
+/**
+ * @file abcgMesh.hpp
+ * @brief Header file of abcg::Mesh.
+ *
+ * Declaration of abcg::Mesh and abcg::MeshVertex.
+ *
+ * This file is part of ABCg (https://github.com/hbatagelo/abcg).
+ *
+ * @copyright (c) 2021--2023 Harlen Batagelo. All rights reserved.
+ * This project is released under the MIT License.
+ */
+
+#ifndef ABCG_MESH_HPP_
+#define ABCG_MESH_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include <vector>
+
+#include "abcgExternal.hpp"
+#include "abcgMappedFile.hpp"
+
+namespace abcg {
+struct MeshVertex;
+class Mesh;
+} // namespace abcg
+
+/**
+ * @brief Interleaved vertex attributes of an abcg::Mesh.
+ *
+ * The layout is the same in memory and in the binary mesh file: 32 bytes per
+ * vertex, with the position at offset 0, the normal at offset 12 and the
+ * texture coordinates at offset 24.
+ */
+struct abcg::MeshVertex {
+  /** @brief Position. */
+  glm::vec3 position{};
+  /** @brief Unit normal. */
+  glm::vec3 normal{};
+  /** @brief Texture coordinates. */
+  glm::vec2 texCoord{};
+
+  friend bool operator==(MeshVertex const &,
+                         MeshVertex const &) noexcept = default;
+};
+
+/**
+ * @brief An indexed triangle mesh with a binary file cache.
+ *
+ * Parsing a large Wavefront OBJ file is slow, so the mesh can be saved to a
+ * binary file that contains the vertex and index buffers as they are uploaded
+ * to the GPU. Loading this file only maps it into memory with
+ * abcg::MappedFile. abcg::Mesh::loadCached does both, and rebuilds the cache
+ * (with the mesh optimized by abcg::Mesh::optimize) when it is older than the
+ * OBJ file:
+ *
+ * @code
+ * abcg::Mesh mesh;
+ * mesh.loadCached(assetsPath + "bunny.obj", assetsPath + "bunny.mesh");
+ *
+ * auto const vertices{mesh.getVertices()};
+ * glBufferData(GL_ARRAY_BUFFER, vertices.size_bytes(), vertices.data(),
+ *              GL_STATIC_DRAW);
+ * auto const indices{mesh.getIndexData()};
+ * glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size_bytes(), indices.data(),
+ *              GL_STATIC_DRAW);
+ * // Draw with mesh.getIndexSize() == 2 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT
+ * @endcode
+ *
+ * Indices are 16-bit if all vertices can be addressed with them, and 32-bit
+ * otherwise.
+ */
+class abcg::Mesh {
+public:
+  void loadOBJ(std::string_view path);
+  void load(std::string_view path);
+  void loadCached(std::string_view objPath, std::string_view cachePath);
+  void save(std::string_view path) const;
+  void optimize();
+  void clear() noexcept;
+
+  [[nodiscard]] std::span<MeshVertex const> getVertices() const noexcept;
+  [[nodiscard]] std::span<std::byte const> getIndexData() const noexcept;
+  [[nodiscard]] std::size_t getIndexCount() const noexcept;
+  [[nodiscard]] std::size_t getIndexSize() const noexcept;
+  [[nodiscard]] std::uint32_t getIndex(std::size_t position) const noexcept;
+  [[nodiscard]] bool hasNormals() const noexcept;
+  [[nodiscard]] bool hasTexCoords() const noexcept;
+
+private:
+  // Views of either the owned buffers or the mapped file
+  std::span<MeshVertex const> m_vertices;
+  std::span<std::byte const> m_indexData;
+  std::size_t m_indexSize{sizeof(std::uint32_t)};
+  bool m_hasNormals{};
+  bool m_hasTexCoords{};
+
+  std::vector<MeshVertex> m_ownedVertices;
+  std::vector<std::byte> m_ownedIndexData;
+  MappedFile m_file;
+};
+
+#endif
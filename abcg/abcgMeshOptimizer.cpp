@@ -0,0 +1,442 @@
+/**
+ * @file abcgMeshOptimizer.cpp
+ * @brief Definition of mesh optimization functions.
+ *
+ * This file is part of ABCg (https://github.com/hbatagelo/abcg).
+ *
+ * @copyright (c) 2021--2023 Harlen Batagelo. All rights reserved.
+ * This project is released under the MIT License.
+ */
+
+#include "abcgMeshOptimizer.hpp"
+
+#include <cstring>
+#include <numeric>
+#include <optional>
+#include <utility>
+
+#include <glm/gtc/packing.hpp>
+
+namespace {
+// FIFO post-transform vertex cache. A vertex is in the cache if fewer than
+// `cacheSize` misses happened since it was transformed
+class VertexCache {
+public:
+  VertexCache(std::size_t vertexCount, std::size_t cacheSize)
+      : m_timestamps(vertexCount), m_cacheSize{cacheSize},
+        m_time{cacheSize + 1} {}
+
+  // Returns whether the vertex had to be transformed
+  bool access(std::uint32_t vertex) {
+    auto &timestamp{m_timestamps.at(vertex)};
+    if (m_time - timestamp > m_cacheSize) {
+      timestamp = m_time++;
+      return true;
+    }
+    return false;
+  }
+
+  // Returns the number of vertices of the triangle that had to be transformed
+  std::size_t access(std::span<std::uint32_t const> indices,
+                     std::size_t triangle) {
+    std::size_t misses{};
+    for (std::size_t corner{}; corner < 3; ++corner) {
+      misses += access(indices[triangle * 3 + corner]) ? 1U : 0U;
+    }
+    return misses;
+  }
+
+  void clear() noexcept { m_time += m_cacheSize + 1; }
+
+private:
+  std::vector<std::size_t> m_timestamps;
+  std::size_t m_cacheSize{};
+  std::size_t m_time{};
+};
+
+// Triangles that use each vertex, in compressed sparse row layout
+struct VertexTriangles {
+  std::vector<std::size_t> offsets;
+  std::vector<std::uint32_t> triangles;
+
+  VertexTriangles(std::span<std::uint32_t const> indices,
+                  std::size_t vertexCount)
+      : offsets(vertexCount + 1), triangles(indices.size()) {
+    for (auto const index : indices) {
+      ++offsets.at(index + 1);
+    }
+    std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+    auto fill{offsets};
+    for (auto const position : iter::range(indices.size())) {
+      triangles.at(fill.at(indices[position])++) =
+          gsl::narrow<std::uint32_t>(position / 3);
+    }
+  }
+
+  [[nodiscard]] std::span<std::uint32_t const>
+  get(std::uint32_t vertex) const {
+    return std::span{triangles}.subspan(offsets.at(vertex),
+                                        offsets.at(vertex + 1) -
+                                            offsets.at(vertex));
+  }
+};
+} // namespace
+
+/**
+ * @brief Measures the efficiency of the post-transform vertex cache.
+ *
+ * Simulates a FIFO cache, as found in most GPUs.
+ *
+ * @param indices Index buffer of a triangle list.
+ * @param vertexCount Number of vertices of the vertex buffer.
+ * @param cacheSize Number of entries of the cache.
+ *
+ * @return Number of transformed vertices, ACMR and ATVR.
+ */
+abcg::VertexCacheStatistics
+abcg::analyzeVertexCache(std::span<std::uint32_t const> indices,
+                         std::size_t vertexCount, std::size_t cacheSize) {
+  VertexCache cache{vertexCount, cacheSize};
+  std::vector<bool> referenced(vertexCount);
+  VertexCacheStatistics statistics;
+  for (auto const index : indices) {
+    statistics.vertexTransforms += cache.access(index) ? 1U : 0U;
+    referenced.at(index) = true;
+  }
+
+  auto const triangleCount{indices.size() / 3};
+  auto const referencedCount{std::ranges::count(referenced, true)};
+  if (triangleCount > 0) {
+    statistics.acmr = static_cast<float>(statistics.vertexTransforms) /
+                      static_cast<float>(triangleCount);
+    statistics.atvr = static_cast<float>(statistics.vertexTransforms) /
+                      static_cast<float>(referencedCount);
+  }
+  return statistics;
+}
+
+/**
+ * @brief Reorders the triangles to reduce the number of vertex shader
+ * invocations.
+ *
+ * Uses the Tipsify algorithm (Sander, Nehab and Barczak, "Fast Triangle
+ * Reordering for Vertex Locality and Reduced Overdraw", 2007), which runs in
+ * linear time. Triangles are emitted in fans around vertices that are likely
+ * to still be in the cache.
+ *
+ * @param indices Index buffer of a triangle list, reordered in place.
+ * @param vertexCount Number of vertices of the vertex buffer.
+ * @param cacheSize Number of entries of the target cache.
+ */
+void abcg::optimizeVertexCache(std::span<std::uint32_t> indices,
+                               std::size_t vertexCount,
+                               std::size_t cacheSize) {
+  if (indices.size() < 3 || vertexCount == 0)
+    return;
+
+  VertexTriangles const adjacency{indices, vertexCount};
+
+  // Number of triangles not yet emitted that use each vertex
+  std::vector<std::size_t> liveTriangles(vertexCount);
+  for (auto const vertex : iter::range(vertexCount)) {
+    liveTriangles[vertex] =
+        adjacency.get(gsl::narrow<std::uint32_t>(vertex)).size();
+  }
+
+  std::vector<std::size_t> timestamps(vertexCount);
+  std::size_t time{cacheSize + 1};
+  std::vector<bool> emitted(indices.size() / 3);
+  std::vector<std::uint32_t> deadEnd;
+  std::vector<std::uint32_t> candidates;
+  std::vector<std::uint32_t> result;
+  result.reserve(indices.size());
+  std::size_t cursor{};
+
+  // Returns the next vertex with live triangles, or nullopt if there are none
+  auto const skipDeadEnd{[&]() -> std::optional<std::uint32_t> {
+    while (!deadEnd.empty()) {
+      auto const vertex{deadEnd.back()};
+      deadEnd.pop_back();
+      if (liveTriangles[vertex] > 0)
+        return vertex;
+    }
+    for (; cursor < vertexCount; ++cursor) {
+      if (liveTriangles[cursor] > 0)
+        return gsl::narrow<std::uint32_t>(cursor);
+    }
+    return std::nullopt;
+  }};
+
+  // Prefers the candidate that entered the cache the earliest, provided its
+  // remaining fan fits in the cache before it is evicted
+  auto const nextVertex{[&]() -> std::optional<std::uint32_t> {
+    std::optional<std::uint32_t> best;
+    std::size_t bestPriority{};
+    for (auto const vertex : candidates) {
+      if (liveTriangles[vertex] == 0)
+        continue;
+      std::size_t priority{};
+      if (auto const age{time - timestamps[vertex]};
+          age + 2 * liveTriangles[vertex] <= cacheSize) {
+        priority = age;
+      }
+      if (!best || priority > bestPriority) {
+        best = vertex;
+        bestPriority = priority;
+      }
+    }
+    return best ? best : skipDeadEnd();
+  }};
+
+  auto fanning{skipDeadEnd()};
+  while (fanning) {
+    candidates.clear();
+    for (auto const triangle : adjacency.get(*fanning)) {
+      if (emitted[triangle])
+        continue;
+      for (std::size_t corner{}; corner < 3; ++corner) {
+        auto const vertex{indices[triangle * 3 + corner]};
+        result.push_back(vertex);
+        deadEnd.push_back(vertex);
+        candidates.push_back(vertex);
+        --liveTriangles[vertex];
+        if (time - timestamps[vertex] > cacheSize) {
+          timestamps[vertex] = time++;
+        }
+      }
+      emitted[triangle] = true;
+    }
+    fanning = nextVertex();
+  }
+
+  std::ranges::copy(result, indices.begin());
+}
+
+/**
+ * @brief Reorders clusters of triangles to reduce overdraw.
+ *
+ * The index buffer is split into clusters that start with a cold vertex
+ * cache, so that they can be reordered without increasing the ACMR of each
+ * cluster by more than `threshold`. Clusters that face away from the center
+ * of the mesh are drawn first, as they are more likely to occlude the other
+ * clusters. This should be used after abcg::optimizeVertexCache.
+ *
+ * @param indices Index buffer of a triangle list, reordered in place.
+ * @param positions Vertex positions.
+ * @param threshold Maximum ratio between the ACMR of a cluster after and
+ * before splitting it.
+ * @param cacheSize Number of entries of the target cache.
+ */
+void abcg::optimizeOverdraw(std::span<std::uint32_t> indices,
+                            std::span<glm::vec3 const> positions,
+                            float threshold, std::size_t cacheSize) {
+  auto const triangleCount{indices.size() / 3};
+  if (triangleCount < 2)
+    return;
+
+  // Hard boundaries: the first triangle, and triangles whose three vertices
+  // miss the cache. The cache is effectively cold at these points
+  std::vector<std::size_t> hardBoundaries{0};
+  {
+    VertexCache cache{positions.size(), cacheSize};
+    for (auto const triangle : iter::range(triangleCount)) {
+      if (cache.access(indices, triangle) == 3 && triangle > 0) {
+        hardBoundaries.push_back(triangle);
+      }
+    }
+    hardBoundaries.push_back(triangleCount);
+  }
+
+  // Soft boundaries: split each hard cluster as soon as the ACMR since the
+  // last split is within the threshold of the ACMR of the whole cluster
+  std::vector<std::size_t> boundaries;
+  VertexCache cache{positions.size(), cacheSize};
+  for (auto const cluster : iter::range(hardBoundaries.size() - 1)) {
+    auto const begin{hardBoundaries[cluster]};
+    auto const end{hardBoundaries[cluster + 1]};
+
+    cache.clear();
+    std::size_t clusterMisses{};
+    for (auto const triangle : iter::range(begin, end)) {
+      clusterMisses += cache.access(indices, triangle);
+    }
+    auto const maxACMR{threshold * static_cast<float>(clusterMisses) /
+                       static_cast<float>(end - begin)};
+
+    cache.clear();
+    boundaries.push_back(begin);
+    std::size_t start{begin};
+    std::size_t misses{};
+    for (auto const triangle : iter::range(begin, end)) {
+      misses += cache.access(indices, triangle);
+      auto const acmr{static_cast<float>(misses) /
+                      static_cast<float>(triangle - start + 1)};
+      if (acmr <= maxACMR && triangle + 1 < end) {
+        boundaries.push_back(triangle + 1);
+        start = triangle + 1;
+        misses = 0;
+        cache.clear();
+      }
+    }
+  }
+  boundaries.push_back(triangleCount);
+
+  // Area-weighted centroid of the mesh and of each cluster, and area-weighted
+  // normal of each cluster
+  auto const triangleData{[&](std::size_t triangle) {
+    auto const &a{positions[indices[triangle * 3 + 0]]};
+    auto const &b{positions[indices[triangle * 3 + 1]]};
+    auto const &c{positions[indices[triangle * 3 + 2]]};
+    auto const normal{glm::cross(b - a, c - a)};
+    return std::pair{(a + b + c) / 3.0f, normal};
+  }};
+
+  auto const clusterCount{boundaries.size() - 1};
+  std::vector<glm::vec3> clusterCentroids(clusterCount);
+  std::vector<glm::vec3> clusterNormals(clusterCount);
+  glm::vec3 meshCentroid{};
+  float meshArea{};
+  for (auto const cluster : iter::range(clusterCount)) {
+    float clusterArea{};
+    for (auto const triangle :
+         iter::range(boundaries[cluster], boundaries[cluster + 1])) {
+      auto const [centroid, normal]{triangleData(triangle)};
+      auto const area{glm::length(normal)};
+      clusterCentroids[cluster] += centroid * area;
+      clusterNormals[cluster] += normal;
+      clusterArea += area;
+    }
+    meshCentroid += clusterCentroids[cluster];
+    meshArea += clusterArea;
+    if (clusterArea > 0.0f) {
+      clusterCentroids[cluster] /= clusterArea;
+    }
+  }
+  if (meshArea > 0.0f) {
+    meshCentroid /= meshArea;
+  }
+
+  std::vector<float> sortKeys(clusterCount);
+  for (auto const cluster : iter::range(clusterCount)) {
+    auto const &normal{clusterNormals[cluster]};
+    auto const length{glm::length(normal)};
+    sortKeys[cluster] =
+        length > 0.0f ? glm::dot(clusterCentroids[cluster] - meshCentroid,
+                                 normal / length)
+                      : 0.0f;
+  }
+
+  std::vector<std::size_t> order(clusterCount);
+  std::iota(order.begin(), order.end(), std::size_t{});
+  std::ranges::stable_sort(order, [&](auto lhs, auto rhs) {
+    return sortKeys[lhs] > sortKeys[rhs];
+  });
+
+  std::vector<std::uint32_t> result;
+  result.reserve(indices.size());
+  for (auto const cluster : order) {
+    auto const first{indices.begin() +
+                     gsl::narrow<std::ptrdiff_t>(boundaries[cluster] * 3)};
+    auto const last{indices.begin() +
+                    gsl::narrow<std::ptrdiff_t>(boundaries[cluster + 1] * 3)};
+    result.insert(result.end(), first, last);
+  }
+  std::ranges::copy(result, indices.begin());
+}
+
+/**
+ * @brief Renumbers the vertices in the order they are first used by the
+ * index buffer.
+ *
+ * Vertices that are used together become adjacent in memory, which improves
+ * the locality of the vertex fetches. This should be used after
+ * abcg::optimizeVertexCache and abcg::optimizeOverdraw. The vertex buffer must
+ * then be reordered with abcg::remapVertices.
+ *
+ * @param indices Index buffer of a triangle list, renumbered in place.
+ * @param vertexCount Number of vertices of the vertex buffer.
+ *
+ * @return Remap table with the new position of each vertex, or
+ * abcg::unusedVertex for vertices that are not used by any triangle.
+ */
+std::vector<std::uint32_t>
+abcg::optimizeVertexFetch(std::span<std::uint32_t> indices,
+                          std::size_t vertexCount) {
+  std::vector<std::uint32_t> remap(vertexCount, unusedVertex);
+  std::uint32_t next{};
+  for (auto &index : indices) {
+    auto &target{remap.at(index)};
+    if (target == unusedVertex) {
+      target = next++;
+    }
+    index = target;
+  }
+  return remap;
+}
+
+/**
+ * @brief Converts positions to half-precision floating point.
+ *
+ * The positions are padded to four components (with w = 1) so that each
+ * vertex is 8 bytes, which keeps the attribute 4-byte aligned. The result can
+ * be used with a vertex attribute of type `GL_HALF_FLOAT` or
+ * `VK_FORMAT_R16G16B16A16_SFLOAT`.
+ *
+ * Half-precision floats have 11 bits of precision, which is enough for
+ * meshes that are centered at the origin and have a size of a few units.
+ *
+ * @param positions Vertex positions.
+ *
+ * @return Positions as half-precision floats.
+ */
+std::vector<glm::u16vec4>
+abcg::quantizePositions(std::span<glm::vec3 const> positions) {
+  std::vector<glm::u16vec4> result;
+  result.reserve(positions.size());
+  for (auto const &position : positions) {
+    result.push_back(glm::packHalf(glm::vec4{position, 1.0f}));
+  }
+  return result;
+}
+
+/**
+ * @brief Returns the smallest index size for a vertex buffer.
+ *
+ * 16-bit indices are used if all vertices can be addressed by them. The
+ * index 0xFFFF is not used, so that it can be the primitive restart index.
+ *
+ * @param vertexCount Number of vertices of the vertex buffer.
+ *
+ * @return 2 for 16-bit indices, or 4 for 32-bit indices.
+ */
+std::size_t abcg::selectIndexSize(std::size_t vertexCount) noexcept {
+  return vertexCount <= std::numeric_limits<std::uint16_t>::max()
+             ? sizeof(std::uint16_t)
+             : sizeof(std::uint32_t);
+}
+
+/**
+ * @brief Converts an index buffer to 16-bit or 32-bit indices.
+ *
+ * @param indices Index buffer with 32-bit indices.
+ * @param indexSize Size of each index of the result (2 or 4), as returned by
+ * abcg::selectIndexSize.
+ *
+ * @return Index buffer with the given index size.
+ */
+std::vector<std::byte>
+abcg::packIndices(std::span<std::uint32_t const> indices,
+                  std::size_t indexSize) {
+  std::vector<std::byte> indexData(indices.size() * indexSize);
+  if (indexSize == sizeof(std::uint16_t)) {
+    auto *destination{indexData.data()};
+    for (auto const index : indices) {
+      auto const index16{gsl::narrow_cast<std::uint16_t>(index)};
+      std::memcpy(destination, &index16, sizeof(index16));
+      destination += sizeof(index16);
+    }
+  } else {
+    std::memcpy(indexData.data(), indices.data(), indexData.size());
+  }
+  return indexData;
+}
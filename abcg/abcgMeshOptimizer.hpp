@@ -0,0 +1,116 @@
+/**
+ * @file abcgMeshOptimizer.hpp
+ * @brief Declaration of mesh optimization functions.
+ *
+ * Functions for reordering and compressing the vertex and index buffers of
+ * indexed triangle lists, and for measuring the efficiency of the
+ * post-transform vertex cache.
+ *
+ * This file is part of ABCg (https://github.com/hbatagelo/abcg).
+ *
+ * @copyright (c) 2021--2023 Harlen Batagelo. All rights reserved.
+ * This project is released under the MIT License.
+ */
+
+#ifndef ABCG_MESH_OPTIMIZER_HPP_
+#define ABCG_MESH_OPTIMIZER_HPP_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <vector>
+
+#include "abcgExternal.hpp"
+
+namespace abcg {
+
+/**
+ * @brief Default number of entries of the simulated post-transform vertex
+ * cache.
+ */
+constexpr std::size_t defaultVertexCacheSize{16};
+
+/**
+ * @brief Value of a remap table for vertices that are not referenced by any
+ * triangle.
+ */
+constexpr std::uint32_t unusedVertex{std::numeric_limits<std::uint32_t>::max()};
+
+/**
+ * @brief Efficiency of the post-transform vertex cache for an index buffer.
+ */
+struct VertexCacheStatistics {
+  /** @brief Number of vertex shader invocations (cache misses). */
+  std::size_t vertexTransforms{};
+  /**
+   * @brief Average cache miss ratio: transforms per triangle.
+   *
+   * Ranges from 0.5 (best case for a regular grid) to 3.0 (no reuse).
+   */
+  float acmr{};
+  /**
+   * @brief Average transform to vertex ratio: transforms per referenced
+   * vertex.
+   *
+   * 1.0 is optimal, as each vertex is transformed exactly once.
+   */
+  float atvr{};
+};
+
+[[nodiscard]] VertexCacheStatistics
+analyzeVertexCache(std::span<std::uint32_t const> indices,
+                   std::size_t vertexCount,
+                   std::size_t cacheSize = defaultVertexCacheSize);
+
+void optimizeVertexCache(std::span<std::uint32_t> indices,
+                         std::size_t vertexCount,
+                         std::size_t cacheSize = defaultVertexCacheSize);
+
+void optimizeOverdraw(std::span<std::uint32_t> indices,
+                      std::span<glm::vec3 const> positions,
+                      float threshold = 1.05f,
+                      std::size_t cacheSize = defaultVertexCacheSize);
+
+[[nodiscard]] std::vector<std::uint32_t>
+optimizeVertexFetch(std::span<std::uint32_t> indices, std::size_t vertexCount);
+
+/**
+ * @brief Reorders a vertex buffer with a remap table.
+ *
+ * @tparam T Type of the vertex.
+ *
+ * @param vertices Vertex buffer.
+ * @param remap Remap table returned by abcg::optimizeVertexFetch.
+ *
+ * @return Vertex buffer in which each vertex is moved to its new position.
+ * Vertices mapped to abcg::unusedVertex are dropped.
+ */
+template <typename T>
+[[nodiscard]] std::vector<T>
+remapVertices(std::span<T const> vertices,
+              std::span<std::uint32_t const> remap) {
+  // The new positions are dense, so the size is the number of used vertices
+  std::vector<T> result(gsl::narrow<std::size_t>(
+      std::ranges::count_if(remap, [](auto target) {
+        return target != unusedVertex;
+      })));
+  for (auto const index : iter::range(vertices.size())) {
+    if (auto const target{remap[index]}; target != unusedVertex) {
+      result[target] = vertices[index];
+    }
+  }
+  return result;
+}
+
+[[nodiscard]] std::vector<glm::u16vec4>
+quantizePositions(std::span<glm::vec3 const> positions);
+
+[[nodiscard]] std::size_t selectIndexSize(std::size_t vertexCount) noexcept;
+[[nodiscard]] std::vector<std::byte>
+packIndices(std::span<std::uint32_t const> indices, std::size_t indexSize);
+
+} // namespace abcg
+
+#endif
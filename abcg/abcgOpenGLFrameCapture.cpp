@@ -0,0 +1,228 @@
+/**
+ * @file abcgOpenGLFrameCapture.cpp
+ * @brief Definition of abcg::OpenGLFrameCapture members.
+ *
+ * This file is part of ABCg (https://github.com/hbatagelo/abcg).
+ *
+ * @copyright (c) 2021--2023 Harlen Batagelo. All rights reserved.
+ * This project is released under the MIT License.
+ */
+
+#include "abcgOpenGLFrameCapture.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#include <SDL_image.h>
+#include <cppitertools/itertools.hpp>
+#include <gsl/gsl>
+
+#include "abcgTrace.hpp"
+
+namespace {
+constexpr auto channels{4};
+
+[[nodiscard]] GLsizeiptr getByteSize(glm::ivec2 const &size) {
+  return gsl::narrow<GLsizeiptr>(size.x) * size.y * channels;
+}
+} // namespace
+
+/**
+ * @brief Creates the pixel pack buffers and starts the worker thread.
+ *
+ * Must be called with the OpenGL context current.
+ */
+void abcg::OpenGLFrameCapture::create() {
+#if !defined(__EMSCRIPTEN__)
+  for (auto &slot : m_slots) {
+    glGenBuffers(1, &slot.buffer);
+  }
+  m_current = 0;
+  m_worker = std::jthread{
+      [this](std::stop_token const &stopToken) { workerLoop(stopToken); }};
+#endif
+}
+
+/**
+ * @brief Saves the pending captures and releases the buffers.
+ *
+ * Blocks until all captures are saved.
+ */
+void abcg::OpenGLFrameCapture::destroy() {
+#if !defined(__EMSCRIPTEN__)
+  for (auto &slot : m_slots) {
+    if (slot.fence != nullptr) {
+      retrieve(slot);
+    }
+    glDeleteBuffers(1, &slot.buffer);
+    slot = {};
+  }
+
+  // The worker saves the remaining jobs before it stops
+  if (m_worker.joinable()) {
+    m_worker.request_stop();
+    m_worker.join();
+  }
+#endif
+}
+
+/**
+ * @brief Starts the capture of the current frame.
+ *
+ * Must be called after the frame is rendered, and before the buffers are
+ * swapped.
+ *
+ * @param filename Path of the PNG file to be written.
+ * @param size Size of the framebuffer, in pixels.
+ * @param readBuffer Color buffer to be read (`GL_BACK` or `GL_FRONT`).
+ */
+void abcg::OpenGLFrameCapture::capture(std::string_view filename,
+                                       glm::ivec2 const &size,
+                                       GLenum readBuffer) {
+  ABCG_TRACE_ZONE("captureFrame", "screenshot", filename);
+
+  glReadBuffer(readBuffer);
+
+#if defined(__EMSCRIPTEN__)
+  std::vector<unsigned char> pixels(
+      gsl::narrow<std::size_t>(getByteSize(size)));
+  glReadPixels(0, 0, size.x, size.y, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+  savePNG(filename, size, pixels);
+#else
+  auto &slot{m_slots.at(m_current)};
+  m_current = (m_current + 1) % m_slots.size();
+
+  // The slot is still in use if captures are requested faster than the GPU
+  // completes them
+  if (slot.fence != nullptr) {
+    retrieve(slot);
+  }
+
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+  if (auto const byteSize{getByteSize(size)}; byteSize > slot.capacity) {
+    glBufferData(GL_PIXEL_PACK_BUFFER, byteSize, nullptr, GL_STREAM_READ);
+    slot.capacity = byteSize;
+  }
+  // Reads into the buffer object; returns without waiting for the GPU
+  glReadPixels(0, 0, size.x, size.y, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+  slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  slot.size = size;
+  slot.filename = filename;
+#endif
+}
+
+/**
+ * @brief Hands the captures whose readback has completed to the worker
+ * thread.
+ *
+ * Does not block. Must be called once per frame.
+ */
+void abcg::OpenGLFrameCapture::update() {
+#if !defined(__EMSCRIPTEN__)
+  // Visit the slots from the oldest to the newest capture
+  for (auto const offset : iter::range(m_slots.size())) {
+    auto &slot{m_slots.at((m_current + offset) % m_slots.size())};
+    if (slot.fence == nullptr)
+      continue;
+
+    if (auto const status{glClientWaitSync(slot.fence, 0, 0)};
+        status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+      break;
+
+    retrieve(slot);
+  }
+#endif
+}
+
+/**
+ * @brief Flips the rows of an image read with `glReadPixels` and saves it as a
+ * PNG file.
+ *
+ * @param filename Path of the PNG file to be written.
+ * @param size Image size, in pixels.
+ * @param pixels RGBA pixels, from the bottom to the top row. They are flipped
+ * in place.
+ */
+void abcg::OpenGLFrameCapture::savePNG(std::string_view filename,
+                                       glm::ivec2 const &size,
+                                       std::vector<unsigned char> &pixels) {
+  ABCG_TRACE_ZONE("savePNG", "screenshot", filename);
+
+  auto const bitsPerPixel{8};
+  auto const pitch{gsl::narrow<long>(size.x * channels)};
+
+  // Flip upside down
+  for (auto const line : iter::range(size.y / 2)) {
+    std::swap_ranges(pixels.begin() + pitch * line,
+                     pixels.begin() + pitch * (line + 1),
+                     pixels.begin() + pitch * (size.y - line - 1));
+  }
+
+  if (auto *const surface{SDL_CreateRGBSurfaceFrom(
+          pixels.data(), size.x, size.y, channels * bitsPerPixel,
+          gsl::narrow<int>(pitch), 0x000000FF, 0x0000FF00, 0x00FF0000,
+          0xFF000000)}) {
+    IMG_SavePNG(surface, std::string{filename}.c_str());
+    SDL_FreeSurface(surface);
+  }
+}
+
+// Waits for the readback of the slot, copies the pixels from the mapped buffer
+// and queues them for the worker thread
+void abcg::OpenGLFrameCapture::retrieve(Slot &slot) {
+  ABCG_TRACE_ZONE("retrieveCapture", "screenshot");
+
+  // Waits up to 1 s at a time, flushing the commands on the first wait
+  auto flags{GLbitfield{GL_SYNC_FLUSH_COMMANDS_BIT}};
+  while (true) {
+    auto const status{glClientWaitSync(slot.fence, flags, 1'000'000'000)};
+    if (status != GL_TIMEOUT_EXPIRED)
+      break;
+    flags = 0;
+  }
+  glDeleteSync(slot.fence);
+  slot.fence = nullptr;
+
+  auto const byteSize{getByteSize(slot.size)};
+  Job job{.filename = std::move(slot.filename),
+          .size = slot.size,
+          .pixels = std::vector<unsigned char>(
+              gsl::narrow<std::size_t>(byteSize))};
+
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+  if (auto const *data{
+          glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, byteSize, GL_MAP_READ_BIT)};
+      data != nullptr) {
+    std::memcpy(job.pixels.data(), data, job.pixels.size());
+    glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+
+    {
+      std::unique_lock lock{m_mutex};
+      m_spaceAvailable.wait(lock,
+                            [this] { return m_jobs.size() < queueSize; });
+      m_jobs.push_back(std::move(job));
+    }
+    m_jobAvailable.notify_one();
+  }
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
+void abcg::OpenGLFrameCapture::workerLoop(std::stop_token const &stopToken) {
+  while (true) {
+    Job job;
+    {
+      std::unique_lock lock{m_mutex};
+      // Returns false only if stop was requested and there are no jobs left
+      if (!m_jobAvailable.wait(lock, stopToken,
+                               [this] { return !m_jobs.empty(); })) {
+        return;
+      }
+      job = std::move(m_jobs.front());
+      m_jobs.pop_front();
+    }
+    m_spaceAvailable.notify_one();
+    savePNG(job.filename, job.size, job.pixels);
+  }
+}
@@ -0,0 +1,101 @@
+/**
+ * @file abcgOpenGLFrameCapture.hpp
+ * @brief Header file of abcg::OpenGLFrameCapture.
+ *
+ * Declaration of abcg::OpenGLFrameCapture.
+ *
+ * This file is part of ABCg (https://github.com/hbatagelo/abcg).
+ *
+ * @copyright (c) 2021--2023 Harlen Batagelo. All rights reserved.
+ * This project is released under the MIT License.
+ */
+
+#ifndef ABCG_OPENGL_FRAME_CAPTURE_HPP_
+#define ABCG_OPENGL_FRAME_CAPTURE_HPP_
+
+#include <array>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <glm/vec2.hpp>
+
+#include "abcgOpenGLExternal.hpp"
+
+namespace abcg {
+class OpenGLFrameCapture;
+} // namespace abcg
+
+/**
+ * @brief Captures frames to PNG files without stalling the pipeline.
+ *
+ * abcg::OpenGLFrameCapture::capture issues a `glReadPixels` into one of a ring
+ * of abcg::OpenGLFrameCapture::latency `GL_PIXEL_PACK_BUFFER` objects,
+ * followed by a fence. The copy is done by the GPU asynchronously.
+ * abcg::OpenGLFrameCapture::update maps the buffers whose fences are signaled,
+ * usually one or two frames later, and hands the pixels to a worker thread
+ * that flips the rows and encodes the PNG file. The render thread waits only if
+ * a buffer is reused before its fence is signaled, or if
+ * abcg::OpenGLFrameCapture::queueSize frames are already waiting to be saved.
+ *
+ * On WebGL, pixel pack buffers cannot be mapped, so frames are read and saved
+ * synchronously.
+ *
+ * abcg::OpenGLWindow owns a frame capture, which is used through
+ * abcg::OpenGLWindow::captureScreenshotPNG.
+ */
+class abcg::OpenGLFrameCapture {
+public:
+  /** @brief Number of pixel pack buffers in the ring. */
+  static constexpr std::size_t latency{3};
+  /**
+   * @brief Maximum number of frames waiting to be saved. When the queue is
+   * full, the render thread waits for the worker thread.
+   */
+  static constexpr std::size_t queueSize{4};
+
+  void create();
+  void destroy();
+
+  void capture(std::string_view filename, glm::ivec2 const &size,
+               GLenum readBuffer);
+  void update();
+
+  static void savePNG(std::string_view filename, glm::ivec2 const &size,
+                      std::vector<unsigned char> &pixels);
+
+private:
+  struct Slot {
+    GLuint buffer{};
+    GLsync fence{};
+    GLsizeiptr capacity{};
+    glm::ivec2 size{};
+    std::string filename;
+  };
+
+  struct Job {
+    std::string filename;
+    glm::ivec2 size{};
+    std::vector<unsigned char> pixels;
+  };
+
+  void retrieve(Slot &slot);
+  void workerLoop(std::stop_token const &stopToken);
+
+  std::array<Slot, latency> m_slots{};
+  std::size_t m_current{};
+
+  std::mutex m_mutex;
+  std::condition_variable_any m_jobAvailable;
+  std::condition_variable m_spaceAvailable;
+  std::deque<Job> m_jobs;
+  // Declared last so that the thread is joined before the members above are
+  // destroyed
+  std::jthread m_worker;
+};
+
+#endif
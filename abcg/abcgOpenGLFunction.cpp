@@ -12,6 +12,37 @@
 #include "abcgOpenGLError.hpp"
 
 #if !defined(NDEBUG) && !defined(__EMSCRIPTEN__) && !defined(__APPLE__)
+#include <string>
+#include <utility>
+
+#include <fmt/core.h>
+#include <gsl/gsl>
+
+namespace {
+// NOLINTNEXTLINE(cppcoreguidelines-avoid-non-const-global-variables)
+thread_local std::string pendingMessage;
+
+void GLAPIENTRY debugMessageCallback(GLenum source, GLenum type,
+                                     GLuint /*id*/, GLenum /*severity*/,
+                                     GLsizei length, GLchar const *message,
+                                     void const * /*userParam*/) {
+  // Other messages are disabled with glDebugMessageControl, but are filtered
+  // here too as they must not be reported as exceptions. Shader compiler
+  // errors are left to the compile and link status checks, which print the
+  // info log.
+  if (source != GL_DEBUG_SOURCE_API || type != GL_DEBUG_TYPE_ERROR)
+    return;
+
+  // Keep the first message until it is consumed by checkGLDebugMessage
+  if (abcg::glDebugMessagePending)
+    return;
+
+  pendingMessage =
+      length < 0 ? std::string{message}
+                 : std::string{message, gsl::narrow<std::size_t>(length)};
+  abcg::glDebugMessagePending = true;
+}
+} // namespace
 /**
  * @brief Checks OpenGL error status and throws on error with a log message.
  *
@@ -29,4 +60,88 @@ void abcg::checkGLError(source_location const &sourceLocation,
     throw abcg::OpenGLError(appendString, status, sourceLocation);
   }
 }
+
+/**
+ * @brief Throws the OpenGL error reported by the KHR_debug callback.
+ *
+ * @param sourceLocation Information about the source code, to be used for
+ * logging.
+ * @param appendString A string to be appended to "OpenGL error " in the
+ * exception explanatory string.
+ *
+ * @throw abcg::Exception::OpenGLError.
+ *
+ * @remark Must be called only if abcg::glDebugMessagePending is set.
+ */
+void abcg::checkGLDebugMessage(source_location const &sourceLocation,
+                               std::string_view const appendString) {
+  auto const message{
+      fmt::format("{}: {}", appendString, std::exchange(pendingMessage, {}))};
+  glDebugMessagePending = false;
+  // The error flag is still set, as it is not cleared by the callback
+  throw abcg::OpenGLError(message, glGetError(), sourceLocation);
+}
+
+/**
+ * @brief Enables reporting of OpenGL errors through a KHR_debug callback.
+ *
+ * When enabled, the error checking wrappers of OpenGL functions no longer
+ * call `glGetError` before and after each call. Instead, debug output is set
+ * to synchronous mode, so that the callback is invoked by the thread that
+ * issued the failing command, before the command returns. The wrapper only
+ * tests a flag set by the callback.
+ *
+ * Only errors from the API source are reported. Shader compiler messages are
+ * ignored so that compile and link failures are reported with the info log.
+ *
+ * Requires OpenGL 4.3 or the `GL_KHR_debug` extension. The context should be
+ * created with the debug flag, as drivers may not generate messages
+ * otherwise. If debug output is unavailable, `glGetError` polling is kept.
+ *
+ * Must be called with the OpenGL context current.
+ *
+ * @return True if debug output was enabled, false otherwise.
+ */
+bool abcg::enableGLDebugOutput() {
+  if (GLEW_VERSION_4_3 == 0 && GLEW_KHR_debug == 0)
+    return false;
+
+  // Poll errors generated before this point
+  checkGLError(source_location::current(), "BEFORE enabling debug output");
+
+  ::glEnable(GL_DEBUG_OUTPUT);
+  ::glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+  ::glDebugMessageCallback(debugMessageCallback, nullptr);
+  ::glDebugMessageControl(GL_DONT_CARE, GL_DONT_CARE, GL_DONT_CARE, 0, nullptr,
+                          GL_FALSE);
+  ::glDebugMessageControl(GL_DEBUG_SOURCE_API, GL_DEBUG_TYPE_ERROR,
+                          GL_DONT_CARE, 0, nullptr, GL_TRUE);
+
+  if (::glGetError() != GL_NO_ERROR) {
+    ::glDebugMessageCallback(nullptr, nullptr);
+    ::glDisable(GL_DEBUG_OUTPUT);
+    return false;
+  }
+
+  glDebugMessagePending = false;
+  glDebugOutputEnabled = true;
+  return true;
+}
+
+/**
+ * @brief Disables the KHR_debug callback and restores `glGetError` polling.
+ *
+ * Must be called with the OpenGL context current.
+ */
+void abcg::disableGLDebugOutput() {
+  if (!glDebugOutputEnabled)
+    return;
+
+  ::glDebugMessageCallback(nullptr, nullptr);
+  ::glDisable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+  ::glDisable(GL_DEBUG_OUTPUT);
+  glDebugOutputEnabled = false;
+  glDebugMessagePending = false;
+  pendingMessage.clear();
+}
 #endif
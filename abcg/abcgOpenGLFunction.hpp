@@ -45,10 +45,37 @@ namespace abcg {
 
 void checkGLError(source_location const &sourceLocation,
                   std::string_view appendString);
+void checkGLDebugMessage(source_location const &sourceLocation,
+                         std::string_view appendString);
+bool enableGLDebugOutput();
+void disableGLDebugOutput();
+
+// @cond Skipped by Doxygen
+// NOLINTBEGIN(cppcoreguidelines-avoid-non-const-global-variables)
+// Whether errors are reported by the KHR_debug callback
+inline bool glDebugOutputEnabled{};
+// Set by the KHR_debug callback when an error is reported on this thread
+inline thread_local bool glDebugMessagePending{};
+// NOLINTEND(cppcoreguidelines-avoid-non-const-global-variables)
+// @endcond
+
+/**
+ * @brief Returns whether OpenGL errors are being reported through the
+ * KHR_debug callback instead of being polled with `glGetError`.
+ *
+ * @sa abcg::enableGLDebugOutput.
+ */
+[[nodiscard]] inline bool isGLDebugOutputEnabled() noexcept {
+  return glDebugOutputEnabled;
+}
 
 /**
  * @brief Checks for OpenGL errors before and after a function call.
  *
+ * If the KHR_debug callback is enabled, the checks only test a thread-local
+ * flag set by the callback, and `glGetError` is called only when an error was
+ * reported. Otherwise, `glGetError` is polled before and after the call.
+ *
  * @tparam TFun Function typename.
  * @tparam TArgs Variadic arguments typename.
  *
@@ -61,6 +88,26 @@ void checkGLError(source_location const &sourceLocation,
 template <typename TFun, typename... TArgs>
 auto callGL(source_location const &sourceLocation, TFun &&function,
             TArgs &&...args) {
+  if (glDebugOutputEnabled) {
+    // An error reported here comes from a call not wrapped by ABCg
+    if (glDebugMessagePending) {
+      checkGLDebugMessage(sourceLocation, "BEFORE function call");
+    }
+    if constexpr (!std::is_void_v<std::invoke_result_t<TFun, TArgs...>>) {
+      auto &&res{std::forward<TFun>(function)(std::forward<TArgs>(args)...)};
+      if (glDebugMessagePending) {
+        checkGLDebugMessage(sourceLocation, "AFTER function call");
+      }
+      return res;
+    } else {
+      std::forward<TFun>(function)(std::forward<TArgs>(args)...);
+      if (glDebugMessagePending) {
+        checkGLDebugMessage(sourceLocation, "AFTER function call");
+      }
+      return;
+    }
+  }
+
   checkGLError(sourceLocation, "BEFORE function call");
   if constexpr (!std::is_void_v<std::invoke_result_t<TFun, TArgs...>>) {
     // Specialization for functions that do not return void
@@ -10,26 +10,206 @@
 
 #include "abcgOpenGLImage.hpp"
 #include "abcgImage.hpp"
+#include "abcgKTX2.hpp"
+
+#include <array>
+#include <optional>
 
 #include <cppitertools/itertools.hpp>
 #include <fmt/core.h>
 #include <gsl/gsl>
 
 #include "abcgException.hpp"
+#include "abcgTrace.hpp"
+
+namespace {
+// Extension (or core version) required by a format
+enum class Compression { None, S3TC, RGTC, BPTC, ETC2, ASTC };
+
+struct OpenGLFormat {
+  GLenum internalFormat{};
+  GLenum format{};
+  GLenum type{};
+  Compression compression{};
+};
+
+// Internal formats of the BC and ETC2/EAC formats, in the order of their
+// VkFormat values (VK_FORMAT_BC1_RGB_UNORM_BLOCK to
+// VK_FORMAT_EAC_R11G11_SNORM_BLOCK). The values are not defined by the GLES3
+// headers.
+constexpr GLenum firstBCFormat{131};
+constexpr GLenum lastETC2Format{156};
+constexpr std::array<GLenum, 26> blockCompressedFormats{
+    0x83F0, // GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+    0x8C4C, // GL_COMPRESSED_SRGB_S3TC_DXT1_EXT
+    0x83F1, // GL_COMPRESSED_RGBA_S3TC_DXT1_EXT
+    0x8C4D, // GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT
+    0x83F2, // GL_COMPRESSED_RGBA_S3TC_DXT3_EXT
+    0x8C4E, // GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT3_EXT
+    0x83F3, // GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+    0x8C4F, // GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT
+    0x8DBB, // GL_COMPRESSED_RED_RGTC1
+    0x8DBC, // GL_COMPRESSED_SIGNED_RED_RGTC1
+    0x8DBD, // GL_COMPRESSED_RG_RGTC2
+    0x8DBE, // GL_COMPRESSED_SIGNED_RG_RGTC2
+    0x8E8F, // GL_COMPRESSED_RGB_BPTC_UNSIGNED_FLOAT
+    0x8E8E, // GL_COMPRESSED_RGB_BPTC_SIGNED_FLOAT
+    0x8E8C, // GL_COMPRESSED_RGBA_BPTC_UNORM
+    0x8E8D, // GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM
+    0x9274, // GL_COMPRESSED_RGB8_ETC2
+    0x9275, // GL_COMPRESSED_SRGB8_ETC2
+    0x9276, // GL_COMPRESSED_RGB8_PUNCHTHROUGH_ALPHA1_ETC2
+    0x9277, // GL_COMPRESSED_SRGB8_PUNCHTHROUGH_ALPHA1_ETC2
+    0x9278, // GL_COMPRESSED_RGBA8_ETC2_EAC
+    0x9279, // GL_COMPRESSED_SRGB8_ALPHA8_ETC2_EAC
+    0x9270, // GL_COMPRESSED_R11_EAC
+    0x9271, // GL_COMPRESSED_SIGNED_R11_EAC
+    0x9272, // GL_COMPRESSED_RG11_EAC
+    0x9273  // GL_COMPRESSED_SIGNED_RG11_EAC
+};
+
+// GL_COMPRESSED_RGBA_ASTC_4x4_KHR and GL_COMPRESSED_SRGB8_ALPHA8_ASTC_4x4_KHR.
+// The other block sizes follow in the order of their VkFormat values.
+constexpr GLenum firstASTCFormat{157};
+constexpr GLenum lastASTCFormat{184};
+constexpr GLenum firstASTCUNorm{0x93B0};
+constexpr GLenum firstASTCSRGB{0x93D0};
+
+// Returns the OpenGL format of a KTX2 format, or std::nullopt if there is none
+std::optional<OpenGLFormat>
+findOpenGLFormat(abcg::KTX2FormatInfo const &info) {
+  switch (info.vkFormat) {
+  case 9: // VK_FORMAT_R8_UNORM
+    return OpenGLFormat{GL_R8, GL_RED, GL_UNSIGNED_BYTE, Compression::None};
+  case 16: // VK_FORMAT_R8G8_UNORM
+    return OpenGLFormat{GL_RG8, GL_RG, GL_UNSIGNED_BYTE, Compression::None};
+  case 23: // VK_FORMAT_R8G8B8_UNORM
+    return OpenGLFormat{GL_RGB8, GL_RGB, GL_UNSIGNED_BYTE, Compression::None};
+  case 29: // VK_FORMAT_R8G8B8_SRGB
+    return OpenGLFormat{GL_SRGB8, GL_RGB, GL_UNSIGNED_BYTE, Compression::None};
+  case 37: // VK_FORMAT_R8G8B8A8_UNORM
+    return OpenGLFormat{GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE,
+                        Compression::None};
+  case 43: // VK_FORMAT_R8G8B8A8_SRGB
+    return OpenGLFormat{GL_SRGB8_ALPHA8, GL_RGBA, GL_UNSIGNED_BYTE,
+                        Compression::None};
+  case 97: // VK_FORMAT_R16G16B16A16_SFLOAT
+    return OpenGLFormat{GL_RGBA16F, GL_RGBA, GL_HALF_FLOAT, Compression::None};
+  case 109: // VK_FORMAT_R32G32B32A32_SFLOAT
+    return OpenGLFormat{GL_RGBA32F, GL_RGBA, GL_FLOAT, Compression::None};
+  default:
+    break;
+  }
+
+  if (info.vkFormat >= firstBCFormat && info.vkFormat <= lastETC2Format) {
+    auto const index{info.vkFormat - firstBCFormat};
+    auto compression{Compression::ETC2};
+    if (index < 8) {
+      compression = Compression::S3TC;
+    } else if (index < 12) {
+      compression = Compression::RGTC;
+    } else if (index < 16) {
+      compression = Compression::BPTC;
+    }
+    return OpenGLFormat{.internalFormat = blockCompressedFormats.at(index),
+                        .compression = compression};
+  }
+
+  if (info.vkFormat >= firstASTCFormat && info.vkFormat <= lastASTCFormat) {
+    auto const index{info.vkFormat - firstASTCFormat};
+    return OpenGLFormat{
+        .internalFormat =
+            (info.sRGB ? firstASTCSRGB : firstASTCUNorm) + index / 2,
+        .compression = Compression::ASTC};
+  }
+
+  return std::nullopt;
+}
+
+// Returns whether the context supports a family of compressed formats. On
+// WebGL, this also enables the extension.
+bool isSupported(Compression compression, bool sRGB) {
+#if defined(__EMSCRIPTEN__)
+  auto const enable{[](char const *extension) {
+    return emscripten_webgl_enable_extension(
+               emscripten_webgl_get_current_context(), extension) == EM_TRUE;
+  }};
+  switch (compression) {
+  case Compression::None:
+    return true;
+  case Compression::S3TC:
+    return enable("WEBGL_compressed_texture_s3tc") &&
+           (!sRGB || enable("WEBGL_compressed_texture_s3tc_srgb"));
+  case Compression::RGTC:
+    return enable("EXT_texture_compression_rgtc");
+  case Compression::BPTC:
+    return enable("EXT_texture_compression_bptc");
+  case Compression::ETC2:
+    return enable("WEBGL_compressed_texture_etc");
+  case Compression::ASTC:
+    return enable("WEBGL_compressed_texture_astc");
+  }
+#else
+  switch (compression) {
+  case Compression::None:
+    return true;
+  case Compression::S3TC:
+    return GLEW_EXT_texture_compression_s3tc != 0 &&
+           (!sRGB || GLEW_VERSION_2_1 != 0 || GLEW_EXT_texture_sRGB != 0);
+  case Compression::RGTC:
+    return GLEW_VERSION_3_0 != 0 || GLEW_ARB_texture_compression_rgtc != 0;
+  case Compression::BPTC:
+    return GLEW_VERSION_4_2 != 0 || GLEW_ARB_texture_compression_bptc != 0;
+  case Compression::ETC2:
+    return GLEW_VERSION_4_3 != 0 || GLEW_ARB_ES3_compatibility != 0;
+  case Compression::ASTC:
+    return GLEW_KHR_texture_compression_astc_ldr != 0;
+  }
+#endif
+  return false;
+}
+} // namespace
 
 /**
  * @brief Creates an OpenGL 2D texture from an image loaded from a filesystem
  * path.
  *
+ * PNG and JPEG images are decoded and uploaded as RGB or RGBA. KTX2 files are
+ * memory-mapped and uploaded with abcg::uploadOpenGLKTX2.
+ *
  * @param createInfo Texture creation settings.
  *
- * @throw abcg::RuntimeError if the image could not be loaded.
+ * @throw abcg::RuntimeError if the image could not be loaded, or if the
+ * format of a KTX2 file is not supported.
  *
  * @return ID of the texture, as generated by glGenTextures.
  */
 GLuint abcg::loadOpenGLTexture(OpenGLTextureCreateInfo const &createInfo) {
+  ABCG_TRACE_ZONE("loadOpenGLTexture", "texture", createInfo.path);
+
   GLuint textureID{};
 
+  if (isKTX2Path(createInfo.path)) {
+    KTX2Texture texture;
+    texture.open(createInfo.path);
+
+    glGenTextures(1, &textureID);
+    glBindTexture(GL_TEXTURE_2D, textureID);
+    try {
+      uploadOpenGLKTX2(texture, createInfo.generateMipmaps);
+    } catch (...) {
+      glBindTexture(GL_TEXTURE_2D, 0);
+      glDeleteTextures(1, &textureID);
+      throw;
+    }
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    return textureID;
+  }
+
   if (SDL_Surface *const surface{IMG_Load(createInfo.path.data())}) {
     // Enforce RGB/RGBA
     GLenum internalFormat{};
@@ -99,6 +279,8 @@ GLuint abcg::loadOpenGLTexture(OpenGLTextureCreateInfo const &createInfo) {
  * @return ID of the texture, as generated by glGenTextures.
  */
 GLuint abcg::loadOpenGLCubemap(OpenGLCubemapCreateInfo const &createInfo) {
+  ABCG_TRACE_ZONE("loadOpenGLCubemap", "texture");
+
   GLuint textureID{};
   glGenTextures(1, &textureID);
   glBindTexture(GL_TEXTURE_CUBE_MAP, textureID);
@@ -160,4 +342,79 @@ GLuint abcg::loadOpenGLCubemap(OpenGLCubemapCreateInfo const &createInfo) {
   }
 
   return textureID;
-}
\ No newline at end of file
+}
+
+/**
+ * @brief Uploads the images of a KTX2 file to the texture bound to
+ * `GL_TEXTURE_2D`.
+ *
+ * All mip levels stored in the file are uploaded as they are, with
+ * `glCompressedTexImage2D` for the BC, ETC2/EAC and ASTC formats, or
+ * `glTexImage2D` for the uncompressed formats. The minifying filter is set to
+ * `GL_LINEAR_MIPMAP_LINEAR` if there is more than one level, and the maximum
+ * level is set to the last level of the file.
+ *
+ * @param texture KTX2 texture with a single layer and face.
+ * @param generateMipmaps Whether to generate mipmap levels if the file stores
+ * a single level. Ignored for compressed formats.
+ *
+ * @throw abcg::RuntimeError if the texture is a cubemap or an array, or if
+ * its format is not supported by the OpenGL context.
+ */
+void abcg::uploadOpenGLKTX2(KTX2Texture const &texture, bool generateMipmaps) {
+  ABCG_TRACE_ZONE("uploadOpenGLKTX2", "texture");
+
+  if (texture.getLayerCount() != 1 || texture.getFaceCount() != 1) {
+    throw abcg::RuntimeError("Only 2D KTX2 textures are supported");
+  }
+
+  auto const &info{texture.getFormat()};
+  auto const format{findOpenGLFormat(info)};
+  if (!format.has_value() || !isSupported(format->compression, info.sRGB)) {
+    throw abcg::RuntimeError(
+        fmt::format("KTX2 format {} is not supported by the OpenGL context",
+                    info.vkFormat));
+  }
+
+  // Rows of uncompressed images are tightly packed
+  if (!info.compressed) {
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  }
+
+  auto const levelCount{texture.getLevelCount()};
+  for (auto const level : iter::range(levelCount)) {
+    auto const image{texture.getImage(level)};
+    auto const width{gsl::narrow<GLsizei>(texture.getWidth(level))};
+    auto const height{gsl::narrow<GLsizei>(texture.getHeight(level))};
+    if (info.compressed) {
+      glCompressedTexImage2D(GL_TEXTURE_2D, gsl::narrow<GLint>(level),
+                             format->internalFormat, width, height, 0,
+                             gsl::narrow<GLsizei>(image.size()), image.data());
+    } else {
+      glTexImage2D(GL_TEXTURE_2D, gsl::narrow<GLint>(level),
+                   gsl::narrow<GLint>(format->internalFormat), width, height,
+                   0, format->format, format->type, image.data());
+    }
+  }
+
+  if (!info.compressed) {
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+  }
+
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+  if (levelCount > 1) {
+    // Truncated mip chains are complete up to the last stored level
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL,
+                    gsl::narrow<GLint>(levelCount - 1));
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
+                    GL_LINEAR_MIPMAP_LINEAR);
+  } else if (generateMipmaps && !info.compressed) {
+    glGenerateMipmap(GL_TEXTURE_2D);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
+                    GL_LINEAR_MIPMAP_LINEAR);
+  } else {
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  }
+}
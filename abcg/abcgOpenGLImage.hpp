@@ -17,6 +17,7 @@
 #include <string_view>
 
 namespace abcg {
+class KTX2Texture;
 struct OpenGLTextureCreateInfo;
 struct OpenGLCubemapCreateInfo;
 
@@ -24,15 +25,24 @@ struct OpenGLCubemapCreateInfo;
 loadOpenGLTexture(OpenGLTextureCreateInfo const &createInfo);
 [[nodiscard]] GLuint
 loadOpenGLCubemap(OpenGLCubemapCreateInfo const &createInfo);
+void uploadOpenGLKTX2(KTX2Texture const &texture, bool generateMipmaps);
 } // namespace abcg
 
 /**
  * @brief Configuration settings for creating a 2D texture for OpenGL.
  */
 struct abcg::OpenGLTextureCreateInfo {
-  /** @brief Path to the image file (PNG or JPEG). */
+  /** @brief Path to the image file (PNG, JPEG or KTX2).
+   *
+   * KTX2 files (`.ktx2` extension) are uploaded as stored, without decoding:
+   * their format, mip levels and orientation are those of the file, and
+   * abcg::OpenGLTextureCreateInfo::flipUpsideDown and
+   * abcg::OpenGLTextureCreateInfo::sRGBToLinear are ignored. Use
+   * `abcg-ktx2convert --flip-y` to create KTX2 files that match the
+   * orientation of flipped PNG and JPEG images. */
   std::string_view path{};
-  /** @brief Whether to generate mipmap levels. */
+  /** @brief Whether to generate mipmap levels. For KTX2 files, mipmap levels
+   * are generated only if the file stores a single uncompressed level. */
   bool generateMipmaps{true};
   /** @brief Whether to flip the image upside down. */
   bool flipUpsideDown{true};
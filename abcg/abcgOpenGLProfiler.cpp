@@ -0,0 +1,140 @@
+/**
+ * @file abcgOpenGLProfiler.cpp
+ * @brief Definition of abcg::OpenGLGPUTimer members.
+ *
+ * This file is part of ABCg (https://github.com/hbatagelo/abcg).
+ *
+ * @copyright (c) 2021--2023 Harlen Batagelo. All rights reserved.
+ * This project is released under the MIT License.
+ */
+
+#include "abcgOpenGLProfiler.hpp"
+
+#if defined(__EMSCRIPTEN__)
+#if !defined(GL_GLEXT_PROTOTYPES)
+#define GL_GLEXT_PROTOTYPES
+#endif
+#include <GLES2/gl2ext.h>
+#endif
+
+#include "abcgExternal.hpp"
+#include "abcgProfiler.hpp"
+
+// @cond Skipped by Doxygen
+#if !defined(GL_TIME_ELAPSED_EXT)
+#define GL_TIME_ELAPSED_EXT 0x88BF
+#endif
+#if !defined(GL_GPU_DISJOINT_EXT)
+#define GL_GPU_DISJOINT_EXT 0x8FBB
+#endif
+// @endcond
+
+/**
+ * @brief Creates the query objects, if timer queries are supported.
+ *
+ * Must be called with the OpenGL context current.
+ *
+ * @param isES Whether the context is OpenGL ES (or WebGL).
+ */
+void abcg::OpenGLGPUTimer::create([[maybe_unused]] bool isES) {
+#if defined(__EMSCRIPTEN__)
+  m_supported =
+      emscripten_webgl_enable_extension(emscripten_webgl_get_current_context(),
+                                        "EXT_disjoint_timer_query_webgl2") ==
+      EM_TRUE;
+#else
+  // Timer queries are not exposed through GLEW for native OpenGL ES contexts
+  m_supported =
+      !isES && (GLEW_VERSION_3_3 != 0 || GLEW_ARB_timer_query != 0);
+#endif
+  if (!m_supported)
+    return;
+
+  for (auto &frame : m_frames) {
+    glGenQueries(static_cast<GLsizei>(frame.queries.size()),
+                 frame.queries.data());
+    frame.count = 0;
+  }
+}
+
+/**
+ * @brief Releases the query objects.
+ */
+void abcg::OpenGLGPUTimer::destroy() {
+  if (!m_supported)
+    return;
+
+  for (auto &frame : m_frames) {
+    glDeleteQueries(static_cast<GLsizei>(frame.queries.size()),
+                    frame.queries.data());
+    frame.count = 0;
+  }
+  m_supported = false;
+}
+
+/**
+ * @brief Starts a new frame.
+ *
+ * Reads back the queries issued abcg::OpenGLGPUTimer::latency frames ago and
+ * reports their results to abcg::Profiler.
+ */
+void abcg::OpenGLGPUTimer::beginFrame() {
+  if (!m_supported)
+    return;
+
+  m_current = (m_current + 1) % latency;
+  auto &frame{m_frames.at(m_current)};
+
+  // A disjoint event (e.g., a GPU frequency change) invalidates all queries in
+  // flight. This is only reported by the WebGL extension.
+  GLint disjoint{};
+#if defined(__EMSCRIPTEN__)
+  glGetIntegerv(GL_GPU_DISJOINT_EXT, &disjoint);
+#endif
+
+  for (auto const index : iter::range(frame.count)) {
+    auto const query{frame.queries.at(index)};
+    GLuint available{};
+    glGetQueryObjectuiv(query, GL_QUERY_RESULT_AVAILABLE, &available);
+    if (available == GL_FALSE || disjoint != 0)
+      continue;
+
+    GLuint64 nanoseconds{};
+#if defined(__EMSCRIPTEN__)
+    glGetQueryObjectui64vEXT(query, GL_QUERY_RESULT, &nanoseconds);
+#else
+    glGetQueryObjectui64v(query, GL_QUERY_RESULT, &nanoseconds);
+#endif
+    Profiler::instance().addGPUSample(frame.passes.at(index),
+                                      static_cast<double>(nanoseconds) * 1e-6);
+  }
+
+  frame.count = 0;
+}
+
+/**
+ * @brief Begins timing a GPU pass.
+ *
+ * @param pass Pass name. Must outlive this object (e.g., a string literal).
+ */
+void abcg::OpenGLGPUTimer::begin(std::string_view pass) {
+  auto &frame{m_frames.at(m_current)};
+  if (!m_supported || m_active || frame.count == maxPasses)
+    return;
+
+  frame.passes.at(frame.count) = pass;
+  glBeginQuery(GL_TIME_ELAPSED_EXT, frame.queries.at(frame.count));
+  m_active = true;
+}
+
+/**
+ * @brief Ends timing the current GPU pass.
+ */
+void abcg::OpenGLGPUTimer::end() {
+  if (!m_active)
+    return;
+
+  glEndQuery(GL_TIME_ELAPSED_EXT);
+  ++m_frames.at(m_current).count;
+  m_active = false;
+}
@@ -0,0 +1,70 @@
+/**
+ * @file abcgOpenGLProfiler.hpp
+ * @brief Header file of abcg::OpenGLGPUTimer.
+ *
+ * Declaration of abcg::OpenGLGPUTimer.
+ *
+ * This file is part of ABCg (https://github.com/hbatagelo/abcg).
+ *
+ * @copyright (c) 2021--2023 Harlen Batagelo. All rights reserved.
+ * This project is released under the MIT License.
+ */
+
+#ifndef ABCG_OPENGL_PROFILER_HPP_
+#define ABCG_OPENGL_PROFILER_HPP_
+
+#include <array>
+#include <string_view>
+
+#include "abcgOpenGLExternal.hpp"
+
+namespace abcg {
+class OpenGLGPUTimer;
+} // namespace abcg
+
+/**
+ * @brief Measures GPU time of sequential passes with `GL_TIME_ELAPSED` queries
+ * and reports it to abcg::Profiler.
+ *
+ * Queries are kept in a ring of abcg::OpenGLGPUTimer::latency frames. The
+ * results of a frame are read back when its slot is reused, so reading them
+ * never stalls the pipeline; results that are still not available by then are
+ * dropped.
+ *
+ * On desktop OpenGL, timer queries are core since OpenGL 3.3. On WebGL 2, they
+ * require `EXT_disjoint_timer_query_webgl2`. They are not used with native
+ * OpenGL ES contexts. If unsupported, all functions do nothing.
+ *
+ * @remark `GL_TIME_ELAPSED` queries cannot be nested, so passes must not
+ * overlap.
+ */
+class abcg::OpenGLGPUTimer {
+public:
+  /** @brief Number of frames between issuing and reading back a query. */
+  static constexpr std::size_t latency{4};
+  /** @brief Maximum number of passes per frame. */
+  static constexpr std::size_t maxPasses{8};
+
+  void create(bool isES);
+  void destroy();
+
+  void beginFrame();
+  void begin(std::string_view pass);
+  void end();
+
+  [[nodiscard]] bool isSupported() const noexcept { return m_supported; }
+
+private:
+  struct Frame {
+    std::array<GLuint, maxPasses> queries{};
+    std::array<std::string_view, maxPasses> passes{};
+    std::size_t count{};
+  };
+
+  std::array<Frame, latency> m_frames{};
+  std::size_t m_current{};
+  bool m_supported{};
+  bool m_active{};
+};
+
+#endif
@@ -14,13 +14,19 @@
 #include <fmt/core.h>
 #include <gsl/gsl>
 
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <exception>
 #include <filesystem>
 #include <fstream>
 #include <regex>
-#include <sstream>
+#include <utility>
 #include <vector>
 
 #include "abcgException.hpp"
+#include "abcgTrace.hpp"
+#include "abcgUtil.hpp"
 
 namespace {
 void printShaderInfoLog(GLuint const shader, std::string_view prefix) {
@@ -85,17 +91,134 @@ void printProgramInfoLog(GLuint const program) {
       !std::filesystem::exists(filenameOrText)) {
     return filenameOrText.data();
   }
-  std::stringstream source;
-  if (std::ifstream stream(filenameOrText.data()); stream) {
-    source << stream.rdbuf();
-    stream.close();
-  } else {
+  std::ifstream stream(filenameOrText.data(), std::ios::binary);
+  if (!stream) {
     throw abcg::RuntimeError(
         fmt::format("Failed to read file {}", filenameOrText));
   }
-  return source.str();
+  // Read directly into the string, without an intermediate stream buffer
+  std::string source(std::filesystem::file_size(filenameOrText), '\0');
+  stream.read(source.data(), gsl::narrow<std::streamsize>(source.size()));
+  source.resize(gsl::narrow<std::size_t>(stream.gcount()));
+  return source;
 }
 
+#if !defined(__EMSCRIPTEN__)
+// NOLINTNEXTLINE(cppcoreguidelines-avoid-non-const-global-variables)
+std::filesystem::path programCachePath;
+
+// Header of a cached program binary
+struct ProgramBinaryHeader {
+  std::array<char, 4> magic{'A', 'B', 'P', 'B'};
+  std::uint32_t format{};
+  std::uint64_t key{};
+};
+
+[[nodiscard]] bool isProgramBinarySupported() {
+  if (GLEW_VERSION_4_1 == 0 && GLEW_ARB_get_program_binary == 0)
+    return false;
+  GLint numFormats{};
+  glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &numFormats);
+  return numFormats > 0;
+}
+
+[[nodiscard]] bool isProgramCacheEnabled() {
+  return !programCachePath.empty() && isProgramBinarySupported();
+}
+
+[[nodiscard]] bool isProgramBinaryFormatSupported(GLenum format) {
+  GLint numFormats{};
+  glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &numFormats);
+  std::vector<GLint> formats(gsl::narrow<std::size_t>(numFormats));
+  glGetIntegerv(GL_PROGRAM_BINARY_FORMATS, formats.data());
+  return std::ranges::find(formats, gsl::narrow<GLint>(format)) !=
+         formats.end();
+}
+
+// A binary is only valid for the same driver, so the driver strings are part
+// of the key
+[[nodiscard]] std::size_t
+programCacheKey(std::vector<abcg::ShaderSource> const &sources) {
+  auto const glString{[](GLenum name) {
+    auto const *str{reinterpret_cast<char const *>(glGetString(name))};
+    return std::string_view{str == nullptr ? "" : str};
+  }};
+  auto key{abcg::hashCombine(glString(GL_VENDOR), glString(GL_RENDERER),
+                             glString(GL_VERSION))};
+  for (auto const &source : sources) {
+    abcg::hashCombineSeed(key, source.source, source.stage);
+  }
+  return key;
+}
+
+[[nodiscard]] std::filesystem::path programCacheFile(std::size_t key) {
+  return programCachePath / fmt::format("{:016x}.bin", key);
+}
+
+// Returns a program created from the cached binary, or 0 if there is no
+// binary for the given key or if it was rejected by the driver
+[[nodiscard]] GLuint loadProgramBinary(std::size_t key) {
+  ABCG_TRACE_ZONE("loadProgramBinary", "shader");
+
+  auto const filename{programCacheFile(key)};
+  std::ifstream stream(filename, std::ios::binary);
+  if (!stream)
+    return 0;
+
+  ProgramBinaryHeader header{};
+  stream.read(reinterpret_cast<char *>(&header), sizeof(header));
+  auto const size{std::filesystem::file_size(filename)};
+  if (!stream || header.magic != ProgramBinaryHeader{}.magic ||
+      header.key != key || size <= sizeof(header)) {
+    return 0;
+  }
+
+  std::vector<char> binary(size - sizeof(header));
+  stream.read(binary.data(), gsl::narrow<std::streamsize>(binary.size()));
+  if (!stream)
+    return 0;
+
+  GLuint program{};
+  // An unknown format would generate GL_INVALID_ENUM
+  if (isProgramBinaryFormatSupported(header.format)) {
+    program = glCreateProgram();
+    glProgramBinary(program, header.format, binary.data(),
+                    gsl::narrow<GLsizei>(binary.size()));
+    GLint linkStatus{};
+    glGetProgramiv(program, GL_LINK_STATUS, &linkStatus);
+    if (linkStatus == GL_TRUE)
+      return program;
+    glDeleteProgram(program);
+  }
+
+  // The binary is outdated (e.g., after a driver update)
+  std::error_code errorCode;
+  std::filesystem::remove(filename, errorCode);
+  return 0;
+}
+
+void saveProgramBinary(GLuint program, std::size_t key) {
+  GLint length{};
+  glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+  if (length <= 0)
+    return;
+
+  ProgramBinaryHeader header{.key = gsl::narrow<std::uint64_t>(key)};
+  std::vector<char> binary(gsl::narrow<std::size_t>(length));
+  GLenum format{};
+  glGetProgramBinary(program, length, &length, &format, binary.data());
+  header.format = format;
+
+  // Failing to write the cache is not an error
+  std::error_code errorCode;
+  std::filesystem::create_directories(programCachePath, errorCode);
+  if (std::ofstream stream(programCacheFile(key), std::ios::binary); stream) {
+    stream.write(reinterpret_cast<char const *>(&header), sizeof(header));
+    stream.write(binary.data(), length);
+  }
+}
+#endif
+
 // Compiles a shader and returns immediately (i.e. don't wait until completion).
 // Returns the shader ID of the compiled shader.
 [[nodiscard]] abcg::OpenGLShader compileHelper(std::string_view shaderSource,
@@ -171,6 +294,8 @@ void deleteShaders(std::vector<abcg::OpenGLShader> const &shaderIDs) {
 GLuint
 abcg::createOpenGLProgram(std::vector<ShaderSource> const &pathsOrSources,
                           bool throwOnError) {
+  ABCG_TRACE_ZONE("createOpenGLProgram", "shader");
+
   std::vector<ShaderSource> sources;
   sources.reserve(pathsOrSources.size());
   for (auto const &pathOrSource : pathsOrSources) {
@@ -178,6 +303,16 @@ abcg::createOpenGLProgram(std::vector<ShaderSource> const &pathsOrSources,
         {.source = toSource(pathOrSource.source), .stage = pathOrSource.stage});
   }
 
+#if !defined(__EMSCRIPTEN__)
+  auto const useCache{isProgramCacheEnabled()};
+  auto const cacheKey{useCache ? programCacheKey(sources) : 0};
+  if (useCache) {
+    if (auto const program{loadProgramBinary(cacheKey)}; program != 0) {
+      return program;
+    }
+  }
+#endif
+
   std::vector<OpenGLShader> compiledShaders;
   compiledShaders.reserve(sources.size());
   for (auto const &source : sources) {
@@ -201,6 +336,13 @@ abcg::createOpenGLProgram(std::vector<ShaderSource> const &pathsOrSources,
     glAttachShader(shaderProgram, shader.shader);
   }
 
+#if !defined(__EMSCRIPTEN__)
+  if (useCache) {
+    glProgramParameteri(shaderProgram, GL_PROGRAM_BINARY_RETRIEVABLE_HINT,
+                        GL_TRUE);
+  }
+#endif
+
   glLinkProgram(shaderProgram);
 
   for (auto const &shader : compiledShaders) {
@@ -221,9 +363,38 @@ abcg::createOpenGLProgram(std::vector<ShaderSource> const &pathsOrSources,
     return 0U;
   }
 
+#if !defined(__EMSCRIPTEN__)
+  if (useCache) {
+    saveProgramBinary(shaderProgram, cacheKey);
+  }
+#endif
+
   return shaderProgram;
 }
 
+/**
+ * @brief Sets the directory of the program binary cache used by
+ * abcg::createOpenGLProgram.
+ *
+ * When set, abcg::createOpenGLProgram looks for a binary of the program
+ * before compiling it. Binaries are keyed by a hash of the shader sources and
+ * stages, and of the OpenGL vendor, renderer and version strings. If there is
+ * no binary, or if it is rejected by the driver, the program is built from
+ * source and its binary is stored for the next run. The directory is created
+ * if it does not exist.
+ *
+ * The cache requires OpenGL 4.1 or `GL_ARB_get_program_binary`, and at least
+ * one program binary format. It is not used on WebGL.
+ *
+ * @param path Path of the cache directory. An empty path disables the cache,
+ * which is the default.
+ */
+void abcg::setOpenGLProgramCachePath([[maybe_unused]] std::string_view path) {
+#if !defined(__EMSCRIPTEN__)
+  programCachePath = path;
+#endif
+}
+
 /**
  * @brief Triggers the compilation of a group of shaders and returns
  * immediately.
@@ -333,6 +504,13 @@ GLuint abcg::triggerOpenGLShaderLink(std::vector<OpenGLShader> const &shaders,
     glAttachShader(shaderProgram, shader.shader);
   }
 
+#if !defined(__EMSCRIPTEN__)
+  if (isProgramCacheEnabled()) {
+    glProgramParameteri(shaderProgram, GL_PROGRAM_BINARY_RETRIEVABLE_HINT,
+                        GL_TRUE);
+  }
+#endif
+
   glLinkProgram(shaderProgram);
 
   for (auto const &shader : shaders) {
@@ -373,4 +551,202 @@ bool abcg::checkOpenGLShaderLink(GLuint shaderProgram, bool throwOnError) {
   }
 
   return true;
-}
\ No newline at end of file
+}
+
+// @cond Skipped by Doxygen
+struct abcg::OpenGLProgramBuildState {
+  enum class Stage { Compiling, Linking, Ready };
+
+  Stage stage{Stage::Compiling};
+  std::vector<OpenGLShader> shaders;
+  GLuint program{};
+  std::exception_ptr error;
+  bool parallelCompile{};
+  bool useCache{};
+  std::size_t cacheKey{};
+};
+// @endcond
+
+namespace {
+// GL_COMPLETION_STATUS_KHR of KHR_parallel_shader_compile
+constexpr GLenum completionStatus{0x91B1};
+
+[[nodiscard]] bool
+isCompileComplete(std::vector<abcg::OpenGLShader> const &shaders) {
+  return std::ranges::all_of(shaders, [](auto const &shader) {
+    GLint complete{};
+    glGetShaderiv(shader.shader, completionStatus, &complete);
+    return complete == GL_TRUE;
+  });
+}
+
+[[nodiscard]] bool isLinkComplete(GLuint program) {
+  GLint complete{};
+  glGetProgramiv(program, completionStatus, &complete);
+  return complete == GL_TRUE;
+}
+
+// Advances the build as far as possible. If `wait` is false, returns as soon
+// as a stage is still running on the driver. Errors are stored in the state.
+void advanceBuild(abcg::OpenGLProgramBuildState &state, bool wait) {
+  using Stage = abcg::OpenGLProgramBuildState::Stage;
+  auto const canQuery{wait || !state.parallelCompile};
+
+  try {
+    if (state.stage == Stage::Compiling) {
+      if (!canQuery && !isCompileComplete(state.shaders))
+        return;
+      // Both calls delete the shaders, even on failure
+      auto const shaders{std::exchange(state.shaders, {})};
+      abcg::checkOpenGLShaderCompile(shaders);
+      state.program = abcg::triggerOpenGLShaderLink(shaders);
+      state.stage = Stage::Linking;
+    }
+
+    if (state.stage == Stage::Linking) {
+      if (!canQuery && !isLinkComplete(state.program))
+        return;
+      auto const program{std::exchange(state.program, 0U)};
+      abcg::checkOpenGLShaderLink(program);
+      state.program = program;
+#if !defined(__EMSCRIPTEN__)
+      if (state.useCache) {
+        saveProgramBinary(state.program, state.cacheKey);
+      }
+#endif
+      state.stage = Stage::Ready;
+    }
+  } catch (...) {
+    state.error = std::current_exception();
+    state.stage = Stage::Ready;
+  }
+}
+} // namespace
+
+/**
+ * @brief Returns whether the program is built, without waiting.
+ *
+ * @return `true` if abcg::OpenGLProgramFuture::get will not wait.
+ */
+bool abcg::OpenGLProgramFuture::isReady() {
+  if (!m_state)
+    return false;
+  advanceBuild(*m_state, false);
+  return m_state->stage == OpenGLProgramBuildState::Stage::Ready;
+}
+
+/**
+ * @brief Waits until the program is built and returns it.
+ *
+ * @throw abcg::RuntimeError if the shader compilation or the program linking
+ * has failed, or if the handle is not valid.
+ *
+ * @return ID of the program object.
+ */
+GLuint abcg::OpenGLProgramFuture::get() {
+  if (!m_state) {
+    throw abcg::RuntimeError("Invalid program handle");
+  }
+  advanceBuild(*m_state, true);
+  if (m_state->error) {
+    std::rethrow_exception(m_state->error);
+  }
+  return m_state->program;
+}
+
+/**
+ * @brief Constructs a builder for the current OpenGL context.
+ *
+ * Checks for `GL_KHR_parallel_shader_compile` and, if it is available, lets
+ * the driver choose the number of compiler threads.
+ */
+abcg::OpenGLProgramBuilder::OpenGLProgramBuilder() {
+#if defined(__EMSCRIPTEN__)
+  m_parallelCompile =
+      emscripten_webgl_enable_extension(emscripten_webgl_get_current_context(),
+                                        "KHR_parallel_shader_compile") ==
+      EM_TRUE;
+#else
+  m_parallelCompile = GLEW_KHR_parallel_shader_compile != 0;
+  if (m_parallelCompile) {
+    // 0xFFFFFFFF means an implementation-defined maximum
+    glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+  }
+#endif
+}
+
+/**
+ * @brief Starts building a program and returns immediately.
+ *
+ * If the program is found in the program binary cache, it is ready at once.
+ *
+ * @param pathsOrSources Paths or source codes of the shaders to be compiled and
+ * linked to the program.
+ *
+ * @throw abcg::RuntimeError if a shader could not be read from file.
+ *
+ * @return Handle to the program being built.
+ */
+abcg::OpenGLProgramFuture abcg::OpenGLProgramBuilder::submit(
+    std::vector<ShaderSource> const &pathsOrSources) {
+  ABCG_TRACE_ZONE("submitOpenGLProgram", "shader");
+
+  auto state{std::make_shared<OpenGLProgramBuildState>()};
+  state->parallelCompile = m_parallelCompile;
+
+  std::vector<ShaderSource> sources;
+  sources.reserve(pathsOrSources.size());
+  for (auto const &pathOrSource : pathsOrSources) {
+    sources.push_back(
+        {.source = toSource(pathOrSource.source), .stage = pathOrSource.stage});
+  }
+
+#if !defined(__EMSCRIPTEN__)
+  state->useCache = isProgramCacheEnabled();
+  if (state->useCache) {
+    state->cacheKey = programCacheKey(sources);
+    if (auto const program{loadProgramBinary(state->cacheKey)}; program != 0) {
+      state->program = program;
+      state->stage = OpenGLProgramBuildState::Stage::Ready;
+      return OpenGLProgramFuture{state};
+    }
+  }
+#endif
+
+  state->shaders.reserve(sources.size());
+  for (auto const &source : sources) {
+    state->shaders.push_back(
+        compileHelper(source.source, abcgStageToOpenGLStage(source.stage)));
+  }
+
+  m_pending.push_back(state);
+  return OpenGLProgramFuture{state};
+}
+
+/**
+ * @brief Advances the builds whose current stage is complete.
+ *
+ * This never waits for the driver if `GL_KHR_parallel_shader_compile` is
+ * supported.
+ *
+ * @return `true` if all submitted programs are built.
+ */
+bool abcg::OpenGLProgramBuilder::update() {
+  std::erase_if(m_pending, [](auto const &state) {
+    advanceBuild(*state, false);
+    return state->stage == OpenGLProgramBuildState::Stage::Ready;
+  });
+  return m_pending.empty();
+}
+
+/**
+ * @brief Waits until all submitted programs are built.
+ *
+ * Build errors are not thrown here, but by abcg::OpenGLProgramFuture::get.
+ */
+void abcg::OpenGLProgramBuilder::wait() {
+  for (auto const &state : m_pending) {
+    advanceBuild(*state, true);
+  }
+  m_pending.clear();
+}
@@ -2,6 +2,9 @@
  * @file abcgOpenGLShader.hpp
  * @brief Declaration of helper functions for building OpenGL shaders.
  *
+ * Declaration of helper functions for building OpenGL shaders, and of
+ * abcg::OpenGLProgramBuilder and abcg::OpenGLProgramFuture.
+ *
  * This file is part of ABCg (https://github.com/hbatagelo/abcg).
  *
  * @copyright (c) 2021--2023 Harlen Batagelo. All rights reserved.
@@ -14,11 +17,17 @@
 #include "abcgOpenGLExternal.hpp"
 #include "abcgShader.hpp"
 
+#include <memory>
+#include <string_view>
+#include <utility>
 #include <vector>
 
 namespace abcg {
 struct OpenGLShader;
-}
+struct OpenGLProgramBuildState;
+class OpenGLProgramFuture;
+class OpenGLProgramBuilder;
+} // namespace abcg
 
 /**
  * @brief OpenGL shader object and its corresponding stage.
@@ -41,6 +50,85 @@ bool checkOpenGLShaderCompile(std::vector<OpenGLShader> const &shaders,
 GLuint triggerOpenGLShaderLink(std::vector<OpenGLShader> const &shaders,
                                bool throwOnError = true);
 bool checkOpenGLShaderLink(GLuint shaderProgram, bool throwOnError = true);
+void setOpenGLProgramCachePath(std::string_view path);
 } // namespace abcg
 
+/**
+ * @brief Handle to a program being built by abcg::OpenGLProgramBuilder.
+ *
+ * Similar to `std::future`, the program is retrieved with
+ * abcg::OpenGLProgramFuture::get, which waits for the build to complete and
+ * rethrows any build error.
+ *
+ * @remark The program object is owned by the caller after it is retrieved. A
+ * program that is never retrieved is not deleted.
+ */
+class abcg::OpenGLProgramFuture {
+public:
+  OpenGLProgramFuture() = default;
+
+  [[nodiscard]] bool isReady();
+  [[nodiscard]] GLuint get();
+
+  /**
+   * @brief Returns whether the handle refers to a program build.
+   */
+  [[nodiscard]] bool valid() const noexcept { return m_state != nullptr; }
+
+private:
+  friend class OpenGLProgramBuilder;
+
+  explicit OpenGLProgramFuture(std::shared_ptr<OpenGLProgramBuildState> state)
+      : m_state{std::move(state)} {}
+
+  std::shared_ptr<OpenGLProgramBuildState> m_state;
+};
+
+/**
+ * @brief Builds OpenGL programs without stalling on compile and link status.
+ *
+ * abcg::OpenGLProgramBuilder::submit triggers the compilation of a program
+ * and returns immediately. Submitting all programs up front lets the driver
+ * compile them concurrently. abcg::OpenGLProgramBuilder::update advances the
+ * builds that are complete, e.g., once per frame, and
+ * abcg::OpenGLProgramFuture::get waits for a specific program.
+ *
+ * With `GL_KHR_parallel_shader_compile`, the compile and link status are only
+ * queried once `GL_COMPLETION_STATUS_KHR` reports completion, so polling never
+ * stalls, and the driver is allowed to use as many compiler threads as it
+ * wants. Without the extension, abcg::OpenGLProgramBuilder::update checks the
+ * status right away, which may wait for the driver.
+ *
+ * Programs are looked up in the program binary cache, if enabled.
+ *
+ * @sa abcg::setOpenGLProgramCachePath.
+ */
+class abcg::OpenGLProgramBuilder {
+public:
+  OpenGLProgramBuilder();
+
+  [[nodiscard]] OpenGLProgramFuture
+  submit(std::vector<ShaderSource> const &pathsOrSources);
+  bool update();
+  void wait();
+
+  /**
+   * @brief Returns the number of programs not yet built.
+   */
+  [[nodiscard]] std::size_t getPendingCount() const noexcept {
+    return m_pending.size();
+  }
+
+  /**
+   * @brief Returns whether `GL_KHR_parallel_shader_compile` is used.
+   */
+  [[nodiscard]] bool isParallelCompileSupported() const noexcept {
+    return m_parallelCompile;
+  }
+
+private:
+  std::vector<std::shared_ptr<OpenGLProgramBuildState>> m_pending;
+  bool m_parallelCompile{};
+};
+
 #endif
@@ -0,0 +1,537 @@
+/**
+ * @file abcgOpenGLTextureLoader.cpp
+ * @brief Definition of abcg::OpenGLTextureLoader members.
+ *
+ * This file is part of ABCg (https://github.com/hbatagelo/abcg).
+ *
+ * @copyright (c) 2021--2023 Harlen Batagelo. All rights reserved.
+ * This project is released under the MIT License.
+ */
+
+#include "abcgOpenGLTextureLoader.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <exception>
+#include <string_view>
+
+#include <cppitertools/itertools.hpp>
+#include <fmt/core.h>
+#include <gsl/gsl>
+
+#include "abcgImage.hpp"
+#include "abcgKTX2.hpp"
+#include "abcgTrace.hpp"
+
+namespace {
+constexpr std::array<unsigned char, 4> placeholderColor{128, 128, 128, 255};
+} // namespace
+
+/**
+ * @brief Sets up the loader.
+ *
+ * The worker threads are started on the first request.
+ *
+ * @param threadCount Number of worker threads, or zero to use one less than
+ * the number of hardware threads, up to 4.
+ * @param uploadBudget Number of bytes uploaded per frame by
+ * abcg::OpenGLTextureLoader::update. At least one row of an image is uploaded
+ * per frame, even if it is larger than the budget.
+ */
+void abcg::OpenGLTextureLoader::create(std::size_t threadCount,
+                                       std::size_t uploadBudget) {
+  destroy();
+
+  if (threadCount == 0) {
+    auto const hardwareThreads{
+        std::max<std::size_t>(std::thread::hardware_concurrency(), 2)};
+    threadCount = std::min<std::size_t>(hardwareThreads - 1, 4);
+  }
+  m_threadCount = threadCount;
+  m_uploadBudget = std::max<std::size_t>(uploadBudget, 1);
+}
+
+/**
+ * @brief Stops the worker threads and discards the pending requests.
+ *
+ * Textures whose images were not uploaded keep the placeholder.
+ */
+void abcg::OpenGLTextureLoader::destroy() {
+  {
+    std::scoped_lock const lock{m_mutex};
+    m_tasks.clear();
+  }
+  for (auto &worker : m_workers) {
+    worker.request_stop();
+  }
+  m_workers.clear();
+
+  m_ready.clear();
+  m_uploads.clear();
+  m_pending.clear();
+  m_failed.clear();
+
+  if (m_unpackBuffer != 0) {
+    glDeleteBuffers(1, &m_unpackBuffer);
+    m_unpackBuffer = 0;
+  }
+}
+
+/**
+ * @brief Starts loading a 2D texture from an image file.
+ *
+ * @param createInfo Texture creation settings.
+ *
+ * @return ID of the texture, as generated by glGenTextures. The texture
+ * contains a placeholder until the image is uploaded.
+ *
+ * @sa abcg::loadOpenGLTexture for the synchronous version.
+ */
+GLuint abcg::OpenGLTextureLoader::loadTexture(
+    OpenGLTextureCreateInfo const &createInfo) {
+  GLuint texture{};
+  glGenTextures(1, &texture);
+  glBindTexture(GL_TEXTURE_2D, texture);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE,
+               placeholderColor.data());
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glBindTexture(GL_TEXTURE_2D, 0);
+
+  auto request{std::make_shared<Request>()};
+  request->texture = texture;
+  request->bindTarget = GL_TEXTURE_2D;
+  request->generateMipmaps = createInfo.generateMipmaps;
+  request->faces.emplace_back().target = GL_TEXTURE_2D;
+  request->remaining = 1;
+
+  std::vector<Task> tasks;
+  tasks.push_back({.request = request,
+                   .face = 0,
+                   .path = std::string{createInfo.path},
+                   .flipUpsideDown = createInfo.flipUpsideDown,
+                   .flipHorizontally = false,
+                   .sRGBToLinear = createInfo.sRGBToLinear,
+                   .forceRGB = false});
+  enqueue(std::move(tasks));
+
+  m_pending.insert(texture);
+  return texture;
+}
+
+/**
+ * @brief Starts loading a cubemap texture from six image files.
+ *
+ * The six sides are decoded in parallel.
+ *
+ * @param createInfo Texture creation settings.
+ *
+ * @return ID of the texture, as generated by glGenTextures. The texture
+ * contains a placeholder until all sides are uploaded.
+ *
+ * @sa abcg::loadOpenGLCubemap for the synchronous version.
+ */
+GLuint abcg::OpenGLTextureLoader::loadCubemap(
+    OpenGLCubemapCreateInfo const &createInfo) {
+  GLuint texture{};
+  glGenTextures(1, &texture);
+  glBindTexture(GL_TEXTURE_CUBE_MAP, texture);
+  for (auto const index : iter::range(6U)) {
+    glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + index, 0, GL_RGBA, 1, 1, 0,
+                 GL_RGBA, GL_UNSIGNED_BYTE, placeholderColor.data());
+  }
+  glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+
+  auto request{std::make_shared<Request>()};
+  request->texture = texture;
+  request->bindTarget = GL_TEXTURE_CUBE_MAP;
+  request->generateMipmaps = createInfo.generateMipmaps;
+  request->remaining = createInfo.paths.size();
+
+  std::vector<Task> tasks;
+  for (auto &&[index, path] : iter::enumerate(createInfo.paths)) {
+    auto target{GL_TEXTURE_CUBE_MAP_POSITIVE_X + gsl::narrow<GLenum>(index)};
+    auto const isY{target == GL_TEXTURE_CUBE_MAP_POSITIVE_Y ||
+                   target == GL_TEXTURE_CUBE_MAP_NEGATIVE_Y};
+
+    // LHS to RHS: flip, and swap -z and +z
+    if (createInfo.rightHandedSystem) {
+      if (target == GL_TEXTURE_CUBE_MAP_POSITIVE_Z)
+        target = GL_TEXTURE_CUBE_MAP_NEGATIVE_Z;
+      else if (target == GL_TEXTURE_CUBE_MAP_NEGATIVE_Z)
+        target = GL_TEXTURE_CUBE_MAP_POSITIVE_Z;
+    }
+
+    request->faces.emplace_back().target = target;
+    tasks.push_back(
+        {.request = request,
+         .face = index,
+         .path = std::string{path},
+         .flipUpsideDown = createInfo.rightHandedSystem && isY,
+         .flipHorizontally = createInfo.rightHandedSystem && !isY,
+         .sRGBToLinear = false,
+         .forceRGB = true});
+  }
+  enqueue(std::move(tasks));
+
+  m_pending.insert(texture);
+  return texture;
+}
+
+/**
+ * @brief Uploads the decoded images, up to the upload budget.
+ *
+ * Must be called once per frame with the OpenGL context current.
+ *
+ * If an image could not be loaded, or if the format of a KTX2 file is not
+ * supported, a warning is printed and the texture keeps the placeholder. Use
+ * abcg::OpenGLTextureLoader::isFailed to check for these textures.
+ */
+void abcg::OpenGLTextureLoader::update() {
+  {
+    std::scoped_lock const lock{m_mutex};
+    for (auto &request : m_ready) {
+      m_uploads.push_back(std::move(request));
+    }
+    m_ready.clear();
+  }
+
+  if (m_uploads.empty())
+    return;
+
+  ABCG_TRACE_ZONE("uploadTextures", "texture");
+
+  auto const fail{[this](GLuint texture, std::string_view reason) {
+    fmt::print("Warning: {}\n", reason);
+    m_uploads.pop_front();
+    m_pending.erase(texture);
+    m_failed.insert(texture);
+  }};
+
+  auto budget{m_uploadBudget};
+  while (!m_uploads.empty() && budget > 0) {
+    auto const request{m_uploads.front()};
+
+    if (!request->failedPath.empty()) {
+      fail(request->texture, fmt::format("failed to load texture file {}",
+                                         request->failedPath));
+      continue;
+    }
+
+    bool uploaded{};
+    try {
+      uploaded = upload(*request, budget);
+    } catch (std::exception const &exception) {
+      // The format of a KTX2 file is not supported
+      glBindTexture(request->bindTarget, 0);
+      fail(request->texture, exception.what());
+      continue;
+    }
+    if (!uploaded)
+      break;
+
+    finalize(*request);
+    m_uploads.pop_front();
+    m_pending.erase(request->texture);
+  }
+}
+
+/**
+ * @brief Returns whether the image of a texture has been uploaded.
+ *
+ * @param texture ID of a texture returned by the loader.
+ *
+ * @return False if the texture still contains the placeholder, including if
+ * its image could not be loaded.
+ */
+bool abcg::OpenGLTextureLoader::isLoaded(GLuint texture) const {
+  return !m_pending.contains(texture) && !m_failed.contains(texture);
+}
+
+/**
+ * @brief Returns whether the image of a texture could not be loaded.
+ *
+ * @param texture ID of a texture returned by the loader.
+ *
+ * @return True if the image file could not be read or decoded, or if the
+ * format of a KTX2 file is not supported. The texture keeps the placeholder.
+ */
+bool abcg::OpenGLTextureLoader::isFailed(GLuint texture) const {
+  return m_failed.contains(texture);
+}
+
+/**
+ * @brief Returns the number of textures still being loaded.
+ *
+ * @return Number of textures that contain the placeholder.
+ */
+std::size_t abcg::OpenGLTextureLoader::getPendingCount() const noexcept {
+  return m_pending.size();
+}
+
+void abcg::OpenGLTextureLoader::startWorkers() {
+  if (m_threadCount == 0) {
+    create();
+  }
+  m_workers.reserve(m_threadCount);
+  for ([[maybe_unused]] auto const index : iter::range(m_threadCount)) {
+    m_workers.emplace_back(
+        [this](std::stop_token const &stopToken) { workerLoop(stopToken); });
+  }
+}
+
+void abcg::OpenGLTextureLoader::enqueue(std::vector<Task> tasks) {
+#if defined(__EMSCRIPTEN__)
+  // No worker threads without pthreads support
+  for (auto &task : tasks) {
+    decode(task);
+  }
+#else
+  if (m_workers.empty()) {
+    startWorkers();
+  }
+
+  {
+    std::scoped_lock const lock{m_mutex};
+    for (auto &task : tasks) {
+      m_tasks.push_back(std::move(task));
+    }
+  }
+  m_condition.notify_all();
+#endif
+}
+
+void abcg::OpenGLTextureLoader::workerLoop(std::stop_token const &stopToken) {
+  while (true) {
+    Task task;
+    {
+      std::unique_lock lock{m_mutex};
+      if (!m_condition.wait(lock, stopToken,
+                            [this] { return !m_tasks.empty(); })) {
+        return;
+      }
+      task = std::move(m_tasks.front());
+      m_tasks.pop_front();
+    }
+
+    decode(task);
+  }
+}
+
+// Loads, converts and mirrors the image of a task, then hands the request to the
+// render thread once all its faces are decoded
+void abcg::OpenGLTextureLoader::decode(Task &task) {
+  ABCG_TRACE_ZONE("decodeTexture", "texture", task.path);
+
+  if (isKTX2Path(task.path)) {
+    // KTX2 files are uploaded as 2D textures, so they cannot be cubemap sides.
+    // The bind target is not modified after the request is enqueued.
+    std::shared_ptr<KTX2Texture> container;
+    if (task.request->bindTarget == GL_TEXTURE_2D) {
+      container = std::make_shared<KTX2Texture>();
+      try {
+        container->open(task.path);
+        container->prefetch();
+      } catch (std::exception const &) {
+        container.reset();
+      }
+    }
+
+    std::scoped_lock const lock{m_mutex};
+    auto &request{*task.request};
+    if (container == nullptr) {
+      if (request.failedPath.empty()) {
+        request.failedPath = task.path;
+      }
+    } else {
+      request.container = std::move(container);
+    }
+    if (--request.remaining == 0) {
+      m_ready.push_back(std::move(task.request));
+    }
+    return;
+  }
+
+  // Enforce RGB/RGBA
+  Face face{};
+  if (SDL_Surface *const surface{IMG_Load(task.path.c_str())}) {
+    SDL_Surface *formattedSurface{};
+    if (task.forceRGB || surface->format->BytesPerPixel == 3) {
+      formattedSurface =
+          SDL_ConvertSurfaceFormat(surface, SDL_PIXELFORMAT_RGB24, 0);
+      face.internalFormat = task.sRGBToLinear ? GL_SRGB8 : GL_RGB;
+      face.format = GL_RGB;
+    } else {
+      formattedSurface =
+          SDL_ConvertSurfaceFormat(surface, SDL_PIXELFORMAT_RGBA32, 0);
+      face.internalFormat = task.sRGBToLinear ? GL_SRGB8_ALPHA8 : GL_RGBA;
+      face.format = GL_RGBA;
+    }
+    SDL_FreeSurface(surface);
+
+    if (formattedSurface != nullptr) {
+      // The vertical flip is done by abcg::OpenGLTextureLoader::uploadRows
+      face.flipUpsideDown = task.flipUpsideDown;
+      if (task.flipHorizontally) {
+        flipHorizontally(*formattedSurface);
+      }
+      face.surface = {formattedSurface, SDL_FreeSurface};
+    }
+  }
+
+  std::scoped_lock const lock{m_mutex};
+  auto &request{*task.request};
+  auto &target{request.faces.at(task.face)};
+  target.internalFormat = face.internalFormat;
+  target.format = face.format;
+  target.flipUpsideDown = face.flipUpsideDown;
+  target.surface = std::move(face.surface);
+  if (target.surface == nullptr && request.failedPath.empty()) {
+    request.failedPath = task.path;
+  }
+  if (--request.remaining == 0) {
+    m_ready.push_back(std::move(task.request));
+  }
+}
+
+// Uploads rows of the request until the budget is exhausted. Returns true if
+// the upload of all faces is complete.
+bool abcg::OpenGLTextureLoader::upload(Request &request, std::size_t &budget) {
+  glBindTexture(request.bindTarget, request.texture);
+
+  // KTX2 images need no conversion, so they are uploaded at once
+  if (request.container != nullptr) {
+    uploadOpenGLKTX2(*request.container, request.generateMipmaps);
+    budget -= std::min(budget, request.container->getByteSize());
+    glBindTexture(request.bindTarget, 0);
+    return true;
+  }
+
+  // Allocate the storage of all faces at once so that the texture is complete
+  // while the rows are uploaded
+  if (request.face == 0 && request.row == 0) {
+    for (auto const &face : request.faces) {
+      glTexImage2D(face.target, 0, gsl::narrow<GLint>(face.internalFormat),
+                   face.surface->w, face.surface->h, 0, face.format,
+                   GL_UNSIGNED_BYTE, nullptr);
+    }
+  }
+
+  while (request.face < request.faces.size() && budget > 0) {
+    auto &face{request.faces.at(request.face)};
+    auto const pitch{gsl::narrow<std::size_t>(face.surface->pitch)};
+    auto const rowCount{std::clamp(gsl::narrow<int>(budget / pitch), 1,
+                                   face.surface->h - request.row)};
+
+    uploadRows(face, request.row, rowCount);
+    budget -= std::min(budget, gsl::narrow<std::size_t>(rowCount) * pitch);
+    request.row += rowCount;
+
+    if (request.row == face.surface->h) {
+      face.surface.reset();
+      ++request.face;
+      request.row = 0;
+    }
+  }
+
+  glBindTexture(request.bindTarget, 0);
+  return request.face == request.faces.size();
+}
+
+// Uploads rows [firstRow, firstRow + rowCount) of the surface. If the face is
+// flipped upside down, the rows are written to the mirrored rows of the
+// texture, so the surface itself is never flipped.
+void abcg::OpenGLTextureLoader::uploadRows(Face const &face, int firstRow,
+                                           int rowCount) {
+  auto const &surface{*face.surface};
+  auto const pitch{gsl::narrow<std::size_t>(surface.pitch)};
+  auto const *const rows{static_cast<unsigned char const *>(surface.pixels) +
+                         gsl::narrow<std::size_t>(firstRow) * pitch};
+  auto const offsetY{face.flipUpsideDown ? surface.h - firstRow - rowCount
+                                         : firstRow};
+
+#if defined(__EMSCRIPTEN__)
+  // WebGL flips the rows of the uploaded region
+  constexpr GLenum unpackFlipY{0x9240}; // GL_UNPACK_FLIP_Y_WEBGL
+  if (face.flipUpsideDown) {
+    glPixelStorei(unpackFlipY, GL_TRUE);
+  }
+  glTexSubImage2D(face.target, 0, 0, offsetY, surface.w, rowCount,
+                  face.format, GL_UNSIGNED_BYTE, rows);
+  if (face.flipUpsideDown) {
+    glPixelStorei(unpackFlipY, GL_FALSE);
+  }
+#else
+  if (m_unpackBuffer == 0) {
+    glGenBuffers(1, &m_unpackBuffer);
+  }
+
+  // Orphan the buffer so that the copy does not wait for the previous upload
+  auto const count{gsl::narrow<std::size_t>(rowCount)};
+  auto const size{gsl::narrow<GLsizeiptr>(pitch * count)};
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_unpackBuffer);
+  glBufferData(GL_PIXEL_UNPACK_BUFFER, size, nullptr, GL_STREAM_DRAW);
+  if (auto *const data{glMapBufferRange(
+          GL_PIXEL_UNPACK_BUFFER, 0, size,
+          GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT)};
+      data != nullptr) {
+    if (face.flipUpsideDown) {
+      // OpenGL has no unpack flip, so the rows are reversed while copied
+      auto *const destination{static_cast<unsigned char *>(data)};
+      for (auto const index : iter::range(count)) {
+        std::memcpy(destination + (count - index - 1) * pitch,
+                    rows + index * pitch, pitch);
+      }
+    } else {
+      std::memcpy(data, rows, gsl::narrow<std::size_t>(size));
+    }
+    glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+    glTexSubImage2D(face.target, 0, 0, offsetY, surface.w, rowCount,
+                    face.format, GL_UNSIGNED_BYTE, nullptr);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+  } else if (face.flipUpsideDown) {
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    for (auto const index : iter::range(rowCount)) {
+      glTexSubImage2D(face.target, 0, 0, offsetY + rowCount - index - 1,
+                      surface.w, 1, face.format, GL_UNSIGNED_BYTE,
+                      rows + gsl::narrow<std::size_t>(index) * pitch);
+    }
+  } else {
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    glTexSubImage2D(face.target, 0, 0, firstRow, surface.w, rowCount,
+                    face.format, GL_UNSIGNED_BYTE, rows);
+  }
+#endif
+}
+
+// Sets the same sampling parameters as abcg::loadOpenGLTexture and
+// abcg::loadOpenGLCubemap
+void abcg::OpenGLTextureLoader::finalize(Request const &request) {
+  auto const target{request.bindTarget};
+  glBindTexture(target, request.texture);
+
+  // The filters of KTX2 textures are set by abcg::uploadOpenGLKTX2
+  if (request.container == nullptr) {
+    glTexParameteri(target, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(target, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+    if (request.generateMipmaps) {
+      glGenerateMipmap(target);
+      glTexParameteri(target, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    }
+  }
+
+  if (target == GL_TEXTURE_CUBE_MAP) {
+    glTexParameteri(target, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(target, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(target, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+  } else {
+    glTexParameteri(target, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(target, GL_TEXTURE_WRAP_T, GL_REPEAT);
+  }
+
+  glBindTexture(target, 0);
+}
@@ -0,0 +1,140 @@
+/**
+ * @file abcgOpenGLTextureLoader.hpp
+ * @brief Header file of abcg::OpenGLTextureLoader.
+ *
+ * Declaration of abcg::OpenGLTextureLoader.
+ *
+ * This file is part of ABCg (https://github.com/hbatagelo/abcg).
+ *
+ * @copyright (c) 2021--2023 Harlen Batagelo. All rights reserved.
+ * This project is released under the MIT License.
+ */
+
+#ifndef ABCG_OPENGL_TEXTURE_LOADER_HPP_
+#define ABCG_OPENGL_TEXTURE_LOADER_HPP_
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+#include "abcgOpenGLExternal.hpp"
+#include "abcgOpenGLImage.hpp"
+
+struct SDL_Surface;
+
+namespace abcg {
+class KTX2Texture;
+class OpenGLTextureLoader;
+} // namespace abcg
+
+/**
+ * @brief Loads textures in the background.
+ *
+ * abcg::OpenGLTextureLoader::loadTexture and
+ * abcg::OpenGLTextureLoader::loadCubemap return a texture name immediately.
+ * Until the image is loaded, the texture contains a 1x1 gray placeholder. The
+ * image files are decoded, converted and mirrored by a pool of worker threads;
+ * the six sides of a cubemap are decoded in parallel. The render thread only
+ * uploads the decoded images, in abcg::OpenGLTextureLoader::update, up to a
+ * number of bytes per frame. Large images are uploaded a few rows at a time
+ * across several frames. On desktop OpenGL, the uploads go through a pixel
+ * unpack buffer. KTX2 files are memory-mapped and read from disk by the worker
+ * threads, and all their mip levels are uploaded at once. KTX2 files are only
+ * supported by abcg::OpenGLTextureLoader::load.
+ *
+ * If an image cannot be loaded, the texture keeps the placeholder and
+ * abcg::OpenGLTextureLoader::isFailed returns true for it.
+ *
+ * The texture name is kept when the image is uploaded, so it can be bound
+ * while loading. The texture is owned by the caller, which must delete it
+ * with `glDeleteTextures`.
+ *
+ * abcg::OpenGLWindow owns a texture loader, which is used through
+ * abcg::OpenGLWindow::getTextureLoader.
+ */
+class abcg::OpenGLTextureLoader {
+public:
+  /** @brief Default number of bytes uploaded per frame. */
+  static constexpr std::size_t defaultUploadBudget{8 * 1024 * 1024};
+
+  void create(std::size_t threadCount = 0,
+              std::size_t uploadBudget = defaultUploadBudget);
+  void destroy();
+
+  [[nodiscard]] GLuint loadTexture(OpenGLTextureCreateInfo const &createInfo);
+  [[nodiscard]] GLuint loadCubemap(OpenGLCubemapCreateInfo const &createInfo);
+  void update();
+
+  [[nodiscard]] bool isLoaded(GLuint texture) const;
+  [[nodiscard]] bool isFailed(GLuint texture) const;
+  [[nodiscard]] std::size_t getPendingCount() const noexcept;
+
+private:
+  struct Face {
+    GLenum target{};
+    GLenum internalFormat{};
+    GLenum format{};
+    // Rows are uploaded bottom-up instead of flipping the surface
+    bool flipUpsideDown{};
+    std::shared_ptr<SDL_Surface> surface;
+  };
+
+  struct Request {
+    GLuint texture{};
+    GLenum bindTarget{};
+    bool generateMipmaps{};
+    std::vector<Face> faces;
+
+    // Written by the worker threads while holding the mutex
+    std::size_t remaining{};
+    std::string failedPath;
+    std::shared_ptr<KTX2Texture> container;
+
+    // Upload progress, used only by the render thread
+    std::size_t face{};
+    int row{};
+  };
+
+  struct Task {
+    std::shared_ptr<Request> request;
+    std::size_t face{};
+    std::string path;
+    bool flipUpsideDown{};
+    bool flipHorizontally{};
+    bool sRGBToLinear{};
+    bool forceRGB{};
+  };
+
+  void startWorkers();
+  void enqueue(std::vector<Task> tasks);
+  void workerLoop(std::stop_token const &stopToken);
+  void decode(Task &task);
+  bool upload(Request &request, std::size_t &budget);
+  void uploadRows(Face const &face, int firstRow, int rowCount);
+  static void finalize(Request const &request);
+
+  std::size_t m_threadCount{};
+  std::size_t m_uploadBudget{defaultUploadBudget};
+  GLuint m_unpackBuffer{};
+
+  // Used only by the render thread
+  std::deque<std::shared_ptr<Request>> m_uploads;
+  std::unordered_set<GLuint> m_pending;
+  std::unordered_set<GLuint> m_failed;
+
+  std::mutex m_mutex;
+  std::condition_variable_any m_condition;
+  std::deque<Task> m_tasks;
+  std::vector<std::shared_ptr<Request>> m_ready;
+  // Declared last so that the threads are joined before the members above are
+  // destroyed
+  std::vector<std::jthread> m_workers;
+};
+
+#endif
@@ -0,0 +1,456 @@
+/**
+ * @file abcgOpenGLVideoCapture.cpp
+ * @brief Definition of abcg::OpenGLVideoCapture members.
+ *
+ * This file is part of ABCg (https://github.com/hbatagelo/abcg).
+ *
+ * @copyright (c) 2021--2023 Harlen Batagelo. All rights reserved.
+ * This project is released under the MIT License.
+ */
+
+#include "abcgOpenGLVideoCapture.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <exception>
+
+#include <cppitertools/itertools.hpp>
+#include <fmt/core.h>
+#include <gsl/gsl>
+
+#include "abcgException.hpp"
+#include "abcgOpenGLError.hpp"
+#include "abcgOpenGLFrameCapture.hpp"
+#include "abcgTrace.hpp"
+
+namespace {
+constexpr auto channels{4};
+
+#if defined(_WIN32)
+std::FILE *openPipe(char const *command) { return _popen(command, "wb"); }
+void closePipe(std::FILE *pipe) { _pclose(pipe); }
+#else
+std::FILE *openPipe(char const *command) { return popen(command, "w"); }
+void closePipe(std::FILE *pipe) { pclose(pipe); }
+#endif
+} // namespace
+
+/**
+ * @brief Creates the offscreen framebuffer, opens the output and starts the
+ * writer thread.
+ *
+ * Must be called with the OpenGL context current.
+ *
+ * @param settings Capture settings.
+ * @param samples Number of samples of the offscreen framebuffer, or zero to
+ * disable multisampling.
+ *
+ * @throw abcg::RuntimeError if the settings are invalid, the output cannot be
+ * opened, or on WebGL.
+ * @throw abcg::OpenGLError if the framebuffer is incomplete.
+ */
+void abcg::OpenGLVideoCapture::create(
+    OpenGLCaptureSettings const &settings, [[maybe_unused]] int samples) {
+#if defined(__EMSCRIPTEN__)
+  throw abcg::RuntimeError("Frame capture is not supported on WebGL");
+#else
+  destroy();
+
+  if (settings.width <= 0 || settings.height <= 0 || settings.frameRate <= 0) {
+    throw abcg::RuntimeError("Invalid frame capture size or frame rate");
+  }
+
+  m_settings = settings;
+  m_settings.queueSize = std::max<std::size_t>(settings.queueSize, 1);
+  m_size = {settings.width, settings.height};
+  m_frameNumber = 0;
+  m_current = 0;
+  m_failed = false;
+
+  openOutput();
+  createFramebuffers(samples);
+
+  // A scaled blit into a multisampled framebuffer is an invalid operation, so
+  // there is no preview if the window is multisampled
+  GLint sampleBuffers{};
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  glGetIntegerv(GL_SAMPLE_BUFFERS, &sampleBuffers);
+  m_preview = sampleBuffers == 0;
+
+  auto const byteSize{gsl::narrow<GLsizeiptr>(m_size.x) * m_size.y * channels};
+  for (auto &slot : m_slots) {
+    glGenBuffers(1, &slot.buffer);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+    glBufferData(GL_PIXEL_PACK_BUFFER, byteSize, nullptr, GL_STREAM_READ);
+  }
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+  m_writer = std::jthread{
+      [this](std::stop_token const &stopToken) { writerLoop(stopToken); }};
+  m_active = true;
+#endif
+}
+
+/**
+ * @brief Writes the pending frames, closes the output and releases the OpenGL
+ * resources.
+ *
+ * Blocks until all captured frames are written.
+ */
+void abcg::OpenGLVideoCapture::destroy() {
+  if (!m_active)
+    return;
+
+  // Retrieve from the oldest to the newest frame
+  for (auto const offset : iter::range(m_slots.size())) {
+    auto &slot{m_slots.at((m_current + offset) % m_slots.size())};
+    if (slot.fence != nullptr) {
+      retrieve(slot);
+    }
+  }
+  for (auto &slot : m_slots) {
+    glDeleteBuffers(1, &slot.buffer);
+    slot = {};
+  }
+  destroyFramebuffers();
+
+  // The writer thread writes the remaining frames before it stops
+  m_writer.request_stop();
+  m_writer.join();
+  closeOutput();
+
+  m_active = false;
+}
+
+/**
+ * @brief Binds the offscreen framebuffer and sets the viewport to its size.
+ *
+ * Must be called before rendering the frame.
+ */
+void abcg::OpenGLVideoCapture::beginFrame() {
+  glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+  glViewport(0, 0, m_size.x, m_size.y);
+}
+
+/**
+ * @brief Starts the readback of the frame and shows it in the window.
+ *
+ * Frames whose readback has completed are handed to the writer thread. This
+ * blocks only if a pixel pack buffer is reused before its readback completes,
+ * or if the queue of the writer thread is full.
+ *
+ * On return, the default framebuffer is bound.
+ *
+ * @param windowSize Size of the window, in pixels. The frame is scaled to fit
+ * the window, keeping its aspect ratio. If the window is multisampled, the
+ * window is only cleared.
+ */
+void abcg::OpenGLVideoCapture::endFrame(glm::ivec2 const &windowSize) {
+  ABCG_TRACE_ZONE("captureVideoFrame", "capture");
+
+  // Resolve the multisampled framebuffer
+  auto source{m_framebuffer};
+  if (m_resolveFramebuffer != 0) {
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, m_framebuffer);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_resolveFramebuffer);
+    glBlitFramebuffer(0, 0, m_size.x, m_size.y, 0, 0, m_size.x, m_size.y,
+                      GL_COLOR_BUFFER_BIT, GL_NEAREST);
+    source = m_resolveFramebuffer;
+  }
+
+  auto &slot{m_slots.at(m_current)};
+  m_current = (m_current + 1) % m_slots.size();
+  if (slot.fence != nullptr) {
+    retrieve(slot);
+  }
+
+  glBindFramebuffer(GL_READ_FRAMEBUFFER, source);
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+  glReadPixels(0, 0, m_size.x, m_size.y, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+  slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  slot.frameNumber = m_frameNumber++;
+
+  // Hand the completed frames to the writer, from the oldest to the newest
+  for (auto const offset : iter::range(m_slots.size())) {
+    auto &pending{m_slots.at((m_current + offset) % m_slots.size())};
+    if (pending.fence == nullptr)
+      continue;
+
+    if (auto const status{glClientWaitSync(pending.fence, 0, 0)};
+        status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+      break;
+
+    retrieve(pending);
+  }
+
+  // Preview: letterbox the frame into the window
+  glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+  std::array const black{0.0f, 0.0f, 0.0f, 1.0f};
+  glClearBufferfv(GL_COLOR, 0, black.data());
+  if (m_preview && windowSize.x > 0 && windowSize.y > 0) {
+    auto const scale{std::min(static_cast<float>(windowSize.x) / m_size.x,
+                              static_cast<float>(windowSize.y) / m_size.y)};
+    auto const width{static_cast<GLint>(static_cast<float>(m_size.x) * scale)};
+    auto const height{static_cast<GLint>(static_cast<float>(m_size.y) * scale)};
+    auto const x{(windowSize.x - width) / 2};
+    auto const y{(windowSize.y - height) / 2};
+    glBlitFramebuffer(0, 0, m_size.x, m_size.y, x, y, x + width, y + height,
+                      GL_COLOR_BUFFER_BIT, GL_LINEAR);
+  }
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  glViewport(0, 0, windowSize.x, windowSize.y);
+}
+
+/**
+ * @brief Returns whether the requested number of frames has been captured, or
+ * the output could not be written.
+ *
+ * @return True if the capture should be stopped.
+ */
+bool abcg::OpenGLVideoCapture::isFinished() const noexcept {
+  return m_failed ||
+         (m_settings.frameCount > 0 && m_frameNumber >= m_settings.frameCount);
+}
+
+/**
+ * @brief Returns the time between captured frames.
+ *
+ * @return Time in seconds.
+ */
+double abcg::OpenGLVideoCapture::getFrameTime() const noexcept {
+  return 1.0 / m_settings.frameRate;
+}
+
+void abcg::OpenGLVideoCapture::createFramebuffers(int samples) {
+  GLint maxSamples{};
+  glGetIntegerv(GL_MAX_SAMPLES, &maxSamples);
+  samples = std::clamp(samples, 0, maxSamples);
+
+  glGenRenderbuffers(1, &m_colorRenderbuffer);
+  glBindRenderbuffer(GL_RENDERBUFFER, m_colorRenderbuffer);
+  glRenderbufferStorageMultisample(GL_RENDERBUFFER, samples, GL_RGBA8,
+                                   m_size.x, m_size.y);
+  glGenRenderbuffers(1, &m_depthRenderbuffer);
+  glBindRenderbuffer(GL_RENDERBUFFER, m_depthRenderbuffer);
+  glRenderbufferStorageMultisample(GL_RENDERBUFFER, samples,
+                                   GL_DEPTH24_STENCIL8, m_size.x, m_size.y);
+
+  glGenFramebuffers(1, &m_framebuffer);
+  glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                            GL_RENDERBUFFER, m_colorRenderbuffer);
+  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT,
+                            GL_RENDERBUFFER, m_depthRenderbuffer);
+  auto status{glCheckFramebufferStatus(GL_FRAMEBUFFER)};
+
+  if (status == GL_FRAMEBUFFER_COMPLETE && samples > 0) {
+    glGenRenderbuffers(1, &m_resolveRenderbuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, m_resolveRenderbuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, m_size.x, m_size.y);
+
+    glGenFramebuffers(1, &m_resolveFramebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, m_resolveFramebuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                              GL_RENDERBUFFER, m_resolveRenderbuffer);
+    status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+  }
+
+  glBindRenderbuffer(GL_RENDERBUFFER, 0);
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+  if (status != GL_FRAMEBUFFER_COMPLETE) {
+    destroyFramebuffers();
+    closeOutput();
+    throw abcg::OpenGLError("Failed to create the capture framebuffer",
+                            status);
+  }
+}
+
+void abcg::OpenGLVideoCapture::destroyFramebuffers() {
+  glDeleteFramebuffers(1, &m_resolveFramebuffer);
+  glDeleteRenderbuffers(1, &m_resolveRenderbuffer);
+  glDeleteFramebuffers(1, &m_framebuffer);
+  glDeleteRenderbuffers(1, &m_depthRenderbuffer);
+  glDeleteRenderbuffers(1, &m_colorRenderbuffer);
+  m_resolveFramebuffer = 0;
+  m_resolveRenderbuffer = 0;
+  m_framebuffer = 0;
+  m_depthRenderbuffer = 0;
+  m_colorRenderbuffer = 0;
+}
+
+void abcg::OpenGLVideoCapture::openOutput() {
+  if (m_settings.format == OpenGLCaptureFormat::PNGSequence) {
+    // Fail now rather than on the writer thread
+    try {
+      [[maybe_unused]] auto const filename{
+          fmt::format(fmt::runtime(m_settings.path), 0)};
+    } catch (std::exception const &exception) {
+      throw abcg::RuntimeError(fmt::format("Invalid capture path {}: {}",
+                                           m_settings.path,
+                                           exception.what()));
+    }
+    return;
+  }
+
+  m_isPipe = m_settings.path.starts_with('|');
+  m_file = m_isPipe ? openPipe(m_settings.path.c_str() + 1)
+                    : std::fopen(m_settings.path.c_str(), "wb");
+  if (m_file == nullptr) {
+    throw abcg::RuntimeError(
+        fmt::format("Failed to open capture output {}", m_settings.path));
+  }
+
+  if (m_settings.format == OpenGLCaptureFormat::Y4M) {
+    fmt::print(m_file, "YUV4MPEG2 W{} H{} F{}:1 Ip A1:1 C444\n", m_size.x,
+               m_size.y, m_settings.frameRate);
+  }
+}
+
+void abcg::OpenGLVideoCapture::closeOutput() {
+  if (m_file == nullptr)
+    return;
+
+  if (m_isPipe) {
+    closePipe(m_file);
+  } else {
+    std::fclose(m_file);
+  }
+  m_file = nullptr;
+}
+
+// Waits for the readback of the slot, copies the pixels from the mapped buffer
+// and queues them for the writer thread, waiting for space in the queue
+void abcg::OpenGLVideoCapture::retrieve(Slot &slot) {
+  ABCG_TRACE_ZONE("retrieveVideoFrame", "capture");
+
+  // Waits up to 1 s at a time, flushing the commands on the first wait
+  auto flags{GLbitfield{GL_SYNC_FLUSH_COMMANDS_BIT}};
+  while (true) {
+    auto const status{glClientWaitSync(slot.fence, flags, 1'000'000'000)};
+    if (status != GL_TIMEOUT_EXPIRED)
+      break;
+    flags = 0;
+  }
+  glDeleteSync(slot.fence);
+  slot.fence = nullptr;
+
+  auto const byteSize{gsl::narrow<GLsizeiptr>(m_size.x) * m_size.y * channels};
+  Job job{.frameNumber = slot.frameNumber,
+          .pixels = std::vector<unsigned char>(
+              gsl::narrow<std::size_t>(byteSize))};
+
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+  if (auto const *data{
+          glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, byteSize, GL_MAP_READ_BIT)};
+      data != nullptr) {
+    std::memcpy(job.pixels.data(), data, job.pixels.size());
+    glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+  }
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+  {
+    std::unique_lock lock{m_mutex};
+    m_spaceAvailable.wait(
+        lock, [this] { return m_jobs.size() < m_settings.queueSize; });
+    m_jobs.push_back(std::move(job));
+  }
+  m_jobAvailable.notify_one();
+}
+
+void abcg::OpenGLVideoCapture::writerLoop(std::stop_token const &stopToken) {
+  while (true) {
+    Job job;
+    {
+      std::unique_lock lock{m_mutex};
+      // Returns false only if stop was requested and there are no jobs left
+      if (!m_jobAvailable.wait(lock, stopToken,
+                               [this] { return !m_jobs.empty(); })) {
+        return;
+      }
+      job = std::move(m_jobs.front());
+      m_jobs.pop_front();
+    }
+    m_spaceAvailable.notify_one();
+
+    // After a failure, frames are still consumed so that rendering does not
+    // block
+    if (!m_failed) {
+      write(job);
+    }
+  }
+}
+
+void abcg::OpenGLVideoCapture::write(Job &job) {
+  ABCG_TRACE_ZONE("writeVideoFrame", "capture");
+
+  auto const pitch{gsl::narrow<std::size_t>(m_size.x * channels)};
+
+  switch (m_settings.format) {
+  case OpenGLCaptureFormat::PNGSequence:
+    OpenGLFrameCapture::savePNG(
+        fmt::format(fmt::runtime(m_settings.path), job.frameNumber), m_size,
+        job.pixels);
+    return;
+  case OpenGLCaptureFormat::RawRGBA:
+    // Rows are read bottom to top
+    for (auto const row : iter::range(m_size.y - 1, -1, -1)) {
+      if (std::fwrite(job.pixels.data() + gsl::narrow<std::size_t>(row) * pitch,
+                      1, pitch, m_file) != pitch) {
+        m_failed = true;
+        break;
+      }
+    }
+    break;
+  case OpenGLCaptureFormat::Y4M:
+    writeY4M(job.pixels);
+    break;
+  }
+
+  if (m_failed) {
+    fmt::print("Warning: failed to write frame {} to {}\n", job.frameNumber,
+               m_settings.path);
+  }
+}
+
+// Converts RGBA to planar 8-bit BT.601 limited-range YUV 4:4:4 and writes a
+// Y4M frame
+void abcg::OpenGLVideoCapture::writeY4M(
+    std::vector<unsigned char> const &pixels) {
+  auto const width{gsl::narrow<std::size_t>(m_size.x)};
+  auto const height{gsl::narrow<std::size_t>(m_size.y)};
+  auto const planeSize{width * height};
+  m_planes.resize(planeSize * 3);
+
+  auto *const planeY{m_planes.data()};
+  auto *const planeU{planeY + planeSize};
+  auto *const planeV{planeU + planeSize};
+
+  for (auto const row : iter::range(height)) {
+    // Rows are read bottom to top
+    auto const *source{pixels.data() + (height - row - 1) * width * channels};
+    auto const offset{row * width};
+    for (auto const column : iter::range(width)) {
+      int const red{source[0]};
+      int const green{source[1]};
+      int const blue{source[2]};
+      source += channels;
+
+      planeY[offset + column] = static_cast<unsigned char>(
+          ((66 * red + 129 * green + 25 * blue + 128) >> 8) + 16);
+      planeU[offset + column] = static_cast<unsigned char>(
+          ((-38 * red - 74 * green + 112 * blue + 128) >> 8) + 128);
+      planeV[offset + column] = static_cast<unsigned char>(
+          ((112 * red - 94 * green - 18 * blue + 128) >> 8) + 128);
+    }
+  }
+
+  static constexpr std::string_view frameHeader{"FRAME\n"};
+  if (std::fwrite(frameHeader.data(), 1, frameHeader.size(), m_file) !=
+          frameHeader.size() ||
+      std::fwrite(m_planes.data(), 1, m_planes.size(), m_file) !=
+          m_planes.size()) {
+    m_failed = true;
+  }
+}
@@ -0,0 +1,181 @@
+/**
+ * @file abcgOpenGLVideoCapture.hpp
+ * @brief Header file of abcg::OpenGLVideoCapture.
+ *
+ * Declaration of abcg::OpenGLVideoCapture and related types.
+ *
+ * This file is part of ABCg (https://github.com/hbatagelo/abcg).
+ *
+ * @copyright (c) 2021--2023 Harlen Batagelo. All rights reserved.
+ * This project is released under the MIT License.
+ */
+
+#ifndef ABCG_OPENGL_VIDEO_CAPTURE_HPP_
+#define ABCG_OPENGL_VIDEO_CAPTURE_HPP_
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <glm/vec2.hpp>
+
+#include "abcgOpenGLExternal.hpp"
+
+namespace abcg {
+enum class OpenGLCaptureFormat;
+struct OpenGLCaptureSettings;
+class OpenGLVideoCapture;
+} // namespace abcg
+
+/**
+ * @brief Enumeration of output formats of a frame sequence capture.
+ *
+ * @sa abcg::OpenGLCaptureSettings.
+ */
+enum class abcg::OpenGLCaptureFormat {
+  /** @brief One PNG file per frame.
+   *
+   * abcg::OpenGLCaptureSettings::path is a format string that receives the
+   * frame number, e.g., `"frames/{:06}.png"`.
+   */
+  PNGSequence,
+  /** @brief Stream of raw RGBA frames, 8 bits per channel, top row first. */
+  RawRGBA,
+  /** @brief YUV4MPEG2 stream with 4:4:4 chroma (`C444`). */
+  Y4M
+};
+
+/**
+ * @brief Configuration settings of a frame sequence capture.
+ *
+ * @sa abcg::OpenGLWindow::startCapture.
+ */
+struct abcg::OpenGLCaptureSettings {
+  /** @brief Output path.
+   *
+   * For the stream formats, a path that starts with `|` is a shell command
+   * whose standard input receives the stream, e.g.,
+   * `"|ffmpeg -y -i - -pix_fmt yuv420p out.mp4"`.
+   */
+  std::string path{"capture.y4m"};
+  /** @brief Output format. */
+  OpenGLCaptureFormat format{OpenGLCaptureFormat::Y4M};
+  /** @brief Frame width, in pixels. Independent of the window size. */
+  int width{1920};
+  /** @brief Frame height, in pixels. Independent of the window size. */
+  int height{1080};
+  /** @brief Frame rate, in frames per second.
+   *
+   * Each captured frame advances the application time by exactly
+   * `1 / frameRate` seconds, whatever the time taken to render it.
+   */
+  int frameRate{60};
+  /** @brief Number of frames to capture, or zero to capture until
+   * abcg::OpenGLWindow::stopCapture is called.
+   */
+  int frameCount{0};
+  /** @brief Maximum number of frames waiting to be written.
+   *
+   * When the queue is full, rendering waits for the writer thread.
+   */
+  std::size_t queueSize{8};
+};
+
+/**
+ * @brief Renders frames into an offscreen framebuffer and streams them to a
+ * file, a pipe or a sequence of PNG files.
+ *
+ * The framebuffer has a fixed size given by abcg::OpenGLCaptureSettings, and
+ * is multisampled if the window is. Each frame is resolved and read back into
+ * one of a ring of abcg::OpenGLVideoCapture::latency pixel pack buffers, and
+ * mapped only when its fence is signaled. The pixels are then pushed into a
+ * bounded queue consumed by a writer thread, which converts and writes them in
+ * order. No frame is dropped: if the writer falls behind, rendering waits.
+ *
+ * Each frame is also shown letterboxed in the window, unless the window is
+ * multisampled.
+ *
+ * abcg::OpenGLWindow owns a video capture, which is used through
+ * abcg::OpenGLWindow::startCapture.
+ *
+ * @remark Not supported on WebGL.
+ */
+class abcg::OpenGLVideoCapture {
+public:
+  /** @brief Number of pixel pack buffers in the ring. */
+  static constexpr std::size_t latency{3};
+
+  void create(OpenGLCaptureSettings const &settings, int samples);
+  void destroy();
+
+  void beginFrame();
+  void endFrame(glm::ivec2 const &windowSize);
+
+  [[nodiscard]] bool isActive() const noexcept { return m_active; }
+  [[nodiscard]] bool isFinished() const noexcept;
+  [[nodiscard]] glm::ivec2 getSize() const noexcept { return m_size; }
+  [[nodiscard]] double getFrameTime() const noexcept;
+  [[nodiscard]] int getFrameNumber() const noexcept { return m_frameNumber; }
+
+private:
+  struct Slot {
+    GLuint buffer{};
+    GLsync fence{};
+    int frameNumber{};
+  };
+
+  struct Job {
+    int frameNumber{};
+    std::vector<unsigned char> pixels;
+  };
+
+  void createFramebuffers(int samples);
+  void destroyFramebuffers();
+  void openOutput();
+  void closeOutput();
+  void retrieve(Slot &slot);
+  void writerLoop(std::stop_token const &stopToken);
+  void write(Job &job);
+  void writeY4M(std::vector<unsigned char> const &pixels);
+
+  OpenGLCaptureSettings m_settings;
+  glm::ivec2 m_size{};
+  bool m_active{};
+  int m_frameNumber{};
+
+  // Framebuffer objects. The resolve framebuffer is used only with
+  // multisampling.
+  GLuint m_framebuffer{};
+  GLuint m_colorRenderbuffer{};
+  GLuint m_depthRenderbuffer{};
+  GLuint m_resolveFramebuffer{};
+  GLuint m_resolveRenderbuffer{};
+  // Whether the frame is blitted to the window, which requires a
+  // single-sampled default framebuffer
+  bool m_preview{};
+
+  std::array<Slot, latency> m_slots{};
+  std::size_t m_current{};
+
+  // Output stream of the stream formats
+  std::FILE *m_file{};
+  bool m_isPipe{};
+  std::vector<unsigned char> m_planes;
+  std::atomic<bool> m_failed{};
+
+  std::mutex m_mutex;
+  std::condition_variable_any m_jobAvailable;
+  std::condition_variable m_spaceAvailable;
+  std::deque<Job> m_jobs;
+  // Declared last so that the thread is joined before the members above are
+  // destroyed
+  std::jthread m_writer;
+};
+
+#endif
@@ -11,12 +11,12 @@
 #include "abcgOpenGLWindow.hpp"
 
 #include <SDL_events.h>
-#include <SDL_image.h>
 #include <imgui_impl_opengl3.h>
 #include <imgui_impl_sdl2.h>
 
 #include "abcgEmbeddedFonts.hpp"
 #include "abcgException.hpp"
+#include "abcgProfiler.hpp"
 #include "abcgWindow.hpp"
 
 /**
@@ -51,29 +51,86 @@ void abcg::OpenGLWindow::setOpenGLSettings(
  */
 void abcg::OpenGLWindow::saveScreenshotPNG(std::string_view filename) const {
   auto const size{getWindowSize()};
-  auto const bitsPerPixel{8};
   auto const channels{4};
-  auto const pitch{gsl::narrow<long>(size.x * channels)};
 
   auto const numPixels{gsl::narrow<std::size_t>(size.x * size.y * channels)};
   std::vector<unsigned char> pixels(numPixels);
   glReadBuffer(m_openGLSettings.doubleBuffering ? GL_BACK : GL_FRONT);
   glReadPixels(0, 0, size.x, size.y, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
 
-  // Flip upside down
-  for (auto const line : iter::range(size.y / 2)) {
-    std::swap_ranges(pixels.begin() + pitch * line,
-                     pixels.begin() + pitch * (line + 1),
-                     pixels.begin() + pitch * (size.y - line - 1));
-  }
+  OpenGLFrameCapture::savePNG(filename, size, pixels);
+}
 
-  if (auto *const surface{SDL_CreateRGBSurfaceFrom(
-          pixels.data(), size.x, size.y, channels * bitsPerPixel,
-          gsl::narrow<int>(pitch), 0x000000FF, 0x0000FF00, 0x00FF0000,
-          0xFF000000)}) {
-    IMG_SavePNG(surface, filename.data());
-    SDL_FreeSurface(surface);
-  }
+/**
+ * @brief Requests a snapshot of the screen to be saved to a file.
+ *
+ * Unlike abcg::OpenGLWindow::saveScreenshotPNG, the snapshot is taken at the
+ * end of the current frame, after the UI is rendered. The pixels are read
+ * asynchronously and the file is written by a worker thread, so the rendering
+ * is not stalled. The file is usually written a few frames later.
+ *
+ * If called more than once in the same frame, only the last request is kept.
+ *
+ * @param filename String view to the filename.
+ */
+void abcg::OpenGLWindow::captureScreenshotPNG(std::string_view filename) {
+  m_screenshotRequest = filename;
+}
+
+/**
+ * @brief Starts capturing a frame sequence at a fixed resolution and frame
+ * rate.
+ *
+ * While capturing, the scene is rendered into an offscreen framebuffer of the
+ * size given by `settings`, and abcg::OpenGLWindow::onResize is called with
+ * that size instead of the window size. Each frame advances the application
+ * time by exactly `1 / settings.frameRate` seconds, and vertical
+ * synchronization is disabled, so frames are rendered as fast as they can be
+ * written, even faster than real time. The window shows a scaled preview of
+ * the frames with the UI on top; the UI is not captured. Frames are rendered
+ * even if the window is hidden or minimized.
+ *
+ * The capture stops after abcg::OpenGLCaptureSettings::frameCount frames, or
+ * when abcg::OpenGLWindow::stopCapture is called.
+ *
+ * Must be called after the window is created, e.g., from
+ * abcg::OpenGLWindow::onCreate or abcg::OpenGLWindow::onPaintUI.
+ *
+ * @param settings Capture settings.
+ *
+ * @throw abcg::RuntimeError if the capture cannot be started.
+ */
+void abcg::OpenGLWindow::startCapture(OpenGLCaptureSettings const &settings) {
+  stopCapture();
+
+  m_videoCapture.create(settings, m_openGLSettings.samples);
+  SDL_GL_SetSwapInterval(0);
+  abcg::Window::setFixedFrameTime(m_videoCapture.getFrameTime());
+  onResize(m_videoCapture.getSize());
+}
+
+/**
+ * @brief Stops the frame sequence capture.
+ *
+ * Blocks until the pending frames are written. Does nothing if not capturing.
+ */
+void abcg::OpenGLWindow::stopCapture() {
+  if (!m_videoCapture.isActive())
+    return;
+
+  m_videoCapture.destroy();
+  SDL_GL_SetSwapInterval(m_openGLSettings.vSync ? 1 : 0);
+  abcg::Window::setFixedFrameTime(0.0);
+  onResize(getWindowSize());
+}
+
+/**
+ * @brief Returns whether a frame sequence is being captured.
+ *
+ * @return True if capturing.
+ */
+bool abcg::OpenGLWindow::isCapturing() const noexcept {
+  return m_videoCapture.isActive();
 }
 
 /**
@@ -126,7 +183,8 @@ void abcg::OpenGLWindow::onPaint() {
  * This is not called when the window is minimized.
  *
  * Override it for custom behavior. By default, it shows a FPS counter if
- * abcg::WindowSettings::showFPS is set to `true`, and a toggle fullscreen
+ * abcg::WindowSettings::showFPS is set to `true`, a profiler overlay if
+ * abcg::WindowSettings::showProfiler is set to `true`, and a toggle fullscreen
  * button if abcg::WindowSettings::showFullscreenButton is set to `true`.
  */
 void abcg::OpenGLWindow::onPaintUI() {
@@ -159,6 +217,11 @@ void abcg::OpenGLWindow::onPaintUI() {
     ImGui::End();
   }
 
+  // Profiler overlay
+  if (abcg::Window::getWindowSettings().showProfiler) {
+    Profiler::instance().paintOverlay();
+  }
+
   // Fullscreen button
   if (abcg::Window::getWindowSettings().showFullscreenButton) {
 #if defined(__EMSCRIPTEN__)
@@ -213,6 +276,24 @@ void abcg::OpenGLWindow::onResize([[maybe_unused]] glm::ivec2 const &size) {}
  */
 void abcg::OpenGLWindow::onUpdate() {}
 
+/**
+ * @brief Custom handler for fixed-timestep updates.
+ *
+ * This virtual function is called zero or more times per frame, before
+ * abcg::OpenGLWindow::onUpdate, so that the total simulated time follows the
+ * elapsed time in steps of constant size. It is only called if
+ * abcg::WindowSettings::fixedUpdateRate is greater than zero. Like
+ * abcg::OpenGLWindow::onUpdate, it is called even if the window is minimized.
+ *
+ * Use abcg::Window::getFixedUpdateAlpha in the paint handlers to interpolate
+ * the simulation state between fixed updates.
+ *
+ * Override it for custom behavior. By default, it does nothing.
+ *
+ * @param deltaTime Fixed time step, in seconds.
+ */
+void abcg::OpenGLWindow::onFixedUpdate([[maybe_unused]] double deltaTime) {}
+
 /**
  * @brief Custom handler for cleaning up OpenGL resources.
  *
@@ -222,6 +303,19 @@ void abcg::OpenGLWindow::onUpdate() {}
  */
 void abcg::OpenGLWindow::onDestroy() {}
 
+/**
+ * @brief Returns the texture loader of the window.
+ *
+ * Use it to load textures without blocking the rendering loop. The decoded
+ * images are uploaded at the beginning of each frame, before
+ * abcg::OpenGLWindow::onPaintUI and abcg::OpenGLWindow::onPaint.
+ *
+ * @return Reference to the texture loader.
+ */
+abcg::OpenGLTextureLoader &abcg::OpenGLWindow::getTextureLoader() noexcept {
+  return m_textureLoader;
+}
+
 void abcg::OpenGLWindow::handleEvent(SDL_Event const &event) {
   if (event.window.windowID != abcg::Window::getSDLWindowID())
     return;
@@ -243,7 +337,10 @@ void abcg::OpenGLWindow::handleEvent(SDL_Event const &event) {
       break;
     case SDL_WINDOWEVENT_SIZE_CHANGED:
     case SDL_WINDOWEVENT_RESIZED: {
-      onResize(getWindowSize());
+      // The capture framebuffer keeps its size
+      if (!m_videoCapture.isActive()) {
+        onResize(getWindowSize());
+      }
     } break;
     default:
       break;
@@ -296,16 +393,24 @@ void abcg::OpenGLWindow::create() {
   m_GLSLVersion =
       fmt::format("#version {:d}{:02d}", majorVersion, minorVersion * 10);
 
+  // In debug builds, request a debug context so that errors can be reported
+  // through the KHR_debug callback
+#if !defined(NDEBUG) && !defined(__EMSCRIPTEN__) && !defined(__APPLE__)
+  auto const debugFlag{SDL_GL_CONTEXT_DEBUG_FLAG};
+#else
+  auto const debugFlag{0};
+#endif
+
   switch (profile) {
   case OpenGLProfile::Core:
     SDL_GL_SetAttribute(SDL_GL_CONTEXT_FLAGS,
-                        SDL_GL_CONTEXT_FORWARD_COMPATIBLE_FLAG);
+                        SDL_GL_CONTEXT_FORWARD_COMPATIBLE_FLAG | debugFlag);
     SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK,
                         SDL_GL_CONTEXT_PROFILE_CORE);
     m_GLSLVersion += " core";
     break;
   case OpenGLProfile::Compatibility:
-    SDL_GL_SetAttribute(SDL_GL_CONTEXT_FLAGS, 0);
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_FLAGS, debugFlag);
     SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK,
                         SDL_GL_CONTEXT_PROFILE_COMPATIBILITY);
     m_GLSLVersion += " compatibility";
@@ -370,6 +475,16 @@ void abcg::OpenGLWindow::create() {
              reinterpret_cast<char const *>(glewGetString(GLEW_VERSION)));
 #endif
 
+#if !defined(NDEBUG) && !defined(__EMSCRIPTEN__) && !defined(__APPLE__)
+  // Check OpenGL errors with a debug callback instead of polling glGetError.
+  // Debug output is not used with OpenGL ES contexts.
+  if (profile != OpenGLProfile::ES && abcg::enableGLDebugOutput()) {
+    fmt::print("OpenGL errors..: KHR_debug callback\n");
+  } else {
+    fmt::print("OpenGL errors..: glGetError\n");
+  }
+#endif
+
   fmt::print("OpenGL vendor..: {}\n",
              reinterpret_cast<char const *>(glGetString(GL_VENDOR)));
   fmt::print("OpenGL renderer: {}\n",
@@ -419,15 +534,27 @@ void abcg::OpenGLWindow::create() {
     throw abcg::RuntimeError("Failed to load font file");
   }
 
+  m_GPUTimer.create(profile == OpenGLProfile::ES);
+  m_frameCapture.create();
+  m_textureLoader.create();
+
   onCreate();
 
   onResize(getWindowSize());
 }
 
+void abcg::OpenGLWindow::fixedUpdate(double deltaTime) {
+  ABCG_PROFILE_ZONE("onFixedUpdate");
+  onFixedUpdate(deltaTime);
+}
+
 void abcg::OpenGLWindow::paint() {
-  onUpdate();
+  {
+    ABCG_PROFILE_ZONE("onUpdate");
+    onUpdate();
+  }
 
-  if (m_hidden || m_minimized)
+  if ((m_hidden || m_minimized) && !m_videoCapture.isActive())
     return;
 
   SDL_GL_MakeCurrent(abcg::Window::getSDLWindow(), m_GLContext);
@@ -443,33 +570,83 @@ void abcg::OpenGLWindow::paint() {
   }
 #endif
 
+  m_GPUTimer.beginFrame();
+  m_frameCapture.update();
+  m_textureLoader.update();
+
   ImGui_ImplOpenGL3_NewFrame();
   ImGui_ImplSDL2_NewFrame();
   ImGui::NewFrame();
 
-  onPaintUI();
+  {
+    ABCG_PROFILE_ZONE("onPaintUI");
+    onPaintUI();
+    ImGui::Render();
+  }
+
+  {
+    ABCG_PROFILE_ZONE("onPaint");
+    m_GPUTimer.begin("onPaint");
+    if (m_videoCapture.isActive()) {
+      m_videoCapture.beginFrame();
+    }
+    onPaint();
+    m_GPUTimer.end();
+  }
 
-  ImGui::Render();
+  if (m_videoCapture.isActive()) {
+    ABCG_PROFILE_ZONE("VideoCapture");
+    m_videoCapture.endFrame(getWindowSize());
+  }
 
-  onPaint();
+  {
+    ABCG_PROFILE_ZONE("ImGui");
+    m_GPUTimer.begin("ImGui");
+    ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+    m_GPUTimer.end();
+  }
 
-  ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
-  if (m_openGLSettings.doubleBuffering) {
-    SDL_GL_SwapWindow(abcg::Window::getSDLWindow());
-  } else {
-    glFinish();
+  if (!m_screenshotRequest.empty()) {
+    ABCG_PROFILE_ZONE("Capture");
+    m_frameCapture.capture(m_screenshotRequest, getWindowSize(),
+                           m_openGLSettings.doubleBuffering ? GL_BACK
+                                                            : GL_FRONT);
+    m_screenshotRequest.clear();
   }
+
+  {
+    ABCG_PROFILE_ZONE("Swap");
+    if (m_openGLSettings.doubleBuffering) {
+      SDL_GL_SwapWindow(abcg::Window::getSDLWindow());
+    } else {
+      glFinish();
+    }
+  }
+
+  if (m_videoCapture.isActive() && m_videoCapture.isFinished()) {
+    stopCapture();
+  }
+
+  Profiler::instance().endFrame();
 }
 
 void abcg::OpenGLWindow::destroy() {
   onDestroy();
 
+  m_textureLoader.destroy();
+  m_videoCapture.destroy();
+  m_frameCapture.destroy();
+  m_GPUTimer.destroy();
+
   if (ImGui::GetCurrentContext() != nullptr) {
     ImGui_ImplOpenGL3_Shutdown();
     ImGui_ImplSDL2_Shutdown();
     ImGui::DestroyContext();
   }
   if (m_GLContext != nullptr) {
+#if !defined(NDEBUG) && !defined(__EMSCRIPTEN__) && !defined(__APPLE__)
+    abcg::disableGLDebugOutput();
+#endif
     SDL_GL_DeleteContext(m_GLContext);
     m_GLContext = nullptr;
   }
@@ -16,7 +16,11 @@
 #include <string>
 
 #include "abcgExternal.hpp"
+#include "abcgOpenGLFrameCapture.hpp"
 #include "abcgOpenGLFunction.hpp"
+#include "abcgOpenGLProfiler.hpp"
+#include "abcgOpenGLTextureLoader.hpp"
+#include "abcgOpenGLVideoCapture.hpp"
 #include "abcgWindow.hpp"
 
 namespace abcg {
@@ -92,6 +96,7 @@ struct abcg::OpenGLSettings {
  * @sa abcg::OpenGLWindow::onPaintUI for UI rendering.
  * @sa abcg::OpenGLWindow::onResize for handling of window resize events.
  * @sa abcg::OpenGLWindow::onUpdate for commands to be called every frame.
+ * @sa abcg::OpenGLWindow::onFixedUpdate for fixed-timestep simulation updates.
  * @sa abcg::OpenGLWindow::onDestroy for cleaning up OpenGL resources.
 
  * @remark Objects of this type cannot be copied or copy-constructed.
@@ -101,6 +106,10 @@ public:
   [[nodiscard]] OpenGLSettings const &getOpenGLSettings() const noexcept;
   void setOpenGLSettings(OpenGLSettings const &openGLSettings) noexcept;
   void saveScreenshotPNG(std::string_view filename) const;
+  void captureScreenshotPNG(std::string_view filename);
+  void startCapture(OpenGLCaptureSettings const &settings);
+  void stopCapture();
+  [[nodiscard]] bool isCapturing() const noexcept;
 
 protected:
   virtual void onEvent(SDL_Event const &event);
@@ -109,11 +118,15 @@ protected:
   virtual void onPaintUI();
   virtual void onResize(glm::ivec2 const &size);
   virtual void onUpdate();
+  virtual void onFixedUpdate(double deltaTime);
   virtual void onDestroy();
 
+  [[nodiscard]] OpenGLTextureLoader &getTextureLoader() noexcept;
+
 private:
   void handleEvent(SDL_Event const &event) final;
   void create() final;
+  void fixedUpdate(double deltaTime) final;
   void paint() final;
   void destroy() final;
   [[nodiscard]] glm::ivec2 getWindowSize() const final;
@@ -121,6 +134,11 @@ private:
   OpenGLSettings m_openGLSettings;
   std::string m_GLSLVersion;
   SDL_GLContext m_GLContext{};
+  OpenGLGPUTimer m_GPUTimer;
+  OpenGLFrameCapture m_frameCapture;
+  std::string m_screenshotRequest;
+  OpenGLVideoCapture m_videoCapture;
+  OpenGLTextureLoader m_textureLoader;
   bool m_hidden{};
   bool m_minimized{};
 };
@@ -0,0 +1,199 @@
+/**
+ * @file abcgProfiler.cpp
+ * @brief Definition of abcg::Profiler and abcg::ProfilerZone members.
+ *
+ * This file is part of ABCg (https://github.com/hbatagelo/abcg).
+ *
+ * @copyright (c) 2021--2023 Harlen Batagelo. All rights reserved.
+ * This project is released under the MIT License.
+ */
+
+#include "abcgProfiler.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#include "abcgExternal.hpp"
+
+/**
+ * @brief Returns the process-wide profiler.
+ *
+ * @return Reference to the profiler.
+ */
+abcg::Profiler &abcg::Profiler::instance() {
+  static Profiler profiler;
+  return profiler;
+}
+
+/**
+ * @brief Adds a CPU time sample to a zone of the current frame.
+ *
+ * @param zone Zone name.
+ * @param milliseconds Time spent in the zone, in milliseconds.
+ */
+void abcg::Profiler::addCPUSample(std::string_view zone, double milliseconds) {
+  findZone(zone, false).current += milliseconds;
+}
+
+/**
+ * @brief Adds a GPU time sample to a zone of the current frame.
+ *
+ * @param zone Zone name.
+ * @param milliseconds Time spent by the GPU in the zone, in milliseconds.
+ */
+void abcg::Profiler::addGPUSample(std::string_view zone, double milliseconds) {
+  findZone(zone, true).current += milliseconds;
+}
+
+/**
+ * @brief Ends the current frame.
+ *
+ * Stores the time accumulated by each zone and the time elapsed since the
+ * previous call in the history, and resets the accumulators. This is called by
+ * the window at the end of each frame.
+ */
+void abcg::Profiler::endFrame() {
+  m_frameHistory.at(m_offset) =
+      gsl::narrow_cast<float>(m_frameTimer.restart() * 1000.0);
+  for (auto &zone : m_zones) {
+    zone.history.at(m_offset) = gsl::narrow_cast<float>(zone.current);
+    zone.current = 0.0;
+  }
+  m_offset = (m_offset + 1) % historySize;
+  m_count = std::min(m_count + 1, historySize);
+}
+
+/**
+ * @brief Returns the percentiles of the frame time.
+ *
+ * @return Percentiles of the time between consecutive frames.
+ */
+abcg::ProfilerStats abcg::Profiler::getFrameStats() const {
+  return computeStats(m_frameHistory);
+}
+
+/**
+ * @brief Returns the percentiles of the time spent in a zone per frame.
+ *
+ * @param zone Zone name.
+ * @param gpu Whether this is a GPU zone.
+ *
+ * @return Percentiles of the time spent in the zone, or zeros if no such zone
+ * has been recorded.
+ */
+abcg::ProfilerStats abcg::Profiler::getZoneStats(std::string_view zone,
+                                                 bool gpu) const {
+  auto const iter{std::find_if(m_zones.begin(), m_zones.end(),
+                               [&](auto const &candidate) {
+                                 return candidate.gpu == gpu &&
+                                        candidate.name == zone;
+                               })};
+  return iter == m_zones.end() ? ProfilerStats{} : computeStats(iter->history);
+}
+
+/**
+ * @brief Renders the profiler overlay with Dear ImGui.
+ *
+ * Shows the percentiles of the frame time, and a bar per zone with the
+ * percentiles of its time per frame. Bars are scaled relative to the median
+ * frame time. Must be called between `ImGui::NewFrame` and `ImGui::Render`.
+ */
+void abcg::Profiler::paintOverlay() const {
+  auto const frameStats{getFrameStats()};
+
+  auto const &viewport{*ImGui::GetMainViewport()};
+  ImGui::SetNextWindowPos(
+      ImVec2(viewport.WorkPos.x + viewport.WorkSize.x - 5, 5),
+      ImGuiCond_Always, ImVec2(1, 0));
+  ImGui::SetNextWindowBgAlpha(0.75f);
+  ImGui::Begin("Profiler", nullptr,
+               ImGuiWindowFlags_NoDecoration |
+                   ImGuiWindowFlags_AlwaysAutoResize |
+                   ImGuiWindowFlags_NoInputs |
+                   ImGuiWindowFlags_NoBringToFrontOnFocus |
+                   ImGuiWindowFlags_NoFocusOnAppearing);
+
+  ImGui::Text("Frame: p50 %.2f  p95 %.2f  p99 %.2f ms", frameStats.p50,
+              frameStats.p95, frameStats.p99);
+
+  if (ImGui::BeginTable("Zones", 5, ImGuiTableFlags_SizingFixedFit)) {
+    ImGui::TableSetupColumn("Zone");
+    ImGui::TableSetupColumn("");
+    ImGui::TableSetupColumn("p50");
+    ImGui::TableSetupColumn("p95");
+    ImGui::TableSetupColumn("p99");
+    ImGui::TableHeadersRow();
+
+    for (auto const &zone : m_zones) {
+      auto const stats{computeStats(zone.history)};
+      auto const fraction{
+          frameStats.p50 > 0.0 ? std::min(stats.p50 / frameStats.p50, 1.0)
+                               : 0.0};
+
+      ImGui::TableNextRow();
+      ImGui::TableNextColumn();
+      ImGui::Text("%s %s", zone.gpu ? "GPU" : "CPU", zone.name.c_str());
+      ImGui::TableNextColumn();
+      ImGui::ProgressBar(gsl::narrow_cast<float>(fraction), ImVec2(100, 0), "");
+      ImGui::TableNextColumn();
+      ImGui::Text("%.2f", stats.p50);
+      ImGui::TableNextColumn();
+      ImGui::Text("%.2f", stats.p95);
+      ImGui::TableNextColumn();
+      ImGui::Text("%.2f", stats.p99);
+    }
+    ImGui::EndTable();
+  }
+
+  ImGui::End();
+}
+
+abcg::Profiler::Zone &abcg::Profiler::findZone(std::string_view name,
+                                               bool gpu) {
+  auto iter{std::find_if(m_zones.begin(), m_zones.end(),
+                         [&](auto const &candidate) {
+                           return candidate.gpu == gpu &&
+                                  candidate.name == name;
+                         })};
+  if (iter == m_zones.end()) {
+    m_zones.push_back(Zone{.name = std::string{name}, .gpu = gpu});
+    return m_zones.back();
+  }
+  return *iter;
+}
+
+abcg::ProfilerStats
+abcg::Profiler::computeStats(History const &history) const {
+  if (m_count == 0)
+    return {};
+
+  // Only the first m_count entries are valid until the history wraps around
+  std::vector<float> samples(history.begin(),
+                             history.begin() + gsl::narrow<long>(m_count));
+  std::sort(samples.begin(), samples.end());
+
+  auto const percentile{[&](double fraction) {
+    auto const rank{gsl::narrow_cast<std::size_t>(
+        std::ceil(fraction * static_cast<double>(m_count)))};
+    return static_cast<double>(samples.at(std::max<std::size_t>(rank, 1) - 1));
+  }};
+
+  return {.p50 = percentile(0.50),
+          .p95 = percentile(0.95),
+          .p99 = percentile(0.99)};
+}
+
+/**
+ * @brief Starts timing a CPU zone.
+ *
+ * @param name Zone name. Must outlive this object.
+ */
+abcg::ProfilerZone::ProfilerZone(std::string_view name)
+    : m_name{name}, m_traceZone{name} {}
+
+/**
+ * @brief Stops timing the zone and reports the elapsed time to abcg::Profiler.
+ */
+abcg::ProfilerZone::~ProfilerZone() {
+  Profiler::instance().addCPUSample(m_name, m_timer.elapsed() * 1000.0);
+}
@@ -0,0 +1,145 @@
+/**
+ * @file abcgProfiler.hpp
+ * @brief Header file of abcg::Profiler and abcg::ProfilerZone.
+ *
+ * Declaration of abcg::Profiler and abcg::ProfilerZone, and definition of the
+ * profiling macros.
+ *
+ * This file is part of ABCg (https://github.com/hbatagelo/abcg).
+ *
+ * @copyright (c) 2021--2023 Harlen Batagelo. All rights reserved.
+ * This project is released under the MIT License.
+ */
+
+#ifndef ABCG_PROFILER_HPP_
+#define ABCG_PROFILER_HPP_
+
+#include <array>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "abcgTimer.hpp"
+#include "abcgTrace.hpp"
+
+namespace abcg {
+class Profiler;
+class ProfilerZone;
+struct ProfilerStats;
+} // namespace abcg
+
+/**
+ * @brief Percentiles of the time spent in a zone, or of the frame time, over
+ * the last abcg::Profiler::historySize frames.
+ */
+struct abcg::ProfilerStats {
+  /** @brief Median, in milliseconds. */
+  double p50{};
+  /** @brief 95th percentile, in milliseconds. */
+  double p95{};
+  /** @brief 99th percentile, in milliseconds. */
+  double p99{};
+};
+
+/**
+ * @brief Collects per-frame timings of named CPU and GPU zones.
+ *
+ * CPU zones are usually timed with the ABCG_PROFILE_ZONE macro. The time of
+ * each zone is accumulated during the frame, so a zone entered several times
+ * in a frame reports the sum of its durations. abcg::Profiler::endFrame stores
+ * the accumulated times in a history of the last
+ * abcg::Profiler::historySize frames, from which percentiles are computed.
+ *
+ * GPU zones are fed by abcg::OpenGLWindow from timer queries. As query results
+ * are only read a few frames after being issued, GPU samples are accounted to
+ * the frame in which they become available.
+ *
+ * The profiler is meant to be used from the thread that runs the main loop.
+ *
+ * @sa abcg::WindowSettings::showProfiler.
+ */
+class abcg::Profiler {
+public:
+  /** @brief Number of frames kept in the history. */
+  static constexpr std::size_t historySize{240};
+
+  static Profiler &instance();
+
+  void addCPUSample(std::string_view zone, double milliseconds);
+  void addGPUSample(std::string_view zone, double milliseconds);
+  void endFrame();
+
+  [[nodiscard]] ProfilerStats getFrameStats() const;
+  [[nodiscard]] ProfilerStats getZoneStats(std::string_view zone,
+                                           bool gpu = false) const;
+
+  void paintOverlay() const;
+
+private:
+  using History = std::array<float, historySize>;
+
+  struct Zone {
+    std::string name;
+    bool gpu{};
+    double current{};
+    History history{};
+  };
+
+  Profiler() = default;
+
+  Zone &findZone(std::string_view name, bool gpu);
+  [[nodiscard]] ProfilerStats computeStats(History const &history) const;
+
+  std::vector<Zone> m_zones;
+  History m_frameHistory{};
+  std::size_t m_offset{};
+  std::size_t m_count{};
+  Timer m_frameTimer;
+};
+
+/**
+ * @brief Measures the CPU time of a scope and reports it to abcg::Profiler.
+ *
+ * The time is measured from construction to destruction. The scope is also
+ * recorded as an event of abcg::TraceRecorder, if it is recording.
+ *
+ * @sa ABCG_PROFILE_ZONE.
+ */
+class abcg::ProfilerZone {
+public:
+  explicit ProfilerZone(std::string_view name);
+  ~ProfilerZone();
+
+  ProfilerZone(ProfilerZone const &) = delete;
+  ProfilerZone(ProfilerZone &&) = delete;
+  ProfilerZone &operator=(ProfilerZone const &) = delete;
+  ProfilerZone &operator=(ProfilerZone &&) = delete;
+
+private:
+  std::string_view m_name;
+  Timer m_timer;
+  TraceZone m_traceZone;
+};
+
+// @cond Skipped by Doxygen
+#define ABCG_PROFILE_CONCAT_IMPL(a, b) a##b
+#define ABCG_PROFILE_CONCAT(a, b) ABCG_PROFILE_CONCAT_IMPL(a, b)
+// @endcond
+
+/**
+ * @brief Times the enclosing scope as a CPU zone of the given name.
+ *
+ * @param name Zone name. Must outlive the scope (e.g., a string literal).
+ *
+ * Profiling can be compiled out by defining `ABCG_DISABLE_PROFILER`.
+ */
+#if defined(ABCG_DISABLE_PROFILER)
+#define ABCG_PROFILE_ZONE(name)
+#else
+#define ABCG_PROFILE_ZONE(name)                                                \
+  abcg::ProfilerZone const ABCG_PROFILE_CONCAT(abcgProfilerZone, __LINE__) {   \
+    name                                                                       \
+  }
+#endif
+
+#endif
@@ -0,0 +1,251 @@
+/**
+ * @file abcgTrace.cpp
+ * @brief Definition of abcg::TraceRecorder and abcg::TraceZone members.
+ *
+ * This file is part of ABCg (https://github.com/hbatagelo/abcg).
+ *
+ * @copyright (c) 2021--2023 Harlen Batagelo. All rights reserved.
+ * This project is released under the MIT License.
+ */
+
+#include "abcgTrace.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <cppitertools/itertools.hpp>
+#include <fmt/core.h>
+
+#include "abcgException.hpp"
+
+namespace {
+using Clock = abcg::TraceRecorder::Clock;
+
+struct Event {
+  std::string_view name;
+  std::string_view category;
+  std::string detail;
+  Clock::time_point start;
+  Clock::time_point end;
+};
+
+// Single-producer buffer. Only the owning thread writes events; `count` is
+// published with release semantics so that a reader that acquires it sees
+// complete events.
+//
+// `generation` is the recording the events belong to. The owning thread
+// resets the buffer when it records the first event of a new recording, so no
+// other thread writes to it. `generation` is stored after the reset, with
+// release semantics, so that a reader that acquires the current generation
+// sees the reset count.
+struct ThreadBuffer {
+  std::vector<Event> events;
+  std::atomic<std::size_t> count{};
+  std::atomic<std::size_t> dropped{};
+  std::atomic<std::uint64_t> generation{};
+  std::size_t threadID{};
+};
+
+// NOLINTBEGIN(cppcoreguidelines-avoid-non-const-global-variables)
+std::atomic<bool> recording{};
+// Incremented by each call to abcg::TraceRecorder::start
+std::atomic<std::uint64_t> generation{};
+Clock::time_point epoch{};
+std::mutex registryMutex;
+std::vector<std::unique_ptr<ThreadBuffer>> registry;
+thread_local ThreadBuffer *threadBuffer{};
+// NOLINTEND(cppcoreguidelines-avoid-non-const-global-variables)
+
+ThreadBuffer &getThreadBuffer() {
+  if (threadBuffer == nullptr) {
+    auto buffer{std::make_unique<ThreadBuffer>()};
+    buffer->events.resize(abcg::TraceRecorder::eventsPerThread);
+
+    std::scoped_lock const lock{registryMutex};
+    buffer->threadID = registry.size() + 1;
+    threadBuffer = registry.emplace_back(std::move(buffer)).get();
+  }
+  return *threadBuffer;
+}
+
+std::string escapeJSON(std::string_view str) {
+  std::string escaped;
+  escaped.reserve(str.size());
+  for (auto const character : str) {
+    switch (character) {
+    case '"':
+      escaped += "\\\"";
+      break;
+    case '\\':
+      escaped += "\\\\";
+      break;
+    case '\n':
+      escaped += "\\n";
+      break;
+    default:
+      if (static_cast<unsigned char>(character) < 0x20) {
+        escaped += fmt::format("\\u{:04x}", static_cast<int>(character));
+      } else {
+        escaped += character;
+      }
+    }
+  }
+  return escaped;
+}
+
+double toMicroseconds(Clock::duration duration) {
+  return std::chrono::duration<double, std::micro>(duration).count();
+}
+} // namespace
+
+/**
+ * @brief Discards previously recorded events and starts recording.
+ */
+void abcg::TraceRecorder::start() {
+  // The buffers are not reset here, as their threads may be recording. They
+  // are reset by their own threads, and skipped by save until then.
+  std::scoped_lock const lock{registryMutex};
+  generation.fetch_add(1, std::memory_order_release);
+  epoch = Clock::now();
+  recording.store(true, std::memory_order_release);
+}
+
+/**
+ * @brief Stops recording. Recorded events are kept until the next call to
+ * abcg::TraceRecorder::start.
+ */
+void abcg::TraceRecorder::stop() {
+  recording.store(false, std::memory_order_release);
+}
+
+/**
+ * @brief Returns whether events are being recorded.
+ *
+ * @return True if recording, false otherwise.
+ */
+bool abcg::TraceRecorder::isRecording() noexcept {
+  return recording.load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief Saves the recorded events as a Chrome Trace Event JSON file.
+ *
+ * @param filename Path of the file to be written.
+ *
+ * @throw abcg::RuntimeError if the file could not be created.
+ */
+void abcg::TraceRecorder::save(std::string_view filename) {
+  std::ofstream stream{std::string{filename}};
+  if (!stream) {
+    throw abcg::RuntimeError(fmt::format("Failed to create {}", filename));
+  }
+
+  std::scoped_lock const lock{registryMutex};
+
+  stream << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+  auto first{true};
+  std::size_t dropped{};
+  auto const current{generation.load(std::memory_order_acquire)};
+  for (auto const &buffer : registry) {
+    // Events of previous recordings, not yet reset by the owning thread
+    if (buffer->generation.load(std::memory_order_acquire) != current)
+      continue;
+    auto const count{buffer->count.load(std::memory_order_acquire)};
+    dropped += buffer->dropped.load(std::memory_order_relaxed);
+    for (auto const index : iter::range(count)) {
+      auto const &event{buffer->events.at(index)};
+      stream << (first ? "\n" : ",\n");
+      first = false;
+      stream << fmt::format(
+          R"({{"name":"{}","cat":"{}","ph":"X","ts":{:.3f},"dur":{:.3f},)"
+          R"("pid":1,"tid":{})",
+          escapeJSON(event.name), escapeJSON(event.category),
+          toMicroseconds(event.start - epoch),
+          toMicroseconds(event.end - event.start), buffer->threadID);
+      if (!event.detail.empty()) {
+        stream << fmt::format(R"(,"args":{{"detail":"{}"}})",
+                              escapeJSON(event.detail));
+      }
+      stream << "}";
+    }
+  }
+  stream << "\n]}\n";
+
+  if (dropped > 0) {
+    fmt::print("Warning: {} trace events dropped (buffer full)\n", dropped);
+  }
+}
+
+/**
+ * @brief Records a complete event on the calling thread.
+ *
+ * Does nothing if not recording.
+ *
+ * @param name Event name. Must outlive the recording (e.g., a string literal).
+ * @param category Event category. Must outlive the recording.
+ * @param start Time the event started.
+ * @param end Time the event ended.
+ * @param detail Optional string shown as an argument of the event.
+ */
+void abcg::TraceRecorder::addEvent(std::string_view name,
+                                   std::string_view category,
+                                   Clock::time_point start,
+                                   Clock::time_point end,
+                                   std::string_view detail) {
+  if (!isRecording())
+    return;
+
+  auto &buffer{getThreadBuffer()};
+  if (auto const current{generation.load(std::memory_order_acquire)};
+      buffer.generation.load(std::memory_order_relaxed) != current) {
+    buffer.count.store(0, std::memory_order_relaxed);
+    buffer.dropped.store(0, std::memory_order_relaxed);
+    buffer.generation.store(current, std::memory_order_release);
+  }
+
+  auto const index{buffer.count.load(std::memory_order_relaxed)};
+  if (index >= buffer.events.size()) {
+    buffer.dropped.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+
+  auto &event{buffer.events[index]};
+  event.name = name;
+  event.category = category;
+  event.detail = detail;
+  event.start = start;
+  event.end = end;
+  buffer.count.store(index + 1, std::memory_order_release);
+}
+
+/**
+ * @brief Starts timing a trace zone.
+ *
+ * @param name Event name. Must outlive the recording (e.g., a string literal).
+ * @param category Event category. Must outlive the recording.
+ * @param detail Optional string shown as an argument of the event.
+ */
+abcg::TraceZone::TraceZone(std::string_view name, std::string_view category,
+                           std::string_view detail)
+    : m_name{name}, m_category{category},
+      m_active{TraceRecorder::isRecording()} {
+  if (m_active) {
+    m_detail = detail;
+    m_start = TraceRecorder::Clock::now();
+  }
+}
+
+/**
+ * @brief Records the event, if the recorder was recording when the zone
+ * started.
+ */
+abcg::TraceZone::~TraceZone() {
+  if (m_active) {
+    TraceRecorder::addEvent(m_name, m_category, m_start,
+                            TraceRecorder::Clock::now(), m_detail);
+  }
+}
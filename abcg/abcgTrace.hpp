@@ -0,0 +1,116 @@
+/**
+ * @file abcgTrace.hpp
+ * @brief Header file of abcg::TraceRecorder and abcg::TraceZone.
+ *
+ * Declaration of abcg::TraceRecorder and abcg::TraceZone, and definition of
+ * the tracing macros.
+ *
+ * This file is part of ABCg (https://github.com/hbatagelo/abcg).
+ *
+ * @copyright (c) 2021--2023 Harlen Batagelo. All rights reserved.
+ * This project is released under the MIT License.
+ */
+
+#ifndef ABCG_TRACE_HPP_
+#define ABCG_TRACE_HPP_
+
+#include <chrono>
+#include <string>
+#include <string_view>
+
+namespace abcg {
+class TraceRecorder;
+class TraceZone;
+} // namespace abcg
+
+/**
+ * @brief Records timeline events and saves them in the Chrome Trace Event
+ * format.
+ *
+ * The saved JSON file can be opened in `chrome://tracing` or in the Perfetto
+ * UI (https://ui.perfetto.dev).
+ *
+ * Each thread appends events to its own fixed-capacity buffer, which is
+ * registered once, on the first event of the thread. After that, recording an
+ * event takes no lock: it is a relaxed check of the recording flag, two clock
+ * reads and a store into a preallocated slot. Events that do not fit in the
+ * buffer are dropped and counted.
+ *
+ * Zones timed with ABCG_PROFILE_ZONE are recorded too, so the trace includes
+ * the window callbacks. ABCG also records frame boundaries, shader program
+ * builds, texture loads and Vulkan swapchain acquire/present.
+ *
+ * abcg::TraceRecorder::start does not touch the buffers, so it can be called
+ * while other threads record events. Each thread discards the events of the
+ * previous recording when it records its first event of the new one, and
+ * abcg::TraceRecorder::save skips the buffers that were not discarded yet.
+ */
+class abcg::TraceRecorder {
+public:
+  /** @brief Clock used for timestamps. */
+  using Clock = std::chrono::steady_clock;
+
+  /** @brief Maximum number of events recorded per thread. */
+  static constexpr std::size_t eventsPerThread{1U << 16U};
+
+  static void start();
+  static void stop();
+  [[nodiscard]] static bool isRecording() noexcept;
+  static void save(std::string_view filename);
+
+  static void addEvent(std::string_view name, std::string_view category,
+                       Clock::time_point start, Clock::time_point end,
+                       std::string_view detail = {});
+};
+
+/**
+ * @brief Records the enclosing scope as a trace event.
+ *
+ * Nothing is recorded if abcg::TraceRecorder is not recording when the object
+ * is constructed.
+ *
+ * @sa ABCG_TRACE_ZONE.
+ */
+class abcg::TraceZone {
+public:
+  explicit TraceZone(std::string_view name, std::string_view category = "abcg",
+                     std::string_view detail = {});
+  ~TraceZone();
+
+  TraceZone(TraceZone const &) = delete;
+  TraceZone(TraceZone &&) = delete;
+  TraceZone &operator=(TraceZone const &) = delete;
+  TraceZone &operator=(TraceZone &&) = delete;
+
+private:
+  std::string_view m_name;
+  std::string_view m_category;
+  std::string m_detail;
+  TraceRecorder::Clock::time_point m_start;
+  bool m_active{};
+};
+
+// @cond Skipped by Doxygen
+#define ABCG_TRACE_CONCAT_IMPL(a, b) a##b
+#define ABCG_TRACE_CONCAT(a, b) ABCG_TRACE_CONCAT_IMPL(a, b)
+// @endcond
+
+/**
+ * @brief Records the enclosing scope as a trace event.
+ *
+ * Arguments are the event name, and optionally a category and a detail string
+ * (e.g., a file path). The name and the category must outlive the scope (e.g.,
+ * string literals); the detail is copied.
+ *
+ * Tracing can be compiled out by defining `ABCG_DISABLE_TRACE`.
+ */
+#if defined(ABCG_DISABLE_TRACE)
+#define ABCG_TRACE_ZONE(...)
+#else
+#define ABCG_TRACE_ZONE(...)                                                   \
+  abcg::TraceZone const ABCG_TRACE_CONCAT(abcgTraceZone, __LINE__) {           \
+    __VA_ARGS__                                                                \
+  }
+#endif
+
+#endif
@@ -20,6 +20,7 @@
 #include "abcgVulkanImage.hpp"
 #include "abcgVulkanPipeline.hpp"
 #include "abcgVulkanShader.hpp"
+#include "abcgVulkanUploadContext.hpp"
 #include "abcgVulkanWindow.hpp"
 
 #endif
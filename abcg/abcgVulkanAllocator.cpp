@@ -0,0 +1,319 @@
+/**
+ * @file abcgVulkanAllocator.cpp
+ * @brief Definition of abcg::VulkanAllocator members.
+ *
+ * This file is part of ABCg (https://github.com/hbatagelo/abcg).
+ *
+ * @copyright (c) 2021--2023 Harlen Batagelo. All rights reserved.
+ * This project is released under the MIT License.
+ */
+
+#include "abcgVulkanAllocator.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <optional>
+
+#include <fmt/core.h>
+#include <gsl/gsl>
+
+#include "abcgException.hpp"
+
+// @cond Skipped by Doxygen
+struct abcg::VulkanMemoryBlock {
+  struct Range {
+    vk::DeviceSize offset{};
+    vk::DeviceSize size{};
+  };
+
+  vk::DeviceMemory memory;
+  vk::DeviceSize size{};
+  void *mapped{};
+  std::size_t pool{};
+  bool dedicated{};
+  bool coherent{true};
+  // Free ranges sorted by offset
+  std::vector<Range> freeRanges;
+  vk::DeviceSize allocatedBytes{};
+  std::size_t allocationCount{};
+};
+// @endcond
+
+namespace {
+using Range = abcg::VulkanMemoryBlock::Range;
+
+[[nodiscard]] constexpr vk::DeviceSize alignUp(vk::DeviceSize value,
+                                               vk::DeviceSize alignment) {
+  return (value + alignment - 1) / alignment * alignment;
+}
+
+// Takes the first free range that fits `size` bytes aligned to `alignment`.
+// The alignment padding and the remainder are kept as free ranges.
+[[nodiscard]] std::optional<vk::DeviceSize>
+takeRange(std::vector<Range> &freeRanges, vk::DeviceSize size,
+          vk::DeviceSize alignment) {
+  for (auto iter{freeRanges.begin()}; iter != freeRanges.end(); ++iter) {
+    auto const range{*iter};
+    auto const offset{alignUp(range.offset, alignment)};
+    if (offset + size > range.offset + range.size)
+      continue;
+
+    iter = freeRanges.erase(iter);
+    if (auto const end{offset + size}; end < range.offset + range.size) {
+      iter = freeRanges.insert(iter, {end, range.offset + range.size - end});
+    }
+    if (offset > range.offset) {
+      freeRanges.insert(iter, {range.offset, offset - range.offset});
+    }
+    return offset;
+  }
+  return std::nullopt;
+}
+
+// Returns a range to the free list, merging it with adjacent free ranges
+void returnRange(std::vector<Range> &freeRanges, vk::DeviceSize offset,
+                 vk::DeviceSize size) {
+  auto next{std::ranges::lower_bound(freeRanges, offset, {}, &Range::offset)};
+
+  // Merge with the next range
+  if (next != freeRanges.end() && offset + size == next->offset) {
+    size += next->size;
+    next = freeRanges.erase(next);
+  }
+  // Merge with the previous range
+  if (next != freeRanges.begin()) {
+    if (auto prev{std::prev(next)}; prev->offset + prev->size == offset) {
+      prev->size += size;
+      return;
+    }
+  }
+  freeRanges.insert(next, {offset, size});
+}
+} // namespace
+
+/**
+ * @brief Initializes the allocator. No memory is allocated.
+ *
+ * @param device Logical device.
+ * @param physicalDevice Physical device of `device`.
+ */
+void abcg::VulkanAllocator::create(vk::Device const &device,
+                                   VulkanPhysicalDevice const &physicalDevice) {
+  m_device = device;
+  m_physicalDevice = physicalDevice;
+
+  auto const physical{static_cast<vk::PhysicalDevice>(physicalDevice)};
+  m_memoryProperties = physical.getMemoryProperties();
+  m_nonCoherentAtomSize =
+      std::max(physical.getProperties().limits.nonCoherentAtomSize,
+               vk::DeviceSize{1});
+  m_pools.resize(std::size_t{m_memoryProperties.memoryTypeCount} * 2);
+}
+
+/**
+ * @brief Frees all blocks.
+ *
+ * Allocations that were not freed are reported as leaks.
+ */
+void abcg::VulkanAllocator::destroy() {
+  std::scoped_lock const lock{m_mutex};
+
+  std::size_t leaked{};
+  for (auto &pool : m_pools) {
+    for (auto &block : pool.blocks) {
+      leaked += block->allocationCount;
+      destroyBlock(*block);
+    }
+    pool.blocks.clear();
+  }
+  if (leaked > 0) {
+    fmt::print("Warning: {} Vulkan memory allocation(s) not freed\n", leaked);
+  }
+}
+
+/**
+ * @brief Sub-allocates device memory.
+ *
+ * @param requirements Memory requirements of the resource.
+ * @param properties Required memory properties.
+ * @param linear Whether the memory is for a buffer or a linear-tiling image
+ * (`true`), or for an optimal-tiling image (`false`).
+ *
+ * @throw abcg::RuntimeError if there is no memory type with the required
+ * properties.
+ *
+ * @return Allocated range.
+ */
+abcg::VulkanAllocation
+abcg::VulkanAllocator::allocate(vk::MemoryRequirements const &requirements,
+                                vk::MemoryPropertyFlags properties,
+                                bool linear) {
+  auto const memoryType{m_physicalDevice.findMemoryType(
+      requirements.memoryTypeBits, properties)};
+  if (!memoryType.has_value()) {
+    throw abcg::RuntimeError("Failed to find suitable memory type");
+  }
+
+  auto const typeFlags{
+      m_memoryProperties.memoryTypes.at(memoryType.value()).propertyFlags};
+  auto const coherent{
+      !(typeFlags & vk::MemoryPropertyFlagBits::eHostVisible) ||
+      (typeFlags & vk::MemoryPropertyFlagBits::eHostCoherent)};
+
+  // Non-coherent ranges must be flushed in multiples of nonCoherentAtomSize
+  auto alignment{std::max(requirements.alignment, vk::DeviceSize{1})};
+  auto size{requirements.size};
+  if (!coherent) {
+    alignment = std::max(alignment, m_nonCoherentAtomSize);
+    size = alignUp(size, m_nonCoherentAtomSize);
+  }
+
+  auto const heapSize{
+      m_memoryProperties.memoryHeaps
+          .at(m_memoryProperties.memoryTypes.at(memoryType.value()).heapIndex)
+          .size};
+  auto const blockSize{std::min(preferredBlockSize, heapSize / 8)};
+
+  std::scoped_lock const lock{m_mutex};
+
+  auto const poolIndex{std::size_t{memoryType.value()} * 2 + (linear ? 1 : 0)};
+  auto &pool{m_pools.at(poolIndex)};
+
+  auto const makeAllocation{[&](VulkanMemoryBlock &block,
+                                vk::DeviceSize offset) {
+    block.allocatedBytes += size;
+    ++block.allocationCount;
+    return VulkanAllocation{
+        .memory = block.memory,
+        .offset = offset,
+        .size = size,
+        .mapped = block.mapped == nullptr
+                      ? nullptr
+                      : static_cast<std::byte *>(block.mapped) + offset,
+        .block = &block};
+  }};
+
+  // Large resources get their own block
+  if (size > blockSize / 2) {
+    auto &block{createBlock(poolIndex, size, true)};
+    block.freeRanges.clear();
+    return makeAllocation(block, 0);
+  }
+
+  for (auto &block : pool.blocks) {
+    if (block->dedicated)
+      continue;
+    if (auto const offset{takeRange(block->freeRanges, size, alignment)}) {
+      return makeAllocation(*block, offset.value());
+    }
+  }
+
+  auto &block{createBlock(poolIndex, blockSize, false)};
+  auto const offset{takeRange(block.freeRanges, size, alignment)};
+  return makeAllocation(block, offset.value_or(0));
+}
+
+/**
+ * @brief Returns an allocation to its block.
+ *
+ * Empty blocks are released, except for the last block of each pool, which is
+ * kept to avoid allocating it again.
+ *
+ * @param allocation Allocation to be freed. It is reset on return.
+ */
+void abcg::VulkanAllocator::free(VulkanAllocation &allocation) {
+  if (allocation.block == nullptr)
+    return;
+
+  std::scoped_lock const lock{m_mutex};
+
+  auto &block{*allocation.block};
+  block.allocatedBytes -= allocation.size;
+  --block.allocationCount;
+  returnRange(block.freeRanges, allocation.offset, allocation.size);
+  allocation = {};
+
+  if (block.allocationCount > 0)
+    return;
+
+  auto &blocks{m_pools.at(block.pool).blocks};
+  auto const sharedBlocks{std::ranges::count_if(
+      blocks, [](auto const &other) { return !other->dedicated; })};
+  if (block.dedicated || sharedBlocks > 1) {
+    destroyBlock(block);
+    std::erase_if(blocks,
+                  [&block](auto const &other) { return other.get() == &block; });
+  }
+}
+
+/**
+ * @brief Makes host writes to a mapped allocation visible to the device.
+ *
+ * Does nothing for host-coherent memory.
+ *
+ * @param allocation Allocation to be flushed.
+ */
+void abcg::VulkanAllocator::flush(VulkanAllocation const &allocation) const {
+  if (allocation.block == nullptr || allocation.block->coherent ||
+      allocation.mapped == nullptr)
+    return;
+
+  m_device.flushMappedMemoryRanges({{.memory = allocation.memory,
+                                     .offset = allocation.offset,
+                                     .size = allocation.size}});
+}
+
+/**
+ * @brief Returns the current memory usage.
+ *
+ * @return Memory usage statistics.
+ */
+abcg::VulkanAllocatorStats abcg::VulkanAllocator::getStats() const {
+  std::scoped_lock const lock{m_mutex};
+
+  VulkanAllocatorStats stats;
+  for (auto const &pool : m_pools) {
+    for (auto const &block : pool.blocks) {
+      ++stats.blockCount;
+      stats.allocationCount += block->allocationCount;
+      stats.blockBytes += block->size;
+      stats.allocatedBytes += block->allocatedBytes;
+    }
+  }
+  return stats;
+}
+
+abcg::VulkanMemoryBlock &
+abcg::VulkanAllocator::createBlock(std::size_t poolIndex, vk::DeviceSize size,
+                                   bool dedicated) {
+  auto const memoryType{gsl::narrow<uint32_t>(poolIndex / 2)};
+
+  auto block{std::make_unique<VulkanMemoryBlock>()};
+  block->memory = m_device.allocateMemory(
+      {.allocationSize = size, .memoryTypeIndex = memoryType});
+  block->size = size;
+  block->pool = poolIndex;
+  block->dedicated = dedicated;
+  block->freeRanges.push_back({0, size});
+
+  auto const typeFlags{
+      m_memoryProperties.memoryTypes.at(memoryType).propertyFlags};
+  if (typeFlags & vk::MemoryPropertyFlagBits::eHostVisible) {
+    // Blocks are mapped once, for their whole lifetime
+    block->mapped = m_device.mapMemory(block->memory, 0, VK_WHOLE_SIZE);
+    block->coherent = static_cast<bool>(
+        typeFlags & vk::MemoryPropertyFlagBits::eHostCoherent);
+  }
+
+  auto &blocks{m_pools.at(poolIndex).blocks};
+  blocks.push_back(std::move(block));
+  return *blocks.back();
+}
+
+void abcg::VulkanAllocator::destroyBlock(VulkanMemoryBlock &block) {
+  if (block.mapped != nullptr) {
+    m_device.unmapMemory(block.memory);
+  }
+  m_device.freeMemory(block.memory);
+}
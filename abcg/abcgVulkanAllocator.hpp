@@ -0,0 +1,120 @@
+/**
+ * @file abcgVulkanAllocator.hpp
+ * @brief Header file of abcg::VulkanAllocator.
+ *
+ * Declaration of abcg::VulkanAllocator and related structures.
+ *
+ * This file is part of ABCg (https://github.com/hbatagelo/abcg).
+ *
+ * @copyright (c) 2021--2023 Harlen Batagelo. All rights reserved.
+ * This project is released under the MIT License.
+ */
+
+#ifndef ABCG_VULKAN_ALLOCATOR_HPP_
+#define ABCG_VULKAN_ALLOCATOR_HPP_
+
+#include "abcgVulkanPhysicalDevice.hpp"
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace abcg {
+struct VulkanAllocation;
+struct VulkanAllocatorStats;
+struct VulkanMemoryBlock;
+class VulkanAllocator;
+} // namespace abcg
+
+/**
+ * @brief A range of device memory sub-allocated by abcg::VulkanAllocator.
+ */
+struct abcg::VulkanAllocation {
+  /** @brief Device memory object the range belongs to. It may be shared with
+   * other allocations. */
+  vk::DeviceMemory memory{};
+  /** @brief Offset of the range in the device memory object. */
+  vk::DeviceSize offset{};
+  /** @brief Size of the range, in bytes. */
+  vk::DeviceSize size{};
+  /** @brief Host address of the range if the memory is host visible, or
+   * `nullptr` otherwise. */
+  void *mapped{};
+  /** @brief Block the range was taken from. Used internally. */
+  VulkanMemoryBlock *block{};
+};
+
+/**
+ * @brief Memory usage reported by abcg::VulkanAllocator::getStats.
+ */
+struct abcg::VulkanAllocatorStats {
+  /** @brief Number of `vkAllocateMemory` allocations (blocks). */
+  std::size_t blockCount{};
+  /** @brief Number of sub-allocations. */
+  std::size_t allocationCount{};
+  /** @brief Total size of the blocks, in bytes. */
+  vk::DeviceSize blockBytes{};
+  /** @brief Total size of the sub-allocations, in bytes. */
+  vk::DeviceSize allocatedBytes{};
+};
+
+/**
+ * @brief Sub-allocates device memory from large blocks.
+ *
+ * Memory is allocated with `vkAllocateMemory` in blocks of
+ * abcg::VulkanAllocator::preferredBlockSize bytes (or 1/8 of the heap size for
+ * small heaps), and each block is divided among many resources with a
+ * first-fit free list. Freed ranges are merged with their neighbors. This
+ * keeps the number of device memory objects far below
+ * `maxMemoryAllocationCount`. Requests larger than half a block get a
+ * dedicated block.
+ *
+ * Buffers and linear images are placed in different blocks than
+ * optimal-tiling images. Hence, resources of different kinds are never
+ * adjacent, and `bufferImageGranularity` does not have to be considered
+ * within a block.
+ *
+ * Blocks of host-visible memory are persistently mapped, as a device memory
+ * object cannot be mapped more than once at a time. For non-coherent memory,
+ * ranges are aligned to `nonCoherentAtomSize` so that they can be flushed
+ * independently with abcg::VulkanAllocator::flush.
+ *
+ * abcg::VulkanDevice owns an allocator, which is used by abcg::VulkanBuffer
+ * and abcg::VulkanImage. Allocation and deallocation are thread-safe.
+ */
+class abcg::VulkanAllocator {
+public:
+  /** @brief Default size of a block, in bytes. */
+  static constexpr vk::DeviceSize preferredBlockSize{64ULL * 1024 * 1024};
+
+  void create(vk::Device const &device,
+              VulkanPhysicalDevice const &physicalDevice);
+  void destroy();
+
+  [[nodiscard]] VulkanAllocation
+  allocate(vk::MemoryRequirements const &requirements,
+           vk::MemoryPropertyFlags properties, bool linear = true);
+  void free(VulkanAllocation &allocation);
+  void flush(VulkanAllocation const &allocation) const;
+
+  [[nodiscard]] VulkanAllocatorStats getStats() const;
+
+private:
+  struct Pool {
+    std::vector<std::unique_ptr<VulkanMemoryBlock>> blocks;
+  };
+
+  [[nodiscard]] VulkanMemoryBlock &
+  createBlock(std::size_t poolIndex, vk::DeviceSize size, bool dedicated);
+  void destroyBlock(VulkanMemoryBlock &block);
+
+  vk::Device m_device;
+  vk::PhysicalDeviceMemoryProperties m_memoryProperties;
+  VulkanPhysicalDevice m_physicalDevice;
+  vk::DeviceSize m_nonCoherentAtomSize{1};
+  // Two pools per memory type: for linear and for optimal-tiling resources
+  std::vector<Pool> m_pools;
+  mutable std::mutex m_mutex;
+};
+
+#endif
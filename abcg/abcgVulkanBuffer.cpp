@@ -9,6 +9,7 @@
  */
 
 #include "abcgVulkanBuffer.hpp"
+#include "abcgVulkanUploadContext.hpp"
 
 #include <gsl/gsl>
 
@@ -19,74 +20,59 @@
 void abcg::VulkanBuffer::create(VulkanDevice const &device,
                                 VulkanBufferCreateInfo const &createInfo) {
   m_device = static_cast<vk::Device>(device);
+  m_allocator = &device.getAllocator();
+  m_uploadContext = &device.getUploadContext();
 
-  if (createInfo.properties & vk::MemoryPropertyFlagBits::eHostVisible) {
-    std::tie(m_buffer, m_deviceMemory) = createBuffer(
-        device, createInfo.size, createInfo.usage, createInfo.properties);
-
-    if (createInfo.data.has_value()) {
-      loadData(createInfo.data.value(), createInfo.size);
-    }
-  } else if (createInfo.data.has_value()) {
-    // Use a staging buffer for mapping, and a device local buffer as the final
-    // destination
-    auto [stagingBuffer, stagingBufferMemory]{createBuffer(
-        device, createInfo.size, vk::BufferUsageFlagBits::eTransferSrc,
-        vk::MemoryPropertyFlagBits::eHostVisible |
-            vk::MemoryPropertyFlagBits::eHostCoherent)};
-
-    // Copy data to mapped staging buffer
-    // Transfer of data to the GPU will happen in the background before the next
-    // call to vkQueueSubmit
-    void *data{m_device.mapMemory(stagingBufferMemory, vk::DeviceSize{0},
-                                  createInfo.size)};
-    memcpy(data, createInfo.data->get(), createInfo.size);
-    m_device.unmapMemory(stagingBufferMemory);
-
-    // Create buffer in device local memory
-    std::tie(m_buffer, m_deviceMemory) =
-        createBuffer(device, createInfo.size,
-                     createInfo.usage | vk::BufferUsageFlagBits::eTransferDst,
-                     vk::MemoryPropertyFlagBits::eDeviceLocal);
-
-    // Copy from staging buffer to device local buffer
-    device.withCommandBuffer(
-        [this, &stagingBuffer, &createInfo](const auto &commandBuffer) {
-          commandBuffer.copyBuffer(stagingBuffer, m_buffer,
-                                   {{.size = createInfo.size}});
-        },
-        vk::QueueFlagBits::eTransfer);
-
-    // Release staging buffer
-    m_device.destroyBuffer(stagingBuffer);
-    m_device.freeMemory(stagingBufferMemory);
+  // Memory that is not host visible is filled through the upload context
+  auto usage{createInfo.usage};
+  if (!(createInfo.properties & vk::MemoryPropertyFlagBits::eHostVisible)) {
+    usage |= vk::BufferUsageFlagBits::eTransferDst;
+  }
+
+  std::tie(m_buffer, m_allocation) =
+      createBuffer(device, createInfo.size, usage, createInfo.properties);
+
+  if (createInfo.data.has_value()) {
+    loadData(createInfo.data.value(), createInfo.size);
   }
 }
 
 void abcg::VulkanBuffer::destroy() {
   m_device.destroyBuffer(m_buffer);
-  m_device.freeMemory(m_deviceMemory);
+  if (m_allocator != nullptr) {
+    m_allocator->free(m_allocation);
+  }
 }
 
 /**
  * @brief Loads data to the buffer.
  *
+ * If the buffer memory is host visible, the data is written to it directly.
+ * Otherwise, the copy is recorded in the current batch of
+ * abcg::VulkanDevice::getUploadContext, which is submitted before the next
+ * frame or call to abcg::VulkanDevice::withCommandBuffer.
+ *
  * @param data Pointer to the beginning of the data.
  * @param size Size of the data fo the copied, in bytes.
  * @param offset Offset from the beginning of the buffer memory.
  */
 void abcg::VulkanBuffer::loadData(gsl::not_null<void const *> data,
                                   vk::DeviceSize size, vk::DeviceSize offset) {
+  if (m_allocation.mapped == nullptr) {
+    m_uploadContext->uploadToBuffer(m_buffer, data, size, offset);
+    return;
+  }
   // Transfer of data to the GPU will happen in the background before the next
   // call to vkQueueSubmit
-  auto *mappedData{m_device.mapMemory(m_deviceMemory, offset, size)};
-  memcpy(mappedData, data, size);
-  m_device.unmapMemory(m_deviceMemory);
+  memcpy(static_cast<std::byte *>(m_allocation.mapped) + offset, data, size);
+  m_allocator->flush(m_allocation);
 }
 
-std::pair<vk::Buffer, vk::DeviceMemory> abcg::VulkanBuffer::createBuffer(
-    VulkanDevice const &device, vk::DeviceSize size, vk::BufferUsageFlags usage,
-    vk::MemoryPropertyFlags properties) const {
+std::pair<vk::Buffer, abcg::VulkanAllocation>
+abcg::VulkanBuffer::createBuffer(VulkanDevice const &device,
+                                 vk::DeviceSize size,
+                                 vk::BufferUsageFlags usage,
+                                 vk::MemoryPropertyFlags properties) const {
   auto const &physicalDevice{device.getPhysicalDevice()};
   auto const &queuesFamilies{physicalDevice.getQueuesFamilies()};
 
@@ -114,20 +100,14 @@ std::pair<vk::Buffer, vk::DeviceMemory> abcg::VulkanBuffer::createBuffer(
   // Get memory requirements
   auto const memoryRequirements{m_device.getBufferMemoryRequirements(buffer)};
 
-  // Allocate buffer memory
-  auto const memoryType{physicalDevice.findMemoryType(
-      memoryRequirements.memoryTypeBits, properties)};
-  if (!memoryType.has_value()) {
-    throw abcg::RuntimeError("Failed to find suitable memory type");
-  }
-  auto bufferMemory{
-      m_device.allocateMemory({.allocationSize = memoryRequirements.size,
-                               .memoryTypeIndex = memoryType.value()})};
+  // Sub-allocate buffer memory
+  auto const allocation{
+      device.getAllocator().allocate(memoryRequirements, properties)};
 
   // Associate buffer memory to buffer
-  m_device.bindBufferMemory(buffer, bufferMemory, 0);
+  m_device.bindBufferMemory(buffer, allocation.memory, allocation.offset);
 
-  return {buffer, bufferMemory};
+  return {buffer, allocation};
 }
 
 /**
@@ -141,8 +121,21 @@ abcg::VulkanBuffer::operator vk::Buffer const &() const noexcept {
  * @brief Returns the opaque handle to the device memory object associated
  * with the buffer.
  *
+ * The memory object may be shared with other resources. The buffer starts at
+ * the offset given by abcg::VulkanBuffer::getAllocation.
+ *
  * @return Device memory object.
  */
 vk::DeviceMemory const &abcg::VulkanBuffer::getDeviceMemory() const noexcept {
-  return m_deviceMemory;
+  return m_allocation.memory;
+}
+
+/**
+ * @brief Returns the memory range sub-allocated for the buffer.
+ *
+ * @return Memory allocation.
+ */
+abcg::VulkanAllocation const &
+abcg::VulkanBuffer::getAllocation() const noexcept {
+  return m_allocation;
 }
\ No newline at end of file
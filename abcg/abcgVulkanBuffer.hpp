@@ -13,11 +13,13 @@
 #ifndef ABCG_VULKAN_BUFFER_HPP_
 #define ABCG_VULKAN_BUFFER_HPP_
 
+#include "abcgVulkanAllocator.hpp"
 #include "abcgVulkanDevice.hpp"
 
 #include <gsl/pointers>
 
 namespace abcg {
+class VulkanUploadContext;
 struct VulkanBufferCreateInfo;
 class VulkanBuffer;
 } // namespace abcg
@@ -36,7 +38,9 @@ struct abcg::VulkanBufferCreateInfo {
  * @brief A class for representing a Vulkan buffer.
  *
  * This class provides helper functions for creating and managing vk::Buffer
- * objects.
+ * objects. Memory is sub-allocated from abcg::VulkanDevice::getAllocator.
+ * Device-local buffers are filled through
+ * abcg::VulkanDevice::getUploadContext.
  */
 class abcg::VulkanBuffer {
 public:
@@ -49,15 +53,18 @@ public:
   explicit operator vk::Buffer const &() const noexcept;
 
   [[nodiscard]] vk::DeviceMemory const &getDeviceMemory() const noexcept;
+  [[nodiscard]] VulkanAllocation const &getAllocation() const noexcept;
 
 private:
-  [[nodiscard]] std::pair<vk::Buffer, vk::DeviceMemory>
+  [[nodiscard]] std::pair<vk::Buffer, VulkanAllocation>
   createBuffer(VulkanDevice const &device, vk::DeviceSize size,
                vk::BufferUsageFlags usage,
                vk::MemoryPropertyFlags properties) const;
 
   vk::Buffer m_buffer;
-  vk::DeviceMemory m_deviceMemory;
+  VulkanAllocation m_allocation;
+  VulkanAllocator *m_allocator{};
+  VulkanUploadContext *m_uploadContext{};
   vk::Device m_device;
 };
 
@@ -0,0 +1,247 @@
+/**
+ * @file abcgVulkanCommandRecorder.cpp
+ * @brief Definition of abcg::VulkanCommandRecorder members.
+ *
+ * This file is part of ABCg (https://github.com/hbatagelo/abcg).
+ *
+ * @copyright (c) 2021--2023 Harlen Batagelo. All rights reserved.
+ * This project is released under the MIT License.
+ */
+
+#include "abcgVulkanCommandRecorder.hpp"
+
+#include <cppitertools/itertools.hpp>
+
+#include "abcgTrace.hpp"
+
+/**
+ * @brief Creates the command pools of each slot and starts the worker threads.
+ *
+ * The worker threads are kept when the recorder is created again with the same
+ * number of threads, e.g., when the swapchain is rebuilt.
+ *
+ * @param device Vulkan device.
+ * @param threadCount Number of recording threads, including the calling
+ * thread. Must be at least 1.
+ * @param slotCount Number of frame-in-flight slots.
+ */
+void abcg::VulkanCommandRecorder::create(VulkanDevice const &device,
+                                         uint32_t threadCount,
+                                         uint32_t slotCount) {
+  destroy();
+  m_device = static_cast<vk::Device>(device);
+
+  if (auto const count{std::max(threadCount, 1U)};
+      m_workers.size() + 1 != count) {
+    m_workers.clear();
+    m_threadCount = count;
+    m_workers.reserve(m_threadCount - 1);
+    for (auto const index : iter::range(1U, m_threadCount)) {
+      // Workers start at the current generation so they do not run a task
+      // of a previous call
+      m_workers.emplace_back([this, index, generation = m_generation](
+                                 std::stop_token const &stopToken) {
+        workerLoop(stopToken, index, generation);
+      });
+    }
+  }
+
+  auto const graphicsQueueFamily{
+      device.getPhysicalDevice().getQueuesFamilies().graphics.value_or(0)};
+
+  m_slots.resize(slotCount);
+  for (auto &slot : m_slots) {
+    slot.commandBuffers.resize(m_threadCount);
+    for ([[maybe_unused]] auto const index : iter::range(m_threadCount)) {
+      slot.commandPools.push_back(m_device.createCommandPool(
+          {.flags = vk::CommandPoolCreateFlagBits::eTransient,
+           .queueFamilyIndex = graphicsQueueFamily}));
+    }
+  }
+}
+
+/**
+ * @brief Destroys the command pools. The worker threads are kept.
+ */
+void abcg::VulkanCommandRecorder::destroy() {
+  for (auto const &slot : m_slots) {
+    // Command buffers are freed with the pools
+    for (auto const &commandPool : slot.commandPools) {
+      m_device.destroyCommandPool(commandPool);
+    }
+  }
+  m_slots.clear();
+}
+
+/**
+ * @brief Resets the command pools of a slot so that its secondary command
+ * buffers can be recorded again.
+ *
+ * Must be called only after the GPU has finished executing the command buffers
+ * of the slot.
+ *
+ * @param slot Frame-in-flight slot.
+ */
+void abcg::VulkanCommandRecorder::reset(uint32_t slot) {
+  auto &data{m_slots.at(slot)};
+  for (auto &&[commandPool, buffers] :
+       iter::zip(data.commandPools, data.commandBuffers)) {
+    m_device.resetCommandPool(commandPool);
+    buffers.used = 0;
+  }
+}
+
+/**
+ * @brief Records items in parallel into secondary command buffers and executes
+ * them into a primary command buffer.
+ *
+ * The range `[0, count)` is split into contiguous parts of similar size, one
+ * for each thread. If `count` is smaller than the number of threads, only
+ * `count` threads are used.
+ *
+ * @param slot Frame-in-flight slot whose command pools are used.
+ * @param primaryCommandBuffer Primary command buffer in which the render pass
+ * of `inheritanceInfo` was begun with
+ * `vk::SubpassContents::eSecondaryCommandBuffers`.
+ * @param inheritanceInfo Render pass, subpass and framebuffer inherited by the
+ * secondary command buffers.
+ * @param count Number of items.
+ * @param job Function that records a range of items. It is called from
+ * several threads at the same time, each with its own command buffer.
+ *
+ * @throw Rethrows the first exception thrown by `job`.
+ */
+void abcg::VulkanCommandRecorder::record(
+    uint32_t slot, vk::CommandBuffer const &primaryCommandBuffer,
+    vk::CommandBufferInheritanceInfo const &inheritanceInfo, std::size_t count,
+    Job const &job) {
+  if (count == 0)
+    return;
+
+  auto &data{m_slots.at(slot)};
+  auto const threadCount{std::min<std::size_t>(m_threadCount, count)};
+  std::vector<vk::CommandBuffer> secondaryCommandBuffers(threadCount);
+
+  run([&](std::size_t threadIndex) {
+    if (threadIndex >= threadCount)
+      return;
+
+    ABCG_TRACE_ZONE("recordSecondary", "vulkan");
+
+    // Each thread only touches its own pool
+    auto &buffers{data.commandBuffers.at(threadIndex)};
+    if (buffers.used == buffers.commandBuffers.size()) {
+      buffers.commandBuffers.push_back(
+          m_device
+              .allocateCommandBuffers(
+                  {.commandPool = data.commandPools.at(threadIndex),
+                   .level = vk::CommandBufferLevel::eSecondary,
+                   .commandBufferCount = 1})
+              .front());
+    }
+    auto const &commandBuffer{buffers.commandBuffers.at(buffers.used++)};
+
+    commandBuffer.begin(
+        {.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit |
+                  vk::CommandBufferUsageFlagBits::eRenderPassContinue,
+         .pInheritanceInfo = &inheritanceInfo});
+    job(commandBuffer, count * threadIndex / threadCount,
+        count * (threadIndex + 1) / threadCount);
+    commandBuffer.end();
+
+    secondaryCommandBuffers.at(threadIndex) = commandBuffer;
+  });
+
+  primaryCommandBuffer.executeCommands(secondaryCommandBuffers);
+}
+
+/**
+ * @brief Returns the number of recording threads, including the thread that
+ * calls abcg::VulkanCommandRecorder::record.
+ *
+ * @return Number of threads.
+ */
+uint32_t abcg::VulkanCommandRecorder::getThreadCount() const noexcept {
+  return m_threadCount;
+}
+
+/**
+ * @brief Returns the command pools of a slot, one for each recording thread.
+ *
+ * @param slot Frame-in-flight slot.
+ *
+ * @return Command pools, indexed by thread.
+ */
+std::vector<vk::CommandPool> const &
+abcg::VulkanCommandRecorder::getCommandPools(uint32_t slot) const {
+  return m_slots.at(slot).commandPools;
+}
+
+// Calls task(threadIndex) on every thread and waits for all of them
+void abcg::VulkanCommandRecorder::run(
+    std::function<void(std::size_t)> const &task) {
+  if (m_workers.empty()) {
+    task(0);
+    return;
+  }
+
+  {
+    std::scoped_lock const lock{m_mutex};
+    m_task = &task;
+    m_remaining = m_workers.size();
+    m_error = nullptr;
+    ++m_generation;
+  }
+  m_startCondition.notify_all();
+
+  std::exception_ptr error;
+  try {
+    task(0);
+  } catch (...) {
+    error = std::current_exception();
+  }
+
+  std::unique_lock lock{m_mutex};
+  m_doneCondition.wait(lock, [this] { return m_remaining == 0; });
+  if (!error) {
+    error = m_error;
+  }
+  lock.unlock();
+
+  if (error) {
+    std::rethrow_exception(error);
+  }
+}
+
+void abcg::VulkanCommandRecorder::workerLoop(std::stop_token const &stopToken,
+                                             std::size_t threadIndex,
+                                             uint64_t generation) {
+  while (true) {
+    std::function<void(std::size_t)> const *task{};
+    {
+      std::unique_lock lock{m_mutex};
+      if (!m_startCondition.wait(lock, stopToken, [&] {
+            return m_generation != generation;
+          })) {
+        return;
+      }
+      generation = m_generation;
+      task = m_task;
+    }
+
+    std::exception_ptr error;
+    try {
+      (*task)(threadIndex);
+    } catch (...) {
+      error = std::current_exception();
+    }
+
+    std::scoped_lock const lock{m_mutex};
+    if (error && !m_error) {
+      m_error = error;
+    }
+    if (--m_remaining == 0) {
+      m_doneCondition.notify_one();
+    }
+  }
+}
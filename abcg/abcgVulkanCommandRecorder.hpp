@@ -0,0 +1,103 @@
+/**
+ * @file abcgVulkanCommandRecorder.hpp
+ * @brief Header file of abcg::VulkanCommandRecorder.
+ *
+ * Declaration of abcg::VulkanCommandRecorder.
+ *
+ * This file is part of ABCg (https://github.com/hbatagelo/abcg).
+ *
+ * @copyright (c) 2021--2023 Harlen Batagelo. All rights reserved.
+ * This project is released under the MIT License.
+ */
+
+#ifndef ABCG_VULKAN_COMMAND_RECORDER_HPP_
+#define ABCG_VULKAN_COMMAND_RECORDER_HPP_
+
+#include "abcgVulkanDevice.hpp"
+
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace abcg {
+class VulkanCommandRecorder;
+} // namespace abcg
+
+/**
+ * @brief Records secondary command buffers in parallel.
+ *
+ * The recorder keeps a pool of worker threads and, for each frame-in-flight
+ * slot, one command pool per thread. Each call to
+ * abcg::VulkanCommandRecorder::record splits a range of items among the
+ * threads. The calling thread takes part as thread 0. Each thread records its
+ * part into a secondary command buffer allocated from its own pool, so no
+ * synchronization is needed while recording. The secondary command buffers are
+ * then executed into the primary command buffer in thread order.
+ *
+ * Secondary command buffers are reused after the command pools of a slot are
+ * reset with abcg::VulkanCommandRecorder::reset.
+ *
+ * abcg::VulkanSwapchain owns a recorder, which is used through
+ * abcg::VulkanFrame::recordParallel.
+ *
+ * @remark abcg::VulkanCommandRecorder::record must not be called concurrently.
+ */
+class abcg::VulkanCommandRecorder {
+public:
+  /**
+   * @brief Function that records the commands of items `first` to `last - 1`
+   * into a secondary command buffer.
+   */
+  using Job = std::function<void(vk::CommandBuffer const &commandBuffer,
+                                 std::size_t first, std::size_t last)>;
+
+  void create(VulkanDevice const &device, uint32_t threadCount,
+              uint32_t slotCount);
+  void destroy();
+  void reset(uint32_t slot);
+  void record(uint32_t slot, vk::CommandBuffer const &primaryCommandBuffer,
+              vk::CommandBufferInheritanceInfo const &inheritanceInfo,
+              std::size_t count, Job const &job);
+
+  [[nodiscard]] uint32_t getThreadCount() const noexcept;
+  [[nodiscard]] std::vector<vk::CommandPool> const &
+  getCommandPools(uint32_t slot) const;
+
+private:
+  struct ThreadCommandBuffers {
+    std::vector<vk::CommandBuffer> commandBuffers;
+    std::size_t used{};
+  };
+
+  struct Slot {
+    // One command pool and list of secondary command buffers per thread
+    std::vector<vk::CommandPool> commandPools;
+    std::vector<ThreadCommandBuffers> commandBuffers;
+  };
+
+  void run(std::function<void(std::size_t)> const &task);
+  void workerLoop(std::stop_token const &stopToken, std::size_t threadIndex,
+                  uint64_t generation);
+
+  vk::Device m_device;
+  uint32_t m_threadCount{1};
+  std::vector<Slot> m_slots;
+
+  // Synchronization of the worker threads
+  std::mutex m_mutex;
+  std::condition_variable_any m_startCondition;
+  std::condition_variable m_doneCondition;
+  std::function<void(std::size_t)> const *m_task{};
+  uint64_t m_generation{};
+  std::size_t m_remaining{};
+  std::exception_ptr m_error;
+
+  // Declared last so that the threads are joined before the members above
+  // are destroyed
+  std::vector<std::jthread> m_workers;
+};
+
+#endif
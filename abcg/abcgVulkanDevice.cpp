@@ -9,14 +9,63 @@
  */
 
 #include "abcgVulkanDevice.hpp"
+#include "abcgVulkanAllocator.hpp"
+#include "abcgVulkanUploadContext.hpp"
 
 #include <gsl/gsl>
 
+#include <cstring>
+#include <filesystem>
+#include <fstream>
 #include <set>
 
+namespace {
+// Returns the contents of a pipeline cache file if it was created by the same
+// driver and device. Otherwise, returns an empty vector.
+[[nodiscard]] std::vector<char>
+loadPipelineCacheData(std::string_view filename,
+                      vk::PhysicalDeviceProperties const &properties) {
+  std::ifstream stream(std::string{filename}, std::ios::binary);
+  if (!stream)
+    return {};
+
+  std::vector<char> data{std::istreambuf_iterator<char>{stream},
+                         std::istreambuf_iterator<char>{}};
+
+  VkPipelineCacheHeaderVersionOne header{};
+  if (data.size() < sizeof(header))
+    return {};
+  std::memcpy(&header, data.data(), sizeof(header));
+
+  if (header.headerSize < sizeof(header) ||
+      header.headerVersion != VK_PIPELINE_CACHE_HEADER_VERSION_ONE ||
+      header.vendorID != properties.vendorID ||
+      header.deviceID != properties.deviceID ||
+      std::memcmp(header.pipelineCacheUUID, properties.pipelineCacheUUID.data(),
+                  VK_UUID_SIZE) != 0) {
+    return {};
+  }
+  return data;
+}
+} // namespace
+
+/**
+ * @brief Creates the logical device, its queues, command pools, pipeline
+ * cache, memory allocator and upload context.
+ *
+ * @param physicalDevice Physical device.
+ * @param extensions Device extensions to be enabled.
+ * @param pipelineCacheFile Path of the file the pipeline cache is loaded from
+ * and saved to by abcg::VulkanDevice::destroy. The contents of the file are
+ * only used if they were created for the same device, as identified by the
+ * vendor ID, device ID and pipeline cache UUID of the physical device
+ * properties. If empty, the cache is not persisted.
+ */
 void abcg::VulkanDevice::create(VulkanPhysicalDevice const &physicalDevice,
-                                std::vector<char const *> const &extensions) {
+                                std::vector<char const *> const &extensions,
+                                std::string_view pipelineCacheFile) {
   m_physicalDevice = physicalDevice;
+  m_pipelineCacheFile = pipelineCacheFile;
   auto const &queuesFamilies{m_physicalDevice.getQueuesFamilies()};
   auto const graphicsQueueFamily{queuesFamilies.graphics.value_or(0)};
   auto const presentQueueFamily{queuesFamilies.present.value_or(0)};
@@ -66,9 +115,30 @@ void abcg::VulkanDevice::create(VulkanPhysicalDevice const &physicalDevice,
   }
 
   createCommandPools();
+  createPipelineCache();
+
+  m_allocator = std::make_shared<VulkanAllocator>();
+  m_allocator->create(m_device, m_physicalDevice);
+
+  m_uploadContext = std::make_shared<VulkanUploadContext>();
+  m_uploadContext->create(*this);
 }
 
+/**
+ * @brief Saves the pipeline cache and destroys the logical device.
+ *
+ * Buffers and images must be destroyed before.
+ */
 void abcg::VulkanDevice::destroy() {
+  if (m_uploadContext) {
+    m_uploadContext->destroy();
+    m_uploadContext.reset();
+  }
+  if (m_allocator) {
+    m_allocator->destroy();
+    m_allocator.reset();
+  }
+  destroyPipelineCache();
   destroyCommandPools();
   m_device.destroy();
 }
@@ -109,10 +179,45 @@ abcg::VulkanDevice::getCommandPools() const noexcept {
   return m_commandPools;
 }
 
+/**
+ * @brief Returns the pipeline cache.
+ *
+ * abcg::VulkanPipeline uses this cache when
+ * abcg::VulkanPipelineCreateInfo::pipelineCache is not set.
+ *
+ * @return Pipeline cache shared by all pipelines created with this device.
+ */
+vk::PipelineCache const &abcg::VulkanDevice::getPipelineCache() const noexcept {
+  return m_pipelineCache;
+}
+
+/**
+ * @brief Returns the device memory allocator.
+ *
+ * @return Allocator used by abcg::VulkanBuffer and abcg::VulkanImage.
+ */
+abcg::VulkanAllocator &abcg::VulkanDevice::getAllocator() const noexcept {
+  return *m_allocator;
+}
+
+/**
+ * @brief Returns the upload context.
+ *
+ * @return Upload context used by abcg::VulkanBuffer and abcg::VulkanImage to
+ * copy data to device-local memory.
+ */
+abcg::VulkanUploadContext &
+abcg::VulkanDevice::getUploadContext() const noexcept {
+  return *m_uploadContext;
+}
+
 /**
  * @brief Allocates and creates a command buffer to be immediately submitted and
  * released.
  *
+ * Pending uploads of abcg::VulkanDevice::getUploadContext are flushed first,
+ * so the command buffer can use the resources they fill.
+ *
  * @param fun Function to be called between the begin and end calls of the
  * command buffer.
  * @param queueFlag Which command pool queue will be used. The graphics queue
@@ -123,6 +228,8 @@ abcg::VulkanDevice::getCommandPools() const noexcept {
 void abcg::VulkanDevice::withCommandBuffer(
     std::function<void(vk::CommandBuffer const &commandBuffer)> const &fun,
     vk::QueueFlagBits queueFlag, vk::CommandBufferLevel level) const {
+  m_uploadContext->flush();
+
   vk::Queue const *queue{};
   vk::CommandPool const *commandPool{};
 
@@ -213,3 +320,44 @@ void abcg::VulkanDevice::destroyCommandPools() {
 
   m_device.destroyCommandPool(m_commandPools.graphics);
 }
+
+void abcg::VulkanDevice::createPipelineCache() {
+  std::vector<char> initialData;
+  if (!m_pipelineCacheFile.empty()) {
+    initialData = loadPipelineCacheData(
+        m_pipelineCacheFile,
+        static_cast<vk::PhysicalDevice>(m_physicalDevice).getProperties());
+  }
+
+  m_pipelineCache = m_device.createPipelineCache(
+      {.initialDataSize = initialData.size(),
+       .pInitialData = initialData.data()});
+}
+
+void abcg::VulkanDevice::destroyPipelineCache() {
+  if (!m_pipelineCache)
+    return;
+
+  if (!m_pipelineCacheFile.empty()) {
+    auto const data{m_device.getPipelineCacheData(m_pipelineCache)};
+
+    // Write to a temporary file first and replace the cache only if the
+    // whole file was written, so that a failed or interrupted write does not
+    // leave a truncated cache. Failing to save the cache is not an error.
+    auto const tempFile{m_pipelineCacheFile + ".tmp"};
+    std::ofstream stream(tempFile, std::ios::binary);
+    stream.write(reinterpret_cast<char const *>(data.data()),
+                 gsl::narrow<std::streamsize>(data.size()));
+    stream.close();
+    std::error_code errorCode;
+    if (stream) {
+      std::filesystem::rename(tempFile, m_pipelineCacheFile, errorCode);
+    }
+    if (!stream || errorCode) {
+      std::filesystem::remove(tempFile, errorCode);
+    }
+  }
+
+  m_device.destroyPipelineCache(m_pipelineCache);
+  m_pipelineCache = nullptr;
+}
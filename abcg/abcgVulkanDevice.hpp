@@ -16,13 +16,18 @@
 #include "abcgVulkanPhysicalDevice.hpp"
 
 #include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
 
 namespace abcg {
+class VulkanAllocator;
 struct VulkanCommandPools;
 struct VulkanQueues;
 class VulkanDevice;
 class VulkanPipeline;
 class VulkanSwapchain;
+class VulkanUploadContext;
 class VulkanWindow;
 } // namespace abcg
 
@@ -50,12 +55,14 @@ struct abcg::VulkanQueues {
  * resources.
  *
  * This class creates and manages the Vulkan logical device, queues, descriptor
- * pool, and command pools.
+ * pool, command pools, the pipeline cache shared by all pipelines, and the
+ * memory allocator and upload context shared by all buffers and images.
  */
 class abcg::VulkanDevice {
 public:
   void create(VulkanPhysicalDevice const &physicalDevice,
-              std::vector<char const *> const &extensions = {});
+              std::vector<char const *> const &extensions = {},
+              std::string_view pipelineCacheFile = {});
   void destroy();
 
   explicit operator vk::Device const &() const noexcept;
@@ -63,6 +70,9 @@ public:
   [[nodiscard]] VulkanPhysicalDevice const &getPhysicalDevice() const noexcept;
   [[nodiscard]] VulkanQueues const &getQueues() const noexcept;
   [[nodiscard]] VulkanCommandPools const &getCommandPools() const noexcept;
+  [[nodiscard]] vk::PipelineCache const &getPipelineCache() const noexcept;
+  [[nodiscard]] VulkanAllocator &getAllocator() const noexcept;
+  [[nodiscard]] VulkanUploadContext &getUploadContext() const noexcept;
 
   void withCommandBuffer(
       std::function<void(vk::CommandBuffer const &commandBuffer)> const &fun,
@@ -72,11 +82,18 @@ public:
 private:
   void createCommandPools();
   void destroyCommandPools();
+  void createPipelineCache();
+  void destroyPipelineCache();
 
   vk::Device m_device;
   VulkanPhysicalDevice m_physicalDevice;
   VulkanCommandPools m_commandPools;
   VulkanQueues m_queues;
+  vk::PipelineCache m_pipelineCache;
+  std::string m_pipelineCacheFile;
+  // Shared by copies of this object
+  std::shared_ptr<VulkanAllocator> m_allocator;
+  std::shared_ptr<VulkanUploadContext> m_uploadContext;
 };
 
 #endif
\ No newline at end of file
@@ -9,18 +9,68 @@
  */
 
 #include "abcgVulkanImage.hpp"
-#include "abcgVulkanBuffer.hpp"
+#include "abcgKTX2.hpp"
+#include "abcgVulkanUploadContext.hpp"
 
 #include <SDL_image.h>
 #include <cppitertools/itertools.hpp>
 #include <fmt/core.h>
 #include <gsl/gsl>
 
+#include <set>
+#include <vector>
+
 #include "abcgException.hpp"
 
+namespace {
+// Returns the queue families that share the images filled by the upload
+// context, or an empty vector if the transfer queue is in the graphics family.
+// These images are written on the transfer queue and read on the other
+// queues, so they use concurrent sharing instead of ownership transfers, as
+// abcg::VulkanBuffer does.
+[[nodiscard]] std::vector<uint32_t>
+getUploadQueueFamilies(abcg::VulkanDevice const &device) {
+  auto const &queuesFamilies{device.getPhysicalDevice().getQueuesFamilies()};
+  if (!queuesFamilies.transfer.has_value() ||
+      queuesFamilies.transfer == queuesFamilies.graphics)
+    return {};
+
+  std::set indices{queuesFamilies.graphics.value_or(VK_QUEUE_FAMILY_IGNORED),
+                   queuesFamilies.compute.value_or(VK_QUEUE_FAMILY_IGNORED),
+                   queuesFamilies.transfer.value_or(VK_QUEUE_FAMILY_IGNORED)};
+  indices.erase(VK_QUEUE_FAMILY_IGNORED);
+  if (indices.size() < 2)
+    return {};
+  return {indices.begin(), indices.end()};
+}
+} // namespace
+
+/**
+ * @brief Creates a sampled image from an image file.
+ *
+ * PNG and JPEG images are decoded and uploaded as RGBA8 sRGB. KTX2 files
+ * (`.ktx2` extension) are memory-mapped and their mip levels are uploaded as
+ * stored, in the format of the file, without decoding. KTX2 cubemaps and
+ * arrays are supported.
+ *
+ * @param device Vulkan device.
+ * @param path Path to the image file (PNG, JPEG or KTX2).
+ * @param generateMipmaps Whether to generate mipmap levels. For KTX2 files,
+ * mipmap levels are generated only if the file stores a single uncompressed
+ * level of a 2D image.
+ *
+ * @throw abcg::RuntimeError if the image could not be loaded, or if the format
+ * of a KTX2 file is not supported by the device.
+ */
 void abcg::VulkanImage::create(VulkanDevice const &device,
                                std::string_view path, bool generateMipmaps) {
   m_device = static_cast<vk::Device>(device);
+  m_allocator = &device.getAllocator();
+
+  if (isKTX2Path(path)) {
+    createFromKTX2(device, path, generateMipmaps);
+    return;
+  }
 
   // Load the bitmap
   if (SDL_Surface *const surface{IMG_Load(path.data())}) {
@@ -40,22 +90,12 @@ void abcg::VulkanImage::create(VulkanDevice const &device,
                     1;
     }
 
-    // Create staging buffer
-    abcg::VulkanBuffer stagingBuffer{};
-    stagingBuffer.create(
-        device, {.size = imageSize,
-                 .usage = vk::BufferUsageFlagBits::eTransferSrc,
-                 .properties = vk::MemoryPropertyFlagBits::eHostVisible |
-                               vk::MemoryPropertyFlagBits::eHostCoherent,
-                 .data = formattedSurface->pixels});
-
-    SDL_FreeSurface(formattedSurface);
-
     // TODO: Look for other formats if RGBA8 is not supported
     auto const imageFormat{vk::Format::eR8G8B8A8Srgb};
 
     // Create image buffer
-    std::tie(m_image, m_deviceMemory) = createImage(
+    auto const queueFamilyIndices{getUploadQueueFamilies(device)};
+    std::tie(m_image, m_allocation) = createImage(
         device,
         {.imageType = vk::ImageType::e2D,
          .format = imageFormat,
@@ -69,88 +109,46 @@ void abcg::VulkanImage::create(VulkanDevice const &device,
                        : vk::ImageUsageFlagBits::eTransferDst) |
                   vk::ImageUsageFlagBits::eTransferDst |
                   vk::ImageUsageFlagBits::eSampled,
+         .sharingMode = queueFamilyIndices.empty()
+                            ? vk::SharingMode::eExclusive
+                            : vk::SharingMode::eConcurrent,
+         .queueFamilyIndexCount =
+             gsl::narrow<uint32_t>(queueFamilyIndices.size()),
+         .pQueueFamilyIndices = queueFamilyIndices.data(),
          .initialLayout = vk::ImageLayout::eUndefined},
         vk::MemoryPropertyFlagBits::eDeviceLocal);
 
-    transitionImageLayout(device, vk::ImageLayout::eUndefined,
-                          vk::ImageLayout::eTransferDstOptimal,
-                          {.aspectMask = vk::ImageAspectFlagBits::eColor,
-                           .levelCount = m_mipLevels,
-                           .layerCount = 1});
-
-    vk::BufferImageCopy const region{
-        .imageSubresource = {.aspectMask = vk::ImageAspectFlagBits::eColor,
-                             .layerCount = 1},
-        .imageExtent = {texWidth, texHeight, 1}};
-
-    // Execute the layout transition
-    device.withCommandBuffer(
-        [&stagingBuffer, this,
-         &region](vk::CommandBuffer const &commandBuffer) {
-          commandBuffer.copyBufferToImage(
-              static_cast<vk::Buffer>(stagingBuffer), m_image,
-              vk::ImageLayout::eTransferDstOptimal, region);
-        },
-        vk::QueueFlagBits::eTransfer);
-
-    // Generate the mipmap levels
+    // Record the copy of the base level in the current upload batch. Mipmap
+    // generation transitions the image to eShaderReadOnlyOptimal.
+    device.getUploadContext().uploadToImage(
+        m_image, formattedSurface->pixels, imageSize,
+        {.imageSubresource = {.aspectMask = vk::ImageAspectFlagBits::eColor,
+                              .layerCount = 1},
+         .imageExtent = {texWidth, texHeight, 1}},
+        {.aspectMask = vk::ImageAspectFlagBits::eColor,
+         .levelCount = m_mipLevels,
+         .layerCount = 1},
+        m_mipLevels > 1 ? vk::ImageLayout::eTransferDstOptimal
+                        : vk::ImageLayout::eShaderReadOnlyOptimal);
+
+    SDL_FreeSurface(formattedSurface);
+
+    // Generate the mipmap levels on the graphics queue
     if (m_mipLevels > 1) {
-      // Transitioned to vk::ImageLayout::eShaderReadOnlyOptimal while
-      // generating the mipmaps
       createMipmaps(device, m_image, imageFormat, texWidth, texHeight,
                     m_mipLevels);
-    } else {
-      transitionImageLayout(device, vk::ImageLayout::eTransferDstOptimal,
-                            vk::ImageLayout::eReadOnlyOptimal,
-                            {.aspectMask = vk::ImageAspectFlagBits::eColor,
-                             .levelCount = m_mipLevels,
-                             .layerCount = 1});
     }
 
-    stagingBuffer.destroy();
-
     // Create image view
     m_imageView = m_device.createImageView(
         {.image = m_image,
          .viewType = vk::ImageViewType::e2D,
          .format = imageFormat,
          .subresourceRange = {.aspectMask = vk::ImageAspectFlagBits::eColor,
-                              .levelCount = 1,
+                              .levelCount = m_mipLevels,
                               .layerCount = 1}});
 
-    // Create sampler
-    vk::SamplerCreateInfo samplerCreateInfo{
-        .magFilter = vk::Filter::eLinear,
-        .minFilter = vk::Filter::eLinear,
-        .mipmapMode = vk::SamplerMipmapMode::eLinear,
-        .addressModeU = vk::SamplerAddressMode::eRepeat,
-        .addressModeV = vk::SamplerAddressMode::eRepeat,
-        .addressModeW = vk::SamplerAddressMode::eRepeat,
-        .mipLodBias = 0.0f,
-        .anisotropyEnable = VK_TRUE,
-        .maxAnisotropy =
-            static_cast<vk::PhysicalDevice>(device.getPhysicalDevice())
-                .getProperties()
-                .limits.maxSamplerAnisotropy,
-        .compareEnable = VK_FALSE,
-        .compareOp = vk::CompareOp::eAlways,
-        .minLod = 0.0f,
-        .maxLod = 0.0f,
-        .borderColor = vk::BorderColor::eIntOpaqueBlack,
-        .unnormalizedCoordinates = VK_FALSE};
-
-    if (m_mipLevels > 1) {
-      samplerCreateInfo.mipmapMode = vk::SamplerMipmapMode::eLinear;
-      samplerCreateInfo.maxLod = gsl::narrow<float>(m_mipLevels);
-      // samplerCreateInfo.minLod = gsl::narrow<float>(m_mipLevels >> 1);
-    }
-    m_sampler = m_device.createSampler(samplerCreateInfo);
-
-    // Create descriptor info
-    m_descriptorImageInfo = {.sampler = m_sampler,
-                             .imageView = m_imageView,
-                             .imageLayout =
-                                 vk::ImageLayout::eShaderReadOnlyOptimal};
+    createSampler(device);
   } else {
     throw abcg::RuntimeError(
         fmt::format("Failed to load texture file {}", path));
@@ -160,10 +158,11 @@ void abcg::VulkanImage::create(VulkanDevice const &device,
 void abcg::VulkanImage::create(VulkanDevice const &device,
                                VulkanImageCreateInfo const &createInfo) {
   m_device = static_cast<vk::Device>(device);
+  m_allocator = &device.getAllocator();
 
   // Create image only if createInfo.viewInfo.image is undefined
   if (!createInfo.viewInfo.image) {
-    std::tie(m_image, m_deviceMemory) =
+    std::tie(m_image, m_allocation) =
         createImage(device, createInfo.info, createInfo.properties);
   }
 
@@ -185,8 +184,8 @@ void abcg::VulkanImage::destroy() {
   if (m_image) {
     m_device.destroyImage(m_image);
   }
-  if (m_deviceMemory) {
-    m_device.freeMemory(m_deviceMemory);
+  if (m_allocator != nullptr) {
+    m_allocator->free(m_allocation);
   }
 }
 
@@ -201,10 +200,23 @@ abcg::VulkanImage::operator vk::Image const &() const noexcept {
  * @brief Returns the opaque handle to the device memory object associated
  * with this image.
  *
+ * The memory object may be shared with other resources. The image starts at
+ * the offset given by abcg::VulkanImage::getAllocation.
+ *
  * @return Device memory object.
  */
 vk::DeviceMemory const &abcg::VulkanImage::getDeviceMemory() const noexcept {
-  return m_deviceMemory;
+  return m_allocation.memory;
+}
+
+/**
+ * @brief Returns the memory range sub-allocated for this image.
+ *
+ * @return Memory allocation.
+ */
+abcg::VulkanAllocation const &
+abcg::VulkanImage::getAllocation() const noexcept {
+  return m_allocation;
 }
 
 /**
@@ -233,7 +245,8 @@ abcg::VulkanImage::getDescriptorImageInfo() const noexcept {
  * If the image is created with `generateMipmaps = false`, the number of
  * mipmap levels is always 1. Otherwise, it is computed as \f$\lfloor
  * \log_2(\max(w, h)) \rfloor + 1\f$, where \f$w\f$ and \f$h\f$ are the
- * texture width and height.
+ * texture width and height. For KTX2 files, it is the number of levels
+ * stored in the file.
  *
  * @return Number of mipmap levels.
  */
@@ -241,7 +254,152 @@ uint32_t abcg::VulkanImage::getMipLevels() const noexcept {
   return m_mipLevels;
 }
 
-std::pair<vk::Image, vk::DeviceMemory>
+void abcg::VulkanImage::createFromKTX2(VulkanDevice const &device,
+                                       std::string_view path,
+                                       bool generateMipmaps) {
+  KTX2Texture texture;
+  texture.open(path);
+
+  auto const &info{texture.getFormat()};
+  auto const imageFormat{static_cast<vk::Format>(info.vkFormat)};
+  auto const physicalDevice{
+      static_cast<vk::PhysicalDevice>(device.getPhysicalDevice())};
+  auto const formatFeatures{
+      physicalDevice.getFormatProperties(imageFormat).optimalTilingFeatures};
+  if (!(formatFeatures & vk::FormatFeatureFlagBits::eSampledImage)) {
+    throw abcg::RuntimeError(fmt::format(
+        "KTX2 format {} of {} is not supported by the device", info.vkFormat,
+        path));
+  }
+
+  auto const texWidth{texture.getWidth()};
+  auto const texHeight{texture.getHeight()};
+  auto const isCubemap{texture.getFaceCount() == 6};
+  auto const layerCount{texture.getLayerCount() * texture.getFaceCount()};
+
+  // Levels stored in the file are uploaded as they are. A single uncompressed
+  // level can be extended with blits, as with PNG and JPEG images.
+  m_mipLevels = texture.getLevelCount();
+  auto const blitMipmaps{generateMipmaps && m_mipLevels == 1 &&
+                         !info.compressed && layerCount == 1};
+  if (blitMipmaps) {
+    m_mipLevels = gsl::narrow<uint32_t>(
+                      std::floor(std::log2(std::max(texWidth, texHeight)))) +
+                  1;
+  }
+
+  vk::ImageCreateFlags flags{};
+  if (isCubemap) {
+    flags = vk::ImageCreateFlagBits::eCubeCompatible;
+  }
+
+  auto const queueFamilyIndices{getUploadQueueFamilies(device)};
+  std::tie(m_image, m_allocation) = createImage(
+      device,
+      {.flags = flags,
+       .imageType = vk::ImageType::e2D,
+       .format = imageFormat,
+       .extent = {.width = texWidth, .height = texHeight, .depth = 1},
+       .mipLevels = m_mipLevels,
+       .arrayLayers = layerCount,
+       .samples = vk::SampleCountFlagBits::e1,
+       .tiling = vk::ImageTiling::eOptimal,
+       .usage = (blitMipmaps // Required for blit ops
+                     ? vk::ImageUsageFlagBits::eTransferSrc
+                     : vk::ImageUsageFlagBits::eTransferDst) |
+                vk::ImageUsageFlagBits::eTransferDst |
+                vk::ImageUsageFlagBits::eSampled,
+       .sharingMode = queueFamilyIndices.empty()
+                          ? vk::SharingMode::eExclusive
+                          : vk::SharingMode::eConcurrent,
+       .queueFamilyIndexCount =
+           gsl::narrow<uint32_t>(queueFamilyIndices.size()),
+       .pQueueFamilyIndices = queueFamilyIndices.data(),
+       .initialLayout = vk::ImageLayout::eUndefined},
+      vk::MemoryPropertyFlagBits::eDeviceLocal);
+
+  // Each level is copied straight from the mapped file into the staging ring.
+  // The images of all layers and faces of a level are contiguous and tightly
+  // packed, as expected by vkCmdCopyBufferToImage.
+  for (auto const level : iter::range(texture.getLevelCount())) {
+    auto const data{texture.getLevel(level)};
+    device.getUploadContext().uploadToImage(
+        m_image, data.data(), data.size(),
+        {.imageSubresource = {.aspectMask = vk::ImageAspectFlagBits::eColor,
+                              .mipLevel = level,
+                              .layerCount = layerCount},
+         .imageExtent = {texture.getWidth(level), texture.getHeight(level),
+                         1}},
+        {.aspectMask = vk::ImageAspectFlagBits::eColor,
+         .baseMipLevel = level,
+         .levelCount = blitMipmaps ? m_mipLevels : 1,
+         .layerCount = layerCount},
+        blitMipmaps && m_mipLevels > 1
+            ? vk::ImageLayout::eTransferDstOptimal
+            : vk::ImageLayout::eShaderReadOnlyOptimal,
+        info.bytesPerBlock);
+  }
+
+  if (blitMipmaps && m_mipLevels > 1) {
+    createMipmaps(device, m_image, imageFormat, texWidth, texHeight,
+                  m_mipLevels);
+  }
+
+  auto viewType{vk::ImageViewType::e2D};
+  if (isCubemap) {
+    viewType = texture.getLayerCount() > 1 ? vk::ImageViewType::eCubeArray
+                                           : vk::ImageViewType::eCube;
+  } else if (layerCount > 1) {
+    viewType = vk::ImageViewType::e2DArray;
+  }
+
+  m_imageView = m_device.createImageView(
+      {.image = m_image,
+       .viewType = viewType,
+       .format = imageFormat,
+       .subresourceRange = {.aspectMask = vk::ImageAspectFlagBits::eColor,
+                            .levelCount = m_mipLevels,
+                            .layerCount = layerCount}});
+
+  createSampler(device);
+}
+
+void abcg::VulkanImage::createSampler(VulkanDevice const &device) {
+  vk::SamplerCreateInfo samplerCreateInfo{
+      .magFilter = vk::Filter::eLinear,
+      .minFilter = vk::Filter::eLinear,
+      .mipmapMode = vk::SamplerMipmapMode::eLinear,
+      .addressModeU = vk::SamplerAddressMode::eRepeat,
+      .addressModeV = vk::SamplerAddressMode::eRepeat,
+      .addressModeW = vk::SamplerAddressMode::eRepeat,
+      .mipLodBias = 0.0f,
+      .anisotropyEnable = VK_TRUE,
+      .maxAnisotropy =
+          static_cast<vk::PhysicalDevice>(device.getPhysicalDevice())
+              .getProperties()
+              .limits.maxSamplerAnisotropy,
+      .compareEnable = VK_FALSE,
+      .compareOp = vk::CompareOp::eAlways,
+      .minLod = 0.0f,
+      .maxLod = 0.0f,
+      .borderColor = vk::BorderColor::eIntOpaqueBlack,
+      .unnormalizedCoordinates = VK_FALSE};
+
+  if (m_mipLevels > 1) {
+    samplerCreateInfo.mipmapMode = vk::SamplerMipmapMode::eLinear;
+    samplerCreateInfo.maxLod = gsl::narrow<float>(m_mipLevels);
+    // samplerCreateInfo.minLod = gsl::narrow<float>(m_mipLevels >> 1);
+  }
+  m_sampler = m_device.createSampler(samplerCreateInfo);
+
+  // Create descriptor info
+  m_descriptorImageInfo = {.sampler = m_sampler,
+                           .imageView = m_imageView,
+                           .imageLayout =
+                               vk::ImageLayout::eShaderReadOnlyOptimal};
+}
+
+std::pair<vk::Image, abcg::VulkanAllocation>
 abcg::VulkanImage::createImage(VulkanDevice const &device,
                                vk::ImageCreateInfo const &imageInfo,
                                vk::MemoryPropertyFlags properties) const {
@@ -251,87 +409,16 @@ abcg::VulkanImage::createImage(VulkanDevice const &device,
   // Get memory requirements
   auto const memoryRequirements{m_device.getImageMemoryRequirements(image)};
 
-  // Allocate image memory
-  auto const memoryType{device.getPhysicalDevice().findMemoryType(
-      memoryRequirements.memoryTypeBits, properties)};
-  if (!memoryType.has_value()) {
-    throw abcg::RuntimeError("Failed to find suitable memory type");
-  }
-  auto imageMemory{
-      m_device.allocateMemory({.allocationSize = memoryRequirements.size,
-                               .memoryTypeIndex = memoryType.value()})};
+  // Sub-allocate image memory. Linear and optimal-tiling images are kept in
+  // separate blocks to honor bufferImageGranularity.
+  auto const allocation{device.getAllocator().allocate(
+      memoryRequirements, properties,
+      imageInfo.tiling == vk::ImageTiling::eLinear)};
 
   // Associate image memory to image
-  m_device.bindImageMemory(image, imageMemory, 0);
+  m_device.bindImageMemory(image, allocation.memory, allocation.offset);
 
-  return {image, imageMemory};
-}
-
-void abcg::VulkanImage::transitionImageLayout(
-    VulkanDevice const &device, vk::ImageLayout oldImageLayout,
-    vk::ImageLayout newImageLayout,
-    vk::ImageSubresourceRange subresourceRange) const {
-
-  // Gets the corresponding access mask for a given image layout
-  auto accessMask{[](vk::ImageLayout layout) {
-    switch (layout) {
-    case vk::ImageLayout::eColorAttachmentOptimal:
-      return vk::AccessFlagBits::eColorAttachmentWrite;
-    case vk::ImageLayout::eDepthStencilAttachmentOptimal:
-      return vk::AccessFlagBits::eDepthStencilAttachmentWrite;
-    case vk::ImageLayout::eShaderReadOnlyOptimal:
-      return vk::AccessFlagBits::eShaderRead;
-    case vk::ImageLayout::eTransferSrcOptimal:
-      return vk::AccessFlagBits::eTransferRead;
-    case vk::ImageLayout::eTransferDstOptimal:
-      return vk::AccessFlagBits::eTransferWrite;
-    case vk::ImageLayout::ePreinitialized:
-      return vk::AccessFlagBits::eHostWrite;
-    default:
-      return vk::AccessFlagBits::eNone;
-    }
-  }};
-
-  // Gets the corresponding pipeline stage for a given image layout
-  auto stageMask{[](vk::ImageLayout layout) {
-    switch (layout) {
-    case vk::ImageLayout::eTransferDstOptimal:
-    case vk::ImageLayout::eTransferSrcOptimal:
-      return vk::PipelineStageFlagBits::eTransfer;
-    case vk::ImageLayout::eColorAttachmentOptimal:
-      return vk::PipelineStageFlagBits::eColorAttachmentOutput;
-    case vk::ImageLayout::eDepthStencilAttachmentOptimal:
-      return vk::PipelineStageFlagBits::eEarlyFragmentTests;
-    case vk::ImageLayout::eShaderReadOnlyOptimal:
-      return vk::PipelineStageFlagBits::eFragmentShader;
-    case vk::ImageLayout::ePreinitialized:
-      return vk::PipelineStageFlagBits::eHost;
-    case vk::ImageLayout::eUndefined:
-      return vk::PipelineStageFlagBits::eTopOfPipe;
-    default:
-      return vk::PipelineStageFlagBits::eBottomOfPipe;
-    }
-  }};
-
-  // Create image barrier
-  vk::ImageMemoryBarrier imageMemoryBarrier{
-      .srcAccessMask = accessMask(oldImageLayout),
-      .dstAccessMask = accessMask(newImageLayout),
-      .oldLayout = oldImageLayout,
-      .newLayout = newImageLayout,
-      .image = m_image,
-      .subresourceRange = subresourceRange};
-  auto srcStageMask{stageMask(oldImageLayout)};
-  auto destStageMask{stageMask(newImageLayout)};
-
-  // Execute the layout transition
-  device.withCommandBuffer(
-      [&](const auto &commandBuffer) {
-        commandBuffer.pipelineBarrier(srcStageMask, destStageMask,
-                                      vk::DependencyFlags(), nullptr, nullptr,
-                                      imageMemoryBarrier);
-      },
-      vk::QueueFlagBits::eTransfer);
+  return {image, allocation};
 }
 
 void abcg::VulkanImage::createMipmaps(VulkanDevice const &device,
@@ -13,6 +13,7 @@
 #ifndef ABCG_VULKAN_IMAGE_HPP_
 #define ABCG_VULKAN_IMAGE_HPP_
 
+#include "abcgVulkanAllocator.hpp"
 #include "abcgVulkanDevice.hpp"
 
 #include <gsl/pointers>
@@ -35,7 +36,7 @@ struct abcg::VulkanImageCreateInfo {
  * @brief A class for representing a Vulkan image.
  *
  * This class provides helper functions for creating and managing vk::Image
- * objects.
+ * objects. Memory is sub-allocated from abcg::VulkanDevice::getAllocator.
  */
 class abcg::VulkanImage {
 public:
@@ -48,29 +49,28 @@ public:
   explicit operator vk::Image const &() const noexcept;
 
   [[nodiscard]] vk::DeviceMemory const &getDeviceMemory() const noexcept;
+  [[nodiscard]] VulkanAllocation const &getAllocation() const noexcept;
   [[nodiscard]] vk::ImageView const &getView() const noexcept;
   [[nodiscard]] vk::DescriptorImageInfo const &
   getDescriptorImageInfo() const noexcept;
   [[nodiscard]] uint32_t getMipLevels() const noexcept;
 
 private:
-  [[nodiscard]] std::pair<vk::Image, vk::DeviceMemory>
+  void createFromKTX2(VulkanDevice const &device, std::string_view path,
+                      bool generateMipmaps);
+  void createSampler(VulkanDevice const &device);
+
+  [[nodiscard]] std::pair<vk::Image, VulkanAllocation>
   createImage(VulkanDevice const &device, vk::ImageCreateInfo const &imageInfo,
               vk::MemoryPropertyFlags properties) const;
-  void transitionImageLayout(VulkanDevice const &device,
-                             vk::ImageLayout oldImageLayout,
-                             vk::ImageLayout newImageLayout,
-                             vk::ImageSubresourceRange subresourceRange = {
-                                 .aspectMask = vk::ImageAspectFlagBits::eColor,
-                                 .levelCount = 1,
-                                 .layerCount = 1}) const;
 
   static void createMipmaps(VulkanDevice const &device, vk::Image image,
                             vk::Format imageFormat, uint32_t texWidth,
                             uint32_t texHeight, uint32_t mipLevels);
 
   vk::Image m_image;
-  vk::DeviceMemory m_deviceMemory;
+  VulkanAllocation m_allocation;
+  VulkanAllocator *m_allocator{};
   vk::ImageView m_imageView;
   vk::Sampler m_sampler;
   vk::DescriptorImageInfo m_descriptorImageInfo;
@@ -38,6 +38,10 @@ struct abcg::VulkanPipelineCreateInfo {
   std::optional<vk::PipelineColorBlendStateCreateInfo> colorBlendState{};
   std::vector<vk::DynamicState> dynamicStates{};
   vk::PipelineLayoutCreateInfo pipelineLayout{};
+  /** @brief Pipeline cache. If not set, the cache of the device is used.
+   *
+   * @sa abcg::VulkanDevice::getPipelineCache.
+   */
   vk::PipelineCache pipelineCache{};
 };
 
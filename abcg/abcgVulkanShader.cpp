@@ -13,11 +13,20 @@
 
 #include <glslang/SPIRV/GlslangToSpv.h>
 
+#include <cppitertools/itertools.hpp>
 #include <fmt/core.h>
 #include <gsl/gsl>
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <exception>
 #include <filesystem>
 #include <fstream>
+#include <thread>
+
+#include "abcgUtil.hpp"
 
 namespace {
 TBuiltInResource InitResources() {
@@ -242,15 +251,107 @@ abcgStageToVulkanStage(abcg::ShaderStage stage) {
       !std::filesystem::exists(filenameOrText)) {
     return filenameOrText.data();
   }
-  std::stringstream source;
-  if (std::ifstream stream(filenameOrText.data()); stream) {
-    source << stream.rdbuf();
-    stream.close();
-  } else {
+  std::ifstream stream(filenameOrText.data(), std::ios::binary);
+  if (!stream) {
     throw abcg::RuntimeError(
         fmt::format("Failed to read file {}", filenameOrText));
   }
-  return source.str();
+  std::string source(std::filesystem::file_size(filenameOrText), '\0');
+  stream.read(source.data(), gsl::narrow<std::streamsize>(source.size()));
+  source.resize(gsl::narrow<std::size_t>(stream.gcount()));
+  return source;
+}
+
+// Initializes glslang on first use. glslang is finalized at process exit.
+void initializeGlslang() {
+  static struct GlslangProcess {
+    GlslangProcess() { glslang::InitializeProcess(); }
+    ~GlslangProcess() { glslang::FinalizeProcess(); }
+    GlslangProcess(GlslangProcess const &) = delete;
+    GlslangProcess(GlslangProcess &&) = delete;
+    GlslangProcess &operator=(GlslangProcess const &) = delete;
+    GlslangProcess &operator=(GlslangProcess &&) = delete;
+  } const process;
+}
+
+// NOLINTNEXTLINE(cppcoreguidelines-avoid-non-const-global-variables)
+std::filesystem::path shaderCachePath;
+
+// Header of a cached SPIR-V module
+struct SPIRVCacheHeader {
+  std::array<char, 4> magic{'A', 'B', 'S', 'V'};
+  std::uint32_t codeSize{}; // Number of 32-bit words
+  std::uint64_t key{};
+};
+
+// First word of every SPIR-V module
+constexpr std::uint32_t spirvMagicNumber{0x07230203};
+
+// The SPIR-V generated from the same source may change between glslang
+// versions, so the version is part of the key
+[[nodiscard]] std::size_t spirvCacheKey(abcg::ShaderSource const &source) {
+  auto const version{glslang::GetVersion()};
+  return abcg::hashCombine(source.source, source.stage, version.major,
+                           version.minor, version.patch,
+                           glslang::GetSpirvGeneratorVersion());
+}
+
+[[nodiscard]] std::filesystem::path spirvCacheFile(std::size_t key) {
+  return shaderCachePath / fmt::format("{:016x}.spv", key);
+}
+
+// Returns the cached SPIR-V code, or an empty vector if not found or invalid
+[[nodiscard]] std::vector<uint32_t> loadSPIRV(std::size_t key) {
+  auto const filename{spirvCacheFile(key)};
+  std::ifstream stream(filename, std::ios::binary);
+  if (!stream)
+    return {};
+
+  SPIRVCacheHeader header{};
+  stream.read(reinterpret_cast<char *>(&header), sizeof(header));
+  std::error_code errorCode;
+  auto const size{std::filesystem::file_size(filename, errorCode)};
+  if (!stream || errorCode || header.magic != SPIRVCacheHeader{}.magic ||
+      header.key != key || header.codeSize == 0 ||
+      size != sizeof(header) + header.codeSize * sizeof(uint32_t)) {
+    return {};
+  }
+
+  std::vector<uint32_t> code(header.codeSize);
+  stream.read(reinterpret_cast<char *>(code.data()),
+              gsl::narrow<std::streamsize>(code.size() * sizeof(uint32_t)));
+  if (!stream || code.front() != spirvMagicNumber)
+    return {};
+  return code;
+}
+
+void saveSPIRV(std::size_t key, std::vector<uint32_t> const &code) {
+  // Write to a temporary file first and replace the cache entry only if the
+  // whole file was written, so that a failed write or a concurrent reader
+  // never sees a truncated module. The name of the temporary file is unique
+  // to the thread, as shaders are compiled in parallel. Failing to write the
+  // cache is not an error.
+  std::error_code errorCode;
+  std::filesystem::create_directories(shaderCachePath, errorCode);
+  auto const cacheFile{spirvCacheFile(key)};
+  auto tempFile{cacheFile};
+  tempFile += fmt::format(
+      ".{:x}.tmp", std::hash<std::thread::id>{}(std::this_thread::get_id()));
+
+  std::ofstream stream(tempFile, std::ios::binary);
+  SPIRVCacheHeader const header{
+      .codeSize = gsl::narrow<std::uint32_t>(code.size()),
+      .key = gsl::narrow<std::uint64_t>(key)};
+  stream.write(reinterpret_cast<char const *>(&header), sizeof(header));
+  stream.write(reinterpret_cast<char const *>(code.data()),
+               gsl::narrow<std::streamsize>(code.size() * sizeof(uint32_t)));
+  stream.close();
+  if (stream) {
+    std::filesystem::rename(tempFile, cacheFile, errorCode);
+  }
+  if (!stream || errorCode) {
+    std::filesystem::remove(tempFile, errorCode);
+  }
 }
 } // namespace
 
@@ -301,9 +402,37 @@ std::vector<uint32_t> GLSLtoSPV(abcg::ShaderSource shaderSource) {
   return outCode;
 }
 
+namespace {
+// Reads the shader source and returns its SPIR-V code, either from the cache
+// or compiled with glslang. Safe to be called concurrently.
+[[nodiscard]] std::vector<uint32_t>
+compileToSPIRV(abcg::ShaderSource const &pathOrSource) {
+  abcg::ShaderSource const source{.source = toSource(pathOrSource.source),
+                                  .stage = pathOrSource.stage};
+
+  auto const useCache{!shaderCachePath.empty()};
+  auto const cacheKey{useCache ? spirvCacheKey(source) : 0};
+  if (useCache) {
+    if (auto code{loadSPIRV(cacheKey)}; !code.empty()) {
+      return code;
+    }
+  }
+
+  initializeGlslang();
+  auto code{GLSLtoSPV(source)};
+
+  if (useCache) {
+    saveSPIRV(cacheKey, code);
+  }
+  return code;
+}
+} // namespace
+
 /**
  * @brief Compiles a GLSL shader to SPIR-V and creates its module.
  *
+ * The SPIR-V code is read from the shader cache, if enabled and available.
+ *
  * @param device Vulkan device to be used to create the shader module.
  * @param pathOrSource Path or source code of the GLSL shader to be compiled to
  * SPIR-V.
@@ -313,18 +442,22 @@ std::vector<uint32_t> GLSLtoSPV(abcg::ShaderSource shaderSource) {
  */
 void abcg::VulkanShader::create(VulkanDevice const &device,
                                 ShaderSource const &pathOrSource) {
-  m_device = static_cast<vk::Device>(device);
-
-  ShaderSource const source{.source = toSource(pathOrSource.source),
-                            .stage = pathOrSource.stage};
-
-  glslang::InitializeProcess();
-  std::vector<uint32_t> shader{GLSLtoSPV(source)};
-  m_stage = abcgStageToVulkanStage(source.stage);
-  glslang::FinalizeProcess();
+  create(device, pathOrSource.stage, compileToSPIRV(pathOrSource));
+}
 
+/**
+ * @brief Creates the shader module from SPIR-V code.
+ *
+ * @param device Vulkan device to be used to create the shader module.
+ * @param stage Shader stage.
+ * @param code SPIR-V code.
+ */
+void abcg::VulkanShader::create(VulkanDevice const &device, ShaderStage stage,
+                                std::vector<uint32_t> const &code) {
+  m_device = static_cast<vk::Device>(device);
+  m_stage = abcgStageToVulkanStage(stage);
   m_module = m_device.createShaderModule(
-      {.codeSize = shader.size() * sizeof(uint32_t), .pCode = shader.data()});
+      {.codeSize = code.size() * sizeof(uint32_t), .pCode = code.data()});
 }
 
 /**
@@ -354,4 +487,86 @@ vk::ShaderStageFlagBits const &abcg::VulkanShader::getStage() const noexcept {
  */
 vk::ShaderModule const &abcg::VulkanShader::getModule() const noexcept {
   return m_module;
-}
\ No newline at end of file
+}
+
+/**
+ * @brief Compiles a group of GLSL shaders to SPIR-V in parallel and creates
+ * their modules.
+ *
+ * The shaders are distributed among up to `std::thread::hardware_concurrency`
+ * threads. The shader modules are created by the calling thread.
+ *
+ * @param device Vulkan device to be used to create the shader modules.
+ * @param pathsOrSources Paths or source codes of the GLSL shaders.
+ *
+ * @throw abcg::RuntimeError if any shader could not be read from file or has
+ * failed to compile. In this case, no shader module is created.
+ *
+ * @return Shaders in the same order as `pathsOrSources`.
+ */
+std::vector<abcg::VulkanShader>
+abcg::createVulkanShaders(VulkanDevice const &device,
+                          std::vector<ShaderSource> const &pathsOrSources) {
+  auto const count{pathsOrSources.size()};
+  if (count == 0)
+    return {};
+
+  std::vector<std::vector<uint32_t>> codes(count);
+  std::vector<std::exception_ptr> errors(count);
+
+  // Initialize glslang before spawning threads
+  initializeGlslang();
+
+  std::atomic<std::size_t> next{};
+  auto const worker{[&] {
+    for (auto index{next++}; index < count; index = next++) {
+      try {
+        codes.at(index) = compileToSPIRV(pathsOrSources.at(index));
+      } catch (...) {
+        errors.at(index) = std::current_exception();
+      }
+    }
+  }};
+
+  {
+    auto const numThreads{
+        std::clamp<std::size_t>(std::thread::hardware_concurrency(), 1, count)};
+    std::vector<std::jthread> threads;
+    threads.reserve(numThreads - 1);
+    for ([[maybe_unused]] auto const index : iter::range(numThreads - 1)) {
+      threads.emplace_back(worker);
+    }
+    worker();
+  }
+
+  for (auto const &error : errors) {
+    if (error) {
+      std::rethrow_exception(error);
+    }
+  }
+
+  std::vector<VulkanShader> shaders(count);
+  for (auto const index : iter::range(count)) {
+    shaders.at(index).create(device, pathsOrSources.at(index).stage,
+                             codes.at(index));
+  }
+  return shaders;
+}
+
+/**
+ * @brief Sets the directory of the SPIR-V cache used by
+ * abcg::VulkanShader::create and abcg::createVulkanShaders.
+ *
+ * When set, the SPIR-V code of each shader is looked up before compiling it
+ * with glslang. Entries are keyed by a hash of the shader source, the shader
+ * stage and the glslang version. Newly compiled shaders are stored for the
+ * next run. The directory is created if it does not exist.
+ *
+ * @param path Path of the cache directory. An empty path disables the cache,
+ * which is the default.
+ *
+ * @remark Must not be called while shaders are being compiled.
+ */
+void abcg::setVulkanShaderCachePath(std::string_view path) {
+  shaderCachePath = path;
+}
@@ -11,6 +11,10 @@
 #ifndef ABCG_VULKAN_SHADER_HPP_
 #define ABCG_VULKAN_SHADER_HPP_
 
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
 #include "abcgShader.hpp"
 #include "abcgVulkanDevice.hpp"
 
@@ -23,10 +27,15 @@ class VulkanShader;
  *
  * This class compiles a GLSL shader into a Vulkan SPIR-V shader and creates the
  * corresponding vk::ShaderModule.
+ *
+ * @sa abcg::createVulkanShaders to compile many shaders in parallel.
+ * @sa abcg::setVulkanShaderCachePath to enable the SPIR-V cache.
  */
 class abcg::VulkanShader {
 public:
   void create(VulkanDevice const &device, ShaderSource const &pathOrSource);
+  void create(VulkanDevice const &device, ShaderStage stage,
+              std::vector<uint32_t> const &code);
   void destroy();
 
   [[nodiscard]] vk::ShaderStageFlagBits const &getStage() const noexcept;
@@ -38,4 +47,11 @@ private:
   vk::Device m_device;
 };
 
+namespace abcg {
+[[nodiscard]] std::vector<VulkanShader>
+createVulkanShaders(VulkanDevice const &device,
+                    std::vector<ShaderSource> const &pathsOrSources);
+void setVulkanShaderCachePath(std::string_view path);
+} // namespace abcg
+
 #endif
@@ -11,12 +11,15 @@
 #include "abcgVulkanSwapchain.hpp"
 
 #include <functional>
+#include <thread>
 #include <gsl/gsl>
 #include <imgui_impl_vulkan.h>
 
 #include "abcgException.hpp"
+#include "abcgTrace.hpp"
 #include "abcgVulkanDevice.hpp"
 #include "abcgVulkanPhysicalDevice.hpp"
+#include "abcgVulkanUploadContext.hpp"
 #include "abcgVulkanWindow.hpp"
 
 namespace {
@@ -130,16 +133,24 @@ void abcg::VulkanSwapchain::render(
     std::function<void(VulkanFrame const &)> const &fun) {
   auto const &device{static_cast<vk::Device>(m_device)};
 
-  // Get current set of semaphores
-  auto [presentCompleteSemaphore,
-        renderCompleteSemaphore]{m_frameSemaphores.at(m_currentSemaphore)};
+  auto const &slot{m_slots.at(m_currentSlot)};
+
+  // Wait until the GPU has finished the last frame recorded with this slot.
+  // This blocks in the driver only when the CPU is framesInFlight frames
+  // ahead of the GPU.
+  {
+    ABCG_TRACE_ZONE("waitForFences", "swapchain");
+    (void)device.waitForFences(slot.fence, VK_TRUE,
+                               std::numeric_limits<uint64_t>::max());
+  }
 
   // Acquire an image from the swapchain
   vk::Result result{};
   try {
+    ABCG_TRACE_ZONE("acquireNextImage", "swapchain");
     result = device.acquireNextImageKHR(
         m_swapchainKHR, std::numeric_limits<uint64_t>::max(),
-        presentCompleteSemaphore, vk::Fence{}, &m_currentFrame);
+        slot.presentComplete, vk::Fence{}, &m_currentFrame);
   } catch (vk::OutOfDateKHRError const &) {
     result = vk::Result::eErrorOutOfDateKHR;
   }
@@ -149,15 +160,28 @@ void abcg::VulkanSwapchain::render(
     return;
   }
 
-  auto const &frame{m_frames.at(m_currentFrame)};
+  // The image may still be in use by a frame of another slot
+  if (auto &imageFence{m_imageFences.at(m_currentFrame)};
+      imageFence != slot.fence) {
+    if (imageFence) {
+      ABCG_TRACE_ZONE("waitForImage", "swapchain");
+      (void)device.waitForFences(imageFence, VK_TRUE,
+                                 std::numeric_limits<uint64_t>::max());
+    }
+    imageFence = slot.fence;
+  }
 
-  // Wait until command buffer for acquired image has finished executing
-  while (vk::Result::eTimeout ==
-         device.waitForFences(frame.fence, VK_TRUE,
-                              std::numeric_limits<uint64_t>::max()))
-    ;
-  device.resetFences(frame.fence);
-  device.resetCommandPool(frame.commandPool);
+  device.resetFences(slot.fence);
+  device.resetCommandPool(slot.commandPool);
+  m_recorder.reset(m_currentSlot);
+
+  auto &frame{m_frames.at(m_currentFrame)};
+  frame.slot = m_currentSlot;
+  frame.commandPool = slot.commandPool;
+  frame.commandBuffer = slot.commandBuffer;
+  frame.commandBufferUI = slot.commandBufferUI;
+  frame.fence = slot.fence;
+  frame.threadCommandPools = &m_recorder.getCommandPools(m_currentSlot);
 
   // Main pass
   fun(frame);
@@ -183,11 +207,14 @@ void abcg::VulkanSwapchain::render(
 
   frame.commandBufferUI.end();
 
-  std::array waitSemaphores{presentCompleteSemaphore};
+  std::array waitSemaphores{slot.presentComplete};
   std::array waitStages{vk::PipelineStageFlags{
       vk::PipelineStageFlagBits::eColorAttachmentOutput}};
   std::array commandBuffers{frame.commandBuffer, frame.commandBufferUI};
-  std::array signalSemaphores{renderCompleteSemaphore};
+  std::array signalSemaphores{m_renderCompleteSemaphores.at(m_currentFrame)};
+
+  // Resources uploaded in this frame or before must be ready
+  m_device.getUploadContext().flush();
 
   // Submit command buffer
   m_device.getQueues().graphics.submit(
@@ -206,14 +233,14 @@ void abcg::VulkanSwapchain::present() {
     return;
 
   // Set semaphores to wait
-  auto &frameSemaphore{m_frameSemaphores.at(m_currentSemaphore)};
-  std::array waitSemaphores{frameSemaphore.renderComplete};
+  std::array waitSemaphores{m_renderCompleteSemaphores.at(m_currentFrame)};
 
   // Set swapchains
   std::array swapchains{m_swapchainKHR};
 
   vk::Result result{};
   try {
+    ABCG_TRACE_ZONE("present", "swapchain");
     result = m_device.getQueues().present.presentKHR({
         .waitSemaphoreCount = gsl::narrow<uint32_t>(waitSemaphores.size()),
         .pWaitSemaphores = waitSemaphores.data(),
@@ -230,9 +257,8 @@ void abcg::VulkanSwapchain::present() {
     return;
   }
 
-  // Use the next set of semaphores
-  m_currentSemaphore =
-      (m_currentSemaphore + 1) % gsl::narrow<uint32_t>(m_frames.size());
+  // Use the next frame-in-flight slot
+  m_currentSlot = (m_currentSlot + 1) % m_framesInFlight;
 }
 
 bool abcg::VulkanSwapchain::checkRebuild(VulkanSettings const &settings,
@@ -352,10 +378,20 @@ bool abcg::VulkanSwapchain::checkRebuild(VulkanSettings const &settings,
 
   device.destroySwapchainKHR(oldSwapchain);
 
+  m_framesInFlight =
+      gsl::narrow<uint32_t>(std::max(settings.framesInFlight, 1));
+
   createRenderPasses(settings);
 
   createFrames();
 
+  // Use one thread per core, up to 8, by default
+  auto const recordingThreads{
+      settings.recordingThreads > 0
+          ? gsl::narrow<uint32_t>(settings.recordingThreads)
+          : std::clamp(std::thread::hardware_concurrency(), 1U, 8U)};
+  m_recorder.create(m_device, recordingThreads, m_framesInFlight);
+
   if (settings.depthBufferSize > 0 || settings.stencilBufferSize > 0) {
     createDepthResources(settings);
   }
@@ -408,6 +444,17 @@ abcg::VulkanSwapchain::getCurrentFrame() const noexcept {
   return m_frames[m_currentFrame];
 }
 
+/**
+ * @brief Returns the number of frame-in-flight slots.
+ *
+ * @return Number of frames that can be recorded or executed at the same time.
+ *
+ * @sa abcg::VulkanFrame::slot.
+ */
+uint32_t abcg::VulkanSwapchain::getFramesInFlight() const noexcept {
+  return m_framesInFlight;
+}
+
 /**
  * @brief Returns the main render pass.
  *
@@ -445,6 +492,35 @@ abcg::VulkanImage const &abcg::VulkanSwapchain::getDepthImage() const noexcept {
   return m_depthImage;
 }
 
+/**
+ * @brief Records commands in parallel into secondary command buffers that
+ * inherit the main render pass, and executes them into
+ * abcg::VulkanFrame::commandBuffer.
+ *
+ * The range `[0, count)` (e.g., of objects to draw) is split among the
+ * recording threads, and `job` is called from each thread with its own
+ * secondary command buffer and subrange. The secondary command buffers are
+ * executed in the order of the subranges.
+ *
+ * The main render pass must have been begun in
+ * abcg::VulkanFrame::commandBuffer with
+ * `vk::SubpassContents::eSecondaryCommandBuffers`. State such as the bound
+ * pipeline, viewport and scissor is not inherited, and must be set in `job`.
+ *
+ * @param count Number of items.
+ * @param job Function that records items `first` to `last - 1`.
+ *
+ * @sa abcg::VulkanSettings::recordingThreads.
+ */
+void abcg::VulkanFrame::recordParallel(
+    std::size_t count, VulkanCommandRecorder::Job const &job) const {
+  recorder->record(slot, commandBuffer,
+                   {.renderPass = renderPassMain,
+                    .subpass = 0,
+                    .framebuffer = framebufferMain},
+                   count, job);
+}
+
 void abcg::VulkanSwapchain::createFrames() {
   auto const swapchainImages{
       static_cast<vk::Device>(m_device).getSwapchainImagesKHR(m_swapchainKHR)};
@@ -452,8 +528,10 @@ void abcg::VulkanSwapchain::createFrames() {
   // Create image views
   m_currentFrame = 0;
   m_frames.resize(swapchainImages.size());
-  m_currentSemaphore = 0;
-  m_frameSemaphores.resize(swapchainImages.size());
+  m_renderCompleteSemaphores.resize(swapchainImages.size());
+  m_imageFences.assign(swapchainImages.size(), vk::Fence{});
+  m_currentSlot = 0;
+  m_slots.resize(m_framesInFlight);
 
   for (auto &&[frame, image, index] :
        iter::zip(m_frames, swapchainImages, iter::range(m_frames.size()))) {
@@ -473,20 +551,27 @@ void abcg::VulkanSwapchain::createFrames() {
 void abcg::VulkanSwapchain::destroyFrames() {
   auto const &device{static_cast<vk::Device>(m_device)};
 
+  m_recorder.destroy();
+
+  for (auto &slot : m_slots) {
+    device.destroyCommandPool(slot.commandPool);
+    device.destroyFence(slot.fence);
+    device.destroySemaphore(slot.presentComplete);
+  }
+
   for (auto &frame : m_frames) {
-    device.destroyCommandPool(frame.commandPool);
-    device.destroyFence(frame.fence);
     frame.colorImage.destroy();
     device.destroyFramebuffer(frame.framebufferMain);
   }
 
-  for (auto &frameSemaphore : m_frameSemaphores) {
-    device.destroySemaphore(frameSemaphore.presentComplete);
-    device.destroySemaphore(frameSemaphore.renderComplete);
+  for (auto &semaphore : m_renderCompleteSemaphores) {
+    device.destroySemaphore(semaphore);
   }
 
+  m_slots.clear();
   m_frames.clear();
-  m_frameSemaphores.clear();
+  m_renderCompleteSemaphores.clear();
+  m_imageFences.clear();
 }
 
 // TODO:
@@ -793,31 +878,50 @@ void abcg::VulkanSwapchain::createFramebuffers(VulkanSettings const &settings) {
   }
   auto const graphicsQueueFamily{queuesFamilies.graphics.value()};
 
-  for (auto &frame : m_frames) {
-    // Each frame has its own transient graphics command pool
-    frame.commandPool = device.createCommandPool(
+  for (auto &slot : m_slots) {
+    // Each slot has its own transient graphics command pool
+    slot.commandPool = device.createCommandPool(
         {.flags = vk::CommandPoolCreateFlagBits::eTransient,
          .queueFamilyIndex = graphicsQueueFamily});
 
     // Create a primary command buffer
-    frame.commandBuffer =
+    slot.commandBuffer =
         device
-            .allocateCommandBuffers({.commandPool = frame.commandPool,
+            .allocateCommandBuffers({.commandPool = slot.commandPool,
                                      .level = vk::CommandBufferLevel::ePrimary,
                                      .commandBufferCount = 1})
             .front();
 
     // Create a primary command buffer for the UI
-    frame.commandBufferUI =
+    slot.commandBufferUI =
         device
-            .allocateCommandBuffers({.commandPool = frame.commandPool,
+            .allocateCommandBuffers({.commandPool = slot.commandPool,
                                      .level = vk::CommandBufferLevel::ePrimary,
                                      .commandBufferCount = 1})
             .front();
 
-    // Create fence
-    frame.fence =
+    // Create fence and acquire semaphore
+    slot.fence =
         device.createFence({.flags = vk::FenceCreateFlagBits::eSignaled});
+    slot.presentComplete = device.createSemaphore({});
+  }
+
+  for (auto &&[frame, renderComplete] :
+       iter::zip(m_frames, m_renderCompleteSemaphores)) {
+    // Slot resources are reassigned each time the image is acquired. These
+    // make abcg::VulkanSwapchain::getCurrentFrame usable before the first
+    // frame.
+    auto const &slot{m_slots.at(frame.index % m_framesInFlight)};
+    frame.slot = frame.index % m_framesInFlight;
+    frame.commandPool = slot.commandPool;
+    frame.commandBuffer = slot.commandBuffer;
+    frame.commandBufferUI = slot.commandBufferUI;
+    frame.fence = slot.fence;
+    frame.renderPassMain = m_renderPassMain;
+    frame.threadCommandPools = &m_recorder.getCommandPools(frame.slot);
+    frame.recorder = &m_recorder;
+
+    renderComplete = device.createSemaphore({});
 
     // Set attachments
     std::vector<vk::ImageView> attachments{};
@@ -848,10 +952,4 @@ void abcg::VulkanSwapchain::createFramebuffers(VulkanSettings const &settings) {
          .height = m_swapchainExtent.height,
          .layers = 1});
   }
-
-  // Create semaphores
-  for (auto &frameSemaphore : m_frameSemaphores) {
-    frameSemaphore.presentComplete = device.createSemaphore({});
-    frameSemaphore.renderComplete = device.createSemaphore({});
-  }
 }
@@ -16,6 +16,7 @@
 #include <functional>
 #include <glm/fwd.hpp>
 
+#include "abcgVulkanCommandRecorder.hpp"
 #include "abcgVulkanDevice.hpp"
 #include "abcgVulkanImage.hpp"
 
@@ -30,15 +31,36 @@ class VulkanWindow;
 /**
  * @brief Data needed by a rendering frame.
  *
+ * The color image and framebuffer belong to the acquired swapchain image. The
+ * command pool, command buffers and fence belong to the frame-in-flight slot
+ * used to record the frame.
+ *
+ * @sa abcg::VulkanSettings::framesInFlight.
  */
 struct abcg::VulkanFrame {
+  /** @brief Index of the swapchain image. */
   uint32_t index{};
+  /** @brief Index of the frame-in-flight slot, from 0 to
+   * abcg::VulkanSwapchain::getFramesInFlight minus 1. Resources written by the
+   * CPU every frame (e.g., uniform buffers) can be indexed by this value. */
+  uint32_t slot{};
   vk::CommandPool commandPool;
   vk::CommandBuffer commandBuffer;
   vk::CommandBuffer commandBufferUI;
   vk::Fence fence;
   VulkanImage colorImage;
   vk::Framebuffer framebufferMain;
+  /** @brief Main render pass, inherited by the secondary command buffers of
+   * abcg::VulkanFrame::recordParallel. */
+  vk::RenderPass renderPassMain;
+  /** @brief Command pools of the slot, one for each recording thread. They are
+   * reset when the slot is reused. */
+  std::vector<vk::CommandPool> const *threadCommandPools{};
+  /** @brief Recorder used by abcg::VulkanFrame::recordParallel. */
+  VulkanCommandRecorder *recorder{};
+
+  void recordParallel(std::size_t count,
+                      VulkanCommandRecorder::Job const &job) const;
 };
 
 /**
@@ -46,6 +68,15 @@ struct abcg::VulkanFrame {
  *
  * This class creates and manages the list of image buffers and other resources
  * that are used for presentation.
+ *
+ * Up to abcg::VulkanSettings::framesInFlight frames are recorded or executed
+ * at the same time, independently of the number of swapchain images. Each
+ * frame-in-flight slot has its own command pool, fence and acquire semaphore.
+ * Before a slot is reused, abcg::VulkanSwapchain::render blocks on its fence,
+ * so the CPU can record frame N+1 while the GPU renders frame N.
+ *
+ * Scene commands can also be recorded in parallel into secondary command
+ * buffers with abcg::VulkanFrame::recordParallel.
  */
 class abcg::VulkanSwapchain {
 public:
@@ -62,6 +93,7 @@ public:
   [[nodiscard]] VulkanDevice const &getDevice() const noexcept;
   [[nodiscard]] std::vector<VulkanFrame> const &getFrames() const noexcept;
   [[nodiscard]] VulkanFrame const &getCurrentFrame() const noexcept;
+  [[nodiscard]] uint32_t getFramesInFlight() const noexcept;
   [[nodiscard]] vk::RenderPass const &getMainRenderPass() const noexcept;
   [[nodiscard]] vk::RenderPass const &getUIRenderPass() const noexcept;
   [[nodiscard]] vk::Extent2D const &getExtent() const noexcept;
@@ -90,18 +122,27 @@ private:
   vk::Extent2D m_swapchainExtent;
   bool m_swapChainRebuild{};
 
-  // Data for swapchain synchronization
-  struct FrameSemaphores {
+  // Per-slot data for frames in flight
+  struct FrameSlot {
+    vk::CommandPool commandPool;
+    vk::CommandBuffer commandBuffer;
+    vk::CommandBuffer commandBufferUI;
+    vk::Fence fence;
     vk::Semaphore presentComplete;
-    vk::Semaphore renderComplete;
   };
 
+  // Per-image data
   uint32_t m_currentFrame{};
   std::vector<VulkanFrame> m_frames;
-  // Current set of swapchain wait semaphores we're using (needs to be distinct
-  // from per frame data)
-  uint32_t m_currentSemaphore{};
-  std::vector<FrameSemaphores> m_frameSemaphores;
+  std::vector<vk::Semaphore> m_renderCompleteSemaphores;
+  // Fence of the slot that last rendered to each image
+  std::vector<vk::Fence> m_imageFences;
+
+  uint32_t m_framesInFlight{2};
+  uint32_t m_currentSlot{};
+  std::vector<FrameSlot> m_slots;
+
+  VulkanCommandRecorder m_recorder;
 
   VulkanImage m_depthImage;
   VulkanImage m_MSAAImage;
@@ -0,0 +1,351 @@
+/**
+ * @file abcgVulkanUploadContext.cpp
+ * @brief Definition of abcg::VulkanUploadContext members.
+ *
+ * This file is part of ABCg (https://github.com/hbatagelo/abcg).
+ *
+ * @copyright (c) 2021--2023 Harlen Batagelo. All rights reserved.
+ * This project is released under the MIT License.
+ */
+
+#include "abcgVulkanUploadContext.hpp"
+#include "abcgVulkanDevice.hpp"
+
+#include <cstring>
+#include <limits>
+#include <numeric>
+
+#include "abcgTrace.hpp"
+
+namespace {
+// Satisfies the offset alignment of buffer copies, and of buffer-to-image
+// copies of formats whose texel block size divides 16. Other formats, such as
+// 3-byte RGB, are aligned to the least common multiple with their block size.
+constexpr vk::DeviceSize stagingAlignment{16};
+
+[[nodiscard]] constexpr vk::DeviceSize alignUp(vk::DeviceSize value,
+                                               vk::DeviceSize alignment) {
+  return (value + alignment - 1) / alignment * alignment;
+}
+} // namespace
+
+/**
+ * @brief Creates the staging ring buffer and the command pool of the transfer
+ * queue.
+ *
+ * If the device has no transfer queue, the graphics queue is used.
+ *
+ * @param device Vulkan device. Its allocator must have been created.
+ */
+void abcg::VulkanUploadContext::create(VulkanDevice const &device) {
+  m_device = static_cast<vk::Device>(device);
+  m_allocator = &device.getAllocator();
+
+  auto const &queuesFamilies{device.getPhysicalDevice().getQueuesFamilies()};
+  auto const &queues{device.getQueues()};
+  auto const useTransferQueue{queuesFamilies.transfer.has_value() &&
+                              queues.transfer};
+  m_queue = useTransferQueue ? queues.transfer : queues.graphics;
+
+  m_commandPool = m_device.createCommandPool(
+      {.flags = vk::CommandPoolCreateFlagBits::eTransient |
+                vk::CommandPoolCreateFlagBits::eResetCommandBuffer,
+       .queueFamilyIndex = useTransferQueue
+                               ? queuesFamilies.transfer.value()
+                               : queuesFamilies.graphics.value_or(0)});
+
+  m_ringBuffer = m_device.createBuffer(
+      {.size = ringSize, .usage = vk::BufferUsageFlagBits::eTransferSrc});
+  m_ringAllocation = m_allocator->allocate(
+      m_device.getBufferMemoryRequirements(m_ringBuffer),
+      vk::MemoryPropertyFlagBits::eHostVisible |
+          vk::MemoryPropertyFlagBits::eHostCoherent);
+  m_device.bindBufferMemory(m_ringBuffer, m_ringAllocation.memory,
+                            m_ringAllocation.offset);
+}
+
+/**
+ * @brief Waits for pending uploads and releases the resources.
+ */
+void abcg::VulkanUploadContext::destroy() {
+  flush();
+
+  std::scoped_lock const lock{m_mutex};
+  for (auto &batch : m_free) {
+    m_device.destroyFence(batch.fence);
+  }
+  m_free.clear();
+  // Command buffers are freed with the pool
+  m_device.destroyCommandPool(m_commandPool);
+
+  m_device.destroyBuffer(m_ringBuffer);
+  m_allocator->free(m_ringAllocation);
+}
+
+/**
+ * @brief Records a copy of host data to a buffer.
+ *
+ * The data is copied to the staging ring before returning. The copy to the
+ * buffer is executed when the current batch is submitted.
+ *
+ * @param buffer Destination buffer. Must have been created with
+ * `vk::BufferUsageFlagBits::eTransferDst`.
+ * @param data Pointer to the beginning of the data.
+ * @param size Size of the data, in bytes.
+ * @param offset Offset in the destination buffer.
+ */
+void abcg::VulkanUploadContext::uploadToBuffer(vk::Buffer buffer,
+                                               gsl::not_null<void const *> data,
+                                               vk::DeviceSize size,
+                                               vk::DeviceSize offset) {
+  std::scoped_lock const lock{m_mutex};
+
+  auto const [srcBuffer, srcOffset]{stage(data, size, stagingAlignment)};
+  getCommandBuffer().copyBuffer(
+      srcBuffer, buffer,
+      {{.srcOffset = srcOffset, .dstOffset = offset, .size = size}});
+}
+
+/**
+ * @brief Records a copy of host data to an image.
+ *
+ * The image is transitioned from an undefined layout to
+ * `vk::ImageLayout::eTransferDstOptimal` before the copy, and to `finalLayout`
+ * after it.
+ *
+ * @param image Destination image. Must have been created with
+ * `vk::ImageUsageFlagBits::eTransferDst`. If the transfer queue is not in the
+ * same family as the queues that use the image, the image must have been
+ * created with `vk::SharingMode::eConcurrent` across those families.
+ * @param data Pointer to the beginning of the texel data.
+ * @param size Size of the texel data, in bytes.
+ * @param region Copy region. Its buffer offset is ignored.
+ * @param subresourceRange Subresources whose layout is transitioned.
+ * @param finalLayout Layout of the subresources after the copy.
+ * @param texelBlockSize Size of a texel block of the image format, in bytes.
+ * The data is staged at an offset that is a multiple of it.
+ */
+void abcg::VulkanUploadContext::uploadToImage(
+    vk::Image image, gsl::not_null<void const *> data, vk::DeviceSize size,
+    vk::BufferImageCopy region,
+    vk::ImageSubresourceRange const &subresourceRange,
+    vk::ImageLayout finalLayout, vk::DeviceSize texelBlockSize) {
+  std::scoped_lock const lock{m_mutex};
+
+  auto const [srcBuffer, srcOffset]{
+      stage(data, size, std::lcm(stagingAlignment, texelBlockSize))};
+  region.bufferOffset = srcOffset;
+
+  auto const &commandBuffer{getCommandBuffer()};
+
+  vk::ImageMemoryBarrier barrier{
+      .srcAccessMask = vk::AccessFlagBits::eNone,
+      .dstAccessMask = vk::AccessFlagBits::eTransferWrite,
+      .oldLayout = vk::ImageLayout::eUndefined,
+      .newLayout = vk::ImageLayout::eTransferDstOptimal,
+      .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+      .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+      .image = image,
+      .subresourceRange = subresourceRange};
+  commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTopOfPipe,
+                                vk::PipelineStageFlagBits::eTransfer,
+                                vk::DependencyFlags{}, {}, {}, {barrier});
+
+  commandBuffer.copyBufferToImage(srcBuffer, image,
+                                  vk::ImageLayout::eTransferDstOptimal, region);
+
+  if (finalLayout != vk::ImageLayout::eTransferDstOptimal) {
+    // No queue family ownership transfer is recorded: images read on other
+    // queue families must be created with concurrent sharing
+    barrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
+    barrier.dstAccessMask = vk::AccessFlagBits::eNone;
+    barrier.oldLayout = vk::ImageLayout::eTransferDstOptimal;
+    barrier.newLayout = finalLayout;
+    commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
+                                  vk::PipelineStageFlagBits::eBottomOfPipe,
+                                  vk::DependencyFlags{}, {}, {}, {barrier});
+  }
+}
+
+/**
+ * @brief Submits the current batch to the transfer queue.
+ *
+ * @return Identifier of the submitted batch, to be used with
+ * abcg::VulkanUploadContext::isComplete and abcg::VulkanUploadContext::wait.
+ * If there was nothing to submit, returns the identifier of the last submitted
+ * batch.
+ */
+uint64_t abcg::VulkanUploadContext::submit() {
+  std::scoped_lock const lock{m_mutex};
+  return submitLocked();
+}
+
+/**
+ * @brief Returns whether a submitted batch has finished executing.
+ *
+ * Does not block.
+ *
+ * @param batch Identifier returned by abcg::VulkanUploadContext::submit.
+ *
+ * @return True if the batch has finished executing, false otherwise.
+ */
+bool abcg::VulkanUploadContext::isComplete(uint64_t batch) {
+  std::scoped_lock const lock{m_mutex};
+  retire(false);
+  return m_completedBatch >= batch;
+}
+
+/**
+ * @brief Blocks until a submitted batch has finished executing.
+ *
+ * @param batch Identifier returned by abcg::VulkanUploadContext::submit.
+ */
+void abcg::VulkanUploadContext::wait(uint64_t batch) {
+  std::scoped_lock const lock{m_mutex};
+  while (m_completedBatch < batch && !m_pending.empty()) {
+    retire(true);
+  }
+}
+
+/**
+ * @brief Submits the current batch and waits until all batches have finished
+ * executing.
+ *
+ * Returns immediately if there is nothing pending.
+ */
+void abcg::VulkanUploadContext::flush() {
+  std::scoped_lock const lock{m_mutex};
+  if (!m_recording && m_pending.empty())
+    return;
+
+  ABCG_TRACE_ZONE("flushUploads", "vulkan");
+  submitLocked();
+  while (!m_pending.empty()) {
+    retire(true);
+  }
+}
+
+// Copies data to the staging ring at an offset that is a multiple of
+// `alignment`, or to a temporary staging buffer if it does not fit in the
+// ring. Returns the staging buffer and the offset of the data.
+std::pair<vk::Buffer, vk::DeviceSize>
+abcg::VulkanUploadContext::stage(void const *data, vk::DeviceSize size,
+                                 vk::DeviceSize alignment) {
+  if (size > ringSize) {
+    auto const buffer{m_device.createBuffer(
+        {.size = size, .usage = vk::BufferUsageFlagBits::eTransferSrc})};
+    auto allocation{m_allocator->allocate(
+        m_device.getBufferMemoryRequirements(buffer),
+        vk::MemoryPropertyFlagBits::eHostVisible |
+            vk::MemoryPropertyFlagBits::eHostCoherent)};
+    m_device.bindBufferMemory(buffer, allocation.memory, allocation.offset);
+    std::memcpy(allocation.mapped, data, size);
+    m_current.temporaries.emplace_back(buffer, allocation);
+    return {buffer, 0};
+  }
+
+  while (true) {
+    retire(false);
+    if (m_ringUsed == 0) {
+      m_ringHead = 0;
+    }
+
+    // Wrap around if the data does not fit before the end of the ring. The
+    // skipped bytes are accounted to the batch and reclaimed with it.
+    auto offset{alignUp(m_ringHead, alignment)};
+    if (offset + size > ringSize) {
+      offset = 0;
+    }
+    auto const consumed{
+        (offset >= m_ringHead ? offset - m_ringHead : ringSize - m_ringHead) +
+        size};
+
+    if (m_ringUsed + consumed <= ringSize) {
+      std::memcpy(static_cast<std::byte *>(m_ringAllocation.mapped) + offset,
+                  data, size);
+      m_ringHead = offset + size;
+      m_ringUsed += consumed;
+      m_current.ringBytes += consumed;
+      return {m_ringBuffer, offset};
+    }
+
+    // The ring is full: submit what was recorded so far and wait for the
+    // oldest batch to release its space
+    ABCG_TRACE_ZONE("stagingRingFull", "vulkan");
+    submitLocked();
+    retire(true);
+  }
+}
+
+// Returns the command buffer of the current batch, beginning a new batch if
+// needed
+vk::CommandBuffer const &abcg::VulkanUploadContext::getCommandBuffer() {
+  if (!m_recording) {
+    if (m_free.empty()) {
+      m_current.commandBuffer =
+          m_device
+              .allocateCommandBuffers(
+                  {.commandPool = m_commandPool,
+                   .level = vk::CommandBufferLevel::ePrimary,
+                   .commandBufferCount = 1})
+              .front();
+      m_current.fence = m_device.createFence({});
+    } else {
+      m_current.commandBuffer = m_free.back().commandBuffer;
+      m_current.fence = m_free.back().fence;
+      m_free.pop_back();
+    }
+    m_current.commandBuffer.begin(
+        {.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit});
+    m_recording = true;
+  }
+  return m_current.commandBuffer;
+}
+
+uint64_t abcg::VulkanUploadContext::submitLocked() {
+  if (!m_recording)
+    return m_nextBatch - 1;
+
+  m_current.commandBuffer.end();
+  m_queue.submit({{.commandBufferCount = 1,
+                   .pCommandBuffers = &m_current.commandBuffer}},
+                 m_current.fence);
+
+  auto const id{m_nextBatch++};
+  m_current.id = id;
+  m_pending.push_back(std::move(m_current));
+  m_current = {};
+  m_recording = false;
+  return id;
+}
+
+// Releases the batches that have finished executing, in submission order. If
+// `wait` is true, first blocks until the oldest batch has finished.
+void abcg::VulkanUploadContext::retire(bool wait) {
+  while (!m_pending.empty()) {
+    auto &batch{m_pending.front()};
+    if (wait) {
+      ABCG_TRACE_ZONE("waitUploads", "vulkan");
+      (void)m_device.waitForFences(batch.fence, VK_TRUE,
+                                   std::numeric_limits<uint64_t>::max());
+      wait = false;
+    } else if (m_device.getFenceStatus(batch.fence) != vk::Result::eSuccess) {
+      break;
+    }
+
+    m_ringUsed -= batch.ringBytes;
+    m_completedBatch = batch.id;
+    recycle(batch);
+    m_pending.pop_front();
+  }
+}
+
+void abcg::VulkanUploadContext::recycle(Batch &batch) {
+  for (auto &[buffer, allocation] : batch.temporaries) {
+    m_device.destroyBuffer(buffer);
+    m_allocator->free(allocation);
+  }
+  m_device.resetFences(batch.fence);
+  batch.commandBuffer.reset();
+  m_free.push_back({.commandBuffer = batch.commandBuffer, .fence = batch.fence});
+}
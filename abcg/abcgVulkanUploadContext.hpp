@@ -0,0 +1,109 @@
+/**
+ * @file abcgVulkanUploadContext.hpp
+ * @brief Header file of abcg::VulkanUploadContext.
+ *
+ * Declaration of abcg::VulkanUploadContext.
+ *
+ * This file is part of ABCg (https://github.com/hbatagelo/abcg).
+ *
+ * @copyright (c) 2021--2023 Harlen Batagelo. All rights reserved.
+ * This project is released under the MIT License.
+ */
+
+#ifndef ABCG_VULKAN_UPLOAD_CONTEXT_HPP_
+#define ABCG_VULKAN_UPLOAD_CONTEXT_HPP_
+
+#include "abcgVulkanAllocator.hpp"
+
+#include <deque>
+#include <mutex>
+#include <vector>
+
+#include <gsl/pointers>
+
+namespace abcg {
+class VulkanDevice;
+class VulkanUploadContext;
+} // namespace abcg
+
+/**
+ * @brief Batches host-to-device copies on the transfer queue.
+ *
+ * Data is copied into a persistently mapped staging ring buffer of
+ * abcg::VulkanUploadContext::ringSize bytes, and the copy commands are
+ * recorded into the command buffer of the current batch. Many uploads share a
+ * single submission, which signals a fence when done. Ring space is reclaimed
+ * when the fence of its batch is signaled. If the ring is full, the current
+ * batch is submitted and the oldest batches are waited for. Uploads larger
+ * than the ring use a temporary staging buffer that is released with its
+ * batch.
+ *
+ * abcg::VulkanDevice owns an upload context, which is used by
+ * abcg::VulkanBuffer and abcg::VulkanImage to fill device-local memory. The
+ * pending batch is flushed before the next frame is submitted and before
+ * abcg::VulkanDevice::withCommandBuffer, so resources created during
+ * `onCreate` are uploaded with a single wait.
+ *
+ * Uploads can be recorded from any thread.
+ *
+ * @remark abcg::VulkanUploadContext::submit (also called when the ring is
+ * full) submits to the transfer queue. If the transfer queue is the graphics
+ * queue, it must not be called while another thread submits to that queue.
+ */
+class abcg::VulkanUploadContext {
+public:
+  /** @brief Size of the staging ring buffer, in bytes. */
+  static constexpr vk::DeviceSize ringSize{32ULL * 1024 * 1024};
+
+  void create(VulkanDevice const &device);
+  void destroy();
+
+  void uploadToBuffer(vk::Buffer buffer, gsl::not_null<void const *> data,
+                      vk::DeviceSize size, vk::DeviceSize offset = 0UL);
+  void uploadToImage(vk::Image image, gsl::not_null<void const *> data,
+                     vk::DeviceSize size, vk::BufferImageCopy region,
+                     vk::ImageSubresourceRange const &subresourceRange,
+                     vk::ImageLayout finalLayout,
+                     vk::DeviceSize texelBlockSize = 4UL);
+
+  uint64_t submit();
+  [[nodiscard]] bool isComplete(uint64_t batch);
+  void wait(uint64_t batch);
+  void flush();
+
+private:
+  struct Batch {
+    uint64_t id{};
+    vk::CommandBuffer commandBuffer;
+    vk::Fence fence;
+    vk::DeviceSize ringBytes{};
+    std::vector<std::pair<vk::Buffer, VulkanAllocation>> temporaries;
+  };
+
+  [[nodiscard]] std::pair<vk::Buffer, vk::DeviceSize>
+  stage(void const *data, vk::DeviceSize size, vk::DeviceSize alignment);
+  vk::CommandBuffer const &getCommandBuffer();
+  uint64_t submitLocked();
+  void retire(bool wait);
+  void recycle(Batch &batch);
+
+  vk::Device m_device;
+  VulkanAllocator *m_allocator{};
+  vk::Queue m_queue;
+  vk::CommandPool m_commandPool;
+
+  vk::Buffer m_ringBuffer;
+  VulkanAllocation m_ringAllocation;
+  vk::DeviceSize m_ringHead{};
+  vk::DeviceSize m_ringUsed{};
+
+  Batch m_current;
+  bool m_recording{};
+  std::deque<Batch> m_pending;
+  std::vector<Batch> m_free;
+  uint64_t m_nextBatch{1};
+  uint64_t m_completedBatch{};
+  std::mutex m_mutex;
+};
+
+#endif
@@ -12,12 +12,15 @@
 
 #include <SDL_vulkan.h>
 #include <algorithm>
+#include <filesystem>
 #include <gsl/gsl>
 #include <imgui_impl_sdl2.h>
 #include <imgui_impl_vulkan.h>
 
+#include "abcgApplication.hpp"
 #include "abcgEmbeddedFonts.hpp"
 #include "abcgException.hpp"
+#include "abcgProfiler.hpp"
 #include "abcgVulkanError.hpp"
 #include "abcgVulkanInstance.hpp"
 #include "abcgWindow.hpp"
@@ -155,7 +158,8 @@ void abcg::VulkanWindow::onPaint([[maybe_unused]] VulkanFrame const &frame) {}
  * This is not called when the window is minimized.
  *
  * Override it for custom behavior. By default, it shows a FPS counter if
- * abcg::WindowSettings::showFPS is set to `true`, and a toggle fullscreen
+ * abcg::WindowSettings::showFPS is set to `true`, a profiler overlay if
+ * abcg::WindowSettings::showProfiler is set to `true`, and a toggle fullscreen
  * button if abcg::WindowSettings::showFullscreenButton is set to `true`.
  */
 void abcg::VulkanWindow::onPaintUI() {
@@ -187,6 +191,11 @@ void abcg::VulkanWindow::onPaintUI() {
     ImGui::End();
   }
 
+  // Profiler overlay
+  if (abcg::Window::getWindowSettings().showProfiler) {
+    Profiler::instance().paintOverlay();
+  }
+
   // Fullscreen button
   if (abcg::Window::getWindowSettings().showFullscreenButton) {
     auto const windowSize{getWindowSize()};
@@ -230,6 +239,24 @@ void abcg::VulkanWindow::onResize() {}
  */
 void abcg::VulkanWindow::onUpdate() {}
 
+/**
+ * @brief Custom handler for fixed-timestep updates.
+ *
+ * This virtual function is called zero or more times per frame, before
+ * abcg::VulkanWindow::onUpdate, so that the total simulated time follows the
+ * elapsed time in steps of constant size. It is only called if
+ * abcg::WindowSettings::fixedUpdateRate is greater than zero. Like
+ * abcg::VulkanWindow::onUpdate, it is called even if the window is minimized.
+ *
+ * Use abcg::Window::getFixedUpdateAlpha in the paint handlers to interpolate
+ * the simulation state between fixed updates.
+ *
+ * Override it for custom behavior. By default, it does nothing.
+ *
+ * @param deltaTime Fixed time step, in seconds.
+ */
+void abcg::VulkanWindow::onFixedUpdate([[maybe_unused]] double deltaTime) {}
+
 /**
  * @brief Custom handler for cleaning up Vulkan resources.
  *
@@ -301,8 +328,15 @@ void abcg::VulkanWindow::create() {
   m_physicalDevice.create(m_instance, m_surface, m_deviceExtensions,
                           sampleCount);
 
-  // Create logical device
-  m_device.create(m_physicalDevice, m_deviceExtensions);
+  // Create logical device, loading the pipeline cache of previous runs
+  std::filesystem::path pipelineCacheFile{m_vulkanSettings.pipelineCacheFile};
+  if (!pipelineCacheFile.empty() && pipelineCacheFile.is_relative()) {
+    pipelineCacheFile =
+        std::filesystem::path{abcg::Application::getBasePath()} /
+        pipelineCacheFile;
+  }
+  m_device.create(m_physicalDevice, m_deviceExtensions,
+                  pipelineCacheFile.string());
 
   // Create swapchain
   m_swapchain.create(m_device, m_vulkanSettings, getWindowSize());
@@ -352,7 +386,7 @@ void abcg::VulkanWindow::create() {
       .Device = static_cast<vk::Device>(m_device),
       .QueueFamily = m_physicalDevice.getQueuesFamilies().graphics.value_or(0),
       .Queue = m_device.getQueues().graphics,
-      .PipelineCache = VK_NULL_HANDLE,
+      .PipelineCache = m_device.getPipelineCache(),
       .DescriptorPool = m_UIdescriptorPool,
       .Subpass = 0,
       .MinImageCount = 2,
@@ -398,8 +432,16 @@ void abcg::VulkanWindow::create() {
   onResize();
 }
 
+void abcg::VulkanWindow::fixedUpdate(double deltaTime) {
+  ABCG_PROFILE_ZONE("onFixedUpdate");
+  onFixedUpdate(deltaTime);
+}
+
 void abcg::VulkanWindow::paint() {
-  onUpdate();
+  {
+    ABCG_PROFILE_ZONE("onUpdate");
+    onUpdate();
+  }
 
   if (m_hidden || m_minimized)
     return;
@@ -415,12 +457,23 @@ void abcg::VulkanWindow::paint() {
   ImGui_ImplSDL2_NewFrame();
   ImGui::NewFrame();
 
-  onPaintUI();
+  {
+    ABCG_PROFILE_ZONE("onPaintUI");
+    onPaintUI();
+    ImGui::Render();
+  }
 
-  ImGui::Render();
+  {
+    ABCG_PROFILE_ZONE("onPaint");
+    m_swapchain.render([this](auto const &frame) { onPaint(frame); });
+  }
+
+  {
+    ABCG_PROFILE_ZONE("Present");
+    m_swapchain.present();
+  }
 
-  m_swapchain.render([this](auto const &frame) { onPaint(frame); });
-  m_swapchain.present();
+  Profiler::instance().endFrame();
 }
 
 void abcg::VulkanWindow::destroy() {
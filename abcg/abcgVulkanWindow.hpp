@@ -13,6 +13,8 @@
 #ifndef ABCG_VULKAN_WINDOW_HPP_
 #define ABCG_VULKAN_WINDOW_HPP_
 
+#include <string>
+
 #include "abcgVulkanDevice.hpp"
 #include "abcgVulkanInstance.hpp"
 #include "abcgVulkanPhysicalDevice.hpp"
@@ -57,6 +59,35 @@ struct abcg::VulkanSettings {
    * comes first.
    */
   bool vSync{false};
+
+  /** @brief Path of the file used to persist the pipeline cache across runs.
+   *
+   * A relative path is relative to the application base path. The cache is
+   * loaded when the device is created, and saved when the window is destroyed.
+   * If empty, the cache is only kept in memory.
+   *
+   * @sa abcg::VulkanDevice::getPipelineCache.
+   */
+  std::string pipelineCacheFile{"pipeline_cache.bin"};
+
+  /** @brief Maximum number of frames being recorded by the CPU or rendered by
+   * the GPU at the same time.
+   *
+   * This is independent of the number of swapchain images. With 2 (default),
+   * the CPU records the next frame while the GPU renders the current one. With
+   * 1, the CPU waits for the GPU at each frame. Larger values may increase
+   * throughput at the expense of latency.
+   *
+   * @sa abcg::VulkanFrame::slot.
+   */
+  int framesInFlight{2};
+
+  /** @brief Number of threads used by abcg::VulkanFrame::recordParallel,
+   * including the main thread.
+   *
+   * If zero (default), one thread per core is used, up to 8.
+   */
+  int recordingThreads{0};
 };
 
 /**
@@ -72,6 +103,7 @@ struct abcg::VulkanSettings {
  * @sa abcg::VulkanWindow::onPaintUI for UI rendering.
  * @sa abcg::VulkanWindow::onResize for handling swapchain rebuild events.
  * @sa abcg::VulkanWindow::onUpdate for commands to be called every frame.
+ * @sa abcg::VulkanWindow::onFixedUpdate for fixed-timestep simulation updates.
  * @sa abcg::VulkanWindow::onDestroy for cleaning up Vulkan resources.
  *
  * @remark Objects of this type cannot be copied or copy-constructed.
@@ -92,11 +124,13 @@ protected:
   virtual void onPaintUI();
   virtual void onResize();
   virtual void onUpdate();
+  virtual void onFixedUpdate(double deltaTime);
   virtual void onDestroy();
 
 private:
   void handleEvent(SDL_Event const &event) final;
   void create() final;
+  void fixedUpdate(double deltaTime) final;
   void paint() final;
   void destroy() final;
   [[nodiscard]] glm::ivec2 getWindowSize() const final;
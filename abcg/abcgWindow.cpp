@@ -12,8 +12,12 @@
 
 #include <SDL_video.h>
 
+#include <cmath>
+
 #include <imgui_impl_sdl2.h>
 
+#include "abcgTrace.hpp"
+
 namespace {
 ImVec4 ColorAlpha(ImVec4 const &color, float const alpha) {
   return {color.x, color.y, color.z, alpha};
@@ -166,6 +170,33 @@ abcg::fullscreenchangeCallback(int eventType,
  */
 double abcg::Window::getDeltaTime() const noexcept { return m_lastDeltaTime; }
 
+/**
+ * @brief Returns the time step of the fixed-timestep update loop.
+ *
+ * @returns Time in seconds, or zero if the fixed-timestep loop is disabled.
+ *
+ * @sa abcg::WindowSettings::fixedUpdateRate.
+ */
+double abcg::Window::getFixedDeltaTime() const noexcept {
+  auto const rate{m_windowSettings.fixedUpdateRate};
+  return rate > 0.0 ? 1.0 / rate : 0.0;
+}
+
+/**
+ * @brief Returns the interpolation factor between the last two fixed-timestep
+ * updates.
+ *
+ * This is the fraction of a fixed time step that has accumulated but not yet
+ * been simulated. Use it in the paint handlers to interpolate (or extrapolate)
+ * the simulation state for rendering, so that motion stays smooth when the
+ * frame rate and the fixed update rate differ.
+ *
+ * @returns Value in the range [0, 1).
+ */
+double abcg::Window::getFixedUpdateAlpha() const noexcept {
+  return m_fixedUpdateAlpha;
+}
+
 /**
  * @brief Returns the time that have passed since the window was created.
  *
@@ -277,6 +308,20 @@ void abcg::Window::setEnableResizingEventWatcher(bool enabled) noexcept {
   m_enableResizingEventWatcher = enabled;
 }
 
+/**
+ * @brief Sets a constant time step for each frame.
+ *
+ * If greater than zero, abcg::Window::getDeltaTime returns this value and the
+ * fixed-timestep loop advances by this amount at each frame, regardless of the
+ * actual time taken to render it. This makes frame pacing deterministic, e.g.,
+ * for offline capture.
+ *
+ * @param frameTime Time step in seconds, or zero to use the measured time.
+ */
+void abcg::Window::setFixedFrameTime(double frameTime) noexcept {
+  m_fixedFrameTime = frameTime;
+}
+
 /**
  * @brief Toggles between fullscreen and windowed mode.
  */
@@ -376,11 +421,14 @@ void abcg::Window::templateHandleEvent(SDL_Event const &event, bool &done) {
   }
 
   if (useCustomEventHandler) {
+    ABCG_TRACE_ZONE("handleEvent");
     handleEvent(event);
   }
 }
 
 void abcg::Window::templateCreate() {
+  ABCG_TRACE_ZONE("create");
+
   m_deltaTime.restart();
   m_elapsedTime.restart();
 
@@ -391,16 +439,48 @@ void abcg::Window::templateCreate() {
 }
 
 void abcg::Window::templatePaint() {
-  // Cap to 480 Hz
-  if (m_deltaTime.elapsed() >= 1.0 / 480.0) {
+  ABCG_TRACE_ZONE("Frame", "frame");
+
+  if (m_fixedFrameTime > 0.0) {
+    m_deltaTime.restart();
+    m_lastDeltaTime = m_fixedFrameTime;
+  } else if (m_deltaTime.elapsed() >= 1.0 / 480.0) { // Cap to 480 Hz
     m_lastDeltaTime = m_deltaTime.restart();
   } else {
     m_lastDeltaTime = 0.0;
   }
 
+  templateFixedUpdate();
+
   paint();
 }
 
+void abcg::Window::templateFixedUpdate() {
+  auto const fixedDeltaTime{getFixedDeltaTime()};
+  if (fixedDeltaTime <= 0.0) {
+    m_fixedUpdateAccumulator = 0.0;
+    m_fixedUpdateAlpha = 0.0;
+    return;
+  }
+
+  m_fixedUpdateAccumulator += m_lastDeltaTime;
+
+  auto steps{0};
+  while (m_fixedUpdateAccumulator >= fixedDeltaTime) {
+    if (steps >= m_windowSettings.maxFixedUpdateSteps) {
+      // Too far behind: drop the excess time instead of spiraling
+      m_fixedUpdateAccumulator =
+          std::fmod(m_fixedUpdateAccumulator, fixedDeltaTime);
+      break;
+    }
+    fixedUpdate(fixedDeltaTime);
+    m_fixedUpdateAccumulator -= fixedDeltaTime;
+    ++steps;
+  }
+
+  m_fixedUpdateAlpha = m_fixedUpdateAccumulator / fixedDeltaTime;
+}
+
 void abcg::Window::templateDestroy() {
   if (m_window == nullptr)
     return;
@@ -60,6 +60,12 @@ struct abcg::WindowSettings {
   int height{600};
   /** @brief Whether to show an overlay window with a FPS counter. */
   bool showFPS{true};
+  /** @brief Whether to show an overlay window with the percentiles of the
+   * frame time and of the time spent in each profiled zone.
+   *
+   * @sa abcg::Profiler.
+   */
+  bool showProfiler{false};
   /** @brief Whether to show a button to toggle fullscreen on/off. */
   bool showFullscreenButton{true};
   /** @brief HTML element ID used for registering the fullscreen callback when
@@ -68,6 +74,21 @@ struct abcg::WindowSettings {
   std::string fullscreenElementID{"#canvas"};
   /** @brief String containing the window title. */
   std::string title{"ABCg Window"};
+  /** @brief Rate of the fixed-timestep update loop, in Hz.
+   *
+   * If greater than zero, the fixed update hook (e.g.,
+   * abcg::OpenGLWindow::onFixedUpdate) is called at this rate regardless of
+   * the frame rate, possibly several times per frame. If zero, the
+   * fixed-timestep loop is disabled.
+   */
+  double fixedUpdateRate{0.0};
+  /** @brief Maximum number of fixed-timestep updates per frame.
+   *
+   * If the simulation falls behind by more than this number of steps (e.g.,
+   * after a stall), the excess time is dropped instead of being caught up in
+   * subsequent frames.
+   */
+  int maxFixedUpdateSteps{8};
 };
 
 /**
@@ -134,6 +155,16 @@ protected:
    */
   virtual void paint() = 0;
 
+  /**
+   * @brief Custom handler for fixed-timestep updates.
+   *
+   * This is called zero or more times per frame, before abcg::Window::paint,
+   * when abcg::WindowSettings::fixedUpdateRate is greater than zero.
+   *
+   * @param deltaTime Fixed time step, in seconds.
+   */
+  virtual void fixedUpdate(double deltaTime) = 0;
+
   /**
    * @brief Custom handler for window cleanup tasks.
    *
@@ -153,18 +184,22 @@ protected:
   [[nodiscard]] virtual glm::ivec2 getWindowSize() const = 0;
 
   [[nodiscard]] double getDeltaTime() const noexcept;
+  [[nodiscard]] double getFixedDeltaTime() const noexcept;
+  [[nodiscard]] double getFixedUpdateAlpha() const noexcept;
   [[nodiscard]] double getElapsedTime() const;
   [[nodiscard]] SDL_Window *getSDLWindow() const noexcept;
   [[nodiscard]] Uint32 getSDLWindowID() const noexcept;
 
   bool createSDLWindow(SDL_WindowFlags extraFlags);
   void setEnableResizingEventWatcher(bool enabled) noexcept;
+  void setFixedFrameTime(double frameTime) noexcept;
   void toggleFullscreen();
 
 private:
   void templateHandleEvent(SDL_Event const &event, bool &done);
   void templateCreate();
   void templatePaint();
+  void templateFixedUpdate();
   void templateDestroy();
 
   SDL_Window *m_window{};
@@ -175,6 +210,9 @@ private:
   Timer m_deltaTime;
   Timer m_elapsedTime;
   double m_lastDeltaTime{};
+  double m_fixedFrameTime{};
+  double m_fixedUpdateAccumulator{};
+  double m_fixedUpdateAlpha{};
 
   bool m_enableResizingEventWatcher{true};
 
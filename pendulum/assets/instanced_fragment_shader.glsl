@@ -0,0 +1,10 @@
+#version 300 es
+precision mediump float;
+
+in vec4 fragColor;
+
+out vec4 outColor;
+
+void main() {
+  outColor = fragColor;
+}
@@ -0,0 +1,22 @@
+#version 300 es
+precision mediump float;
+
+layout(location = 0) in vec3 inPosition;
+
+// Per-instance attributes
+layout(location = 1) in vec4 inTranslationScale; // xyz: translation, w: scale
+layout(location = 2) in vec4 inColor;
+
+// Per-frame camera state, shared by all programs
+layout(std140) uniform CameraBlock {
+  mat4 viewMatrix;
+  mat4 projMatrix;
+};
+
+out vec4 fragColor;
+
+void main() {
+  vec3 position = inTranslationScale.xyz + inTranslationScale.w * inPosition;
+  fragColor = inColor;
+  gl_Position = projMatrix * viewMatrix * vec4(position, 1.0);
+}
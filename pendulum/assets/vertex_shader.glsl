@@ -4,8 +4,12 @@ precision mediump float;
 layout(location = 0) in vec3 inPosition;
 
 uniform mat4 modelMatrix;
-uniform mat4 viewMatrix;
-uniform mat4 projMatrix;
+
+// Per-frame camera state, shared by all programs
+layout(std140) uniform CameraBlock {
+  mat4 viewMatrix;
+  mat4 projMatrix;
+};
 
 void main() {
   gl_Position = projMatrix * viewMatrix * modelMatrix * vec4(inPosition, 1.0);
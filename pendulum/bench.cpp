@@ -0,0 +1,157 @@
+// bench.cpp
+//
+// Throughput benchmark of PendulumSystem. Advances ensembles of 1k, 100k and
+// 10M pendulums for a fixed number of steps and reports the median rate in
+// pendulums per second, then does the same for the bob positions.
+//
+// Before benchmarking, the vectorized kernels are checked against the scalar
+// path (std::fmod for the angle update, std::sin/std::cos for the positions)
+// over one million pendulums with random parameters. The program fails if
+// they disagree by more than the tolerances below.
+//
+// Usage: pendulum-bench [--repeat N]
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include <cppitertools/itertools.hpp>
+#include <glm/gtc/constants.hpp>
+
+#include "abcgException.hpp"
+#include "abcgExternal.hpp"
+#include "bench.hpp"
+#include "pendulumsystem.hpp"
+
+namespace {
+// Ensemble sizes to benchmark
+constexpr std::array<std::size_t, 3> counts{1'000, 100'000, 10'000'000};
+
+// Number of pendulum updates per measurement. Smaller ensembles run more
+// steps so that every measurement takes about the same time.
+constexpr std::size_t updatesPerRun{100'000'000};
+
+// Maximum absolute errors accepted against the scalar path. Positions are
+// compared for rope lengths of at most 2 m.
+constexpr float angleTolerance{1e-6f};
+constexpr float positionTolerance{1e-6f};
+
+// Distance between two angles, accounting for the wrap at 2π
+float angleDistance(float lhs, float rhs) {
+  auto const distance{std::abs(lhs - rhs)};
+  return std::min(distance, 2.0f * glm::pi<float>() - distance);
+}
+
+// Checks the vectorized kernels against the scalar path and prints the
+// maximum errors
+void checkKernels() {
+  constexpr std::size_t count{1'000'000};
+  constexpr float deltaTime{1.0f / 120.0f};
+  std::mt19937 generator{42}; // NOLINT(cert-msc51-cpp)
+  std::uniform_real_distribution<float> lengths{0.1f, 2.0f};
+  std::uniform_real_distribution<float> inclinations{glm::radians(1.0f),
+                                                     glm::radians(85.0f)};
+  std::uniform_real_distribution<float> angles{0.0f, 2.0f * glm::pi<float>()};
+
+  PendulumSystem pendulums;
+  pendulums.reserve(count);
+  for ([[maybe_unused]] auto const index : iter::range(count)) {
+    pendulums.add(lengths(generator), inclinations(generator),
+                  angles(generator));
+  }
+
+  // Angle update against std::fmod
+  std::vector<float> expected(pendulums.angles().begin(),
+                              pendulums.angles().end());
+  auto const rates{pendulums.angularVelocities()};
+  for (auto const index : iter::range(count)) {
+    expected[index] = std::fmod(expected[index] + rates[index] * deltaTime,
+                                2.0f * glm::pi<float>());
+  }
+  pendulums.update(deltaTime);
+  float angleError{};
+  for (auto const index : iter::range(count)) {
+    angleError = std::max(
+        angleError, angleDistance(pendulums.angles()[index], expected[index]));
+  }
+
+  // Bob positions against std::sin/std::cos
+  glm::vec3 const pivot{0.0f, 1.5f, 0.0f};
+  std::vector<glm::vec3> positions(count);
+  pendulums.computeBobPositions(pivot, positions);
+  float positionError{};
+  for (auto const index : iter::range(count)) {
+    auto const difference{
+        glm::abs(positions[index] - pendulums.bobPosition(index, pivot))};
+    positionError = std::max({positionError, difference.x, difference.y,
+                              difference.z});
+  }
+
+  fmt::print("Angle update max error...: {:.3e}\n", angleError);
+  fmt::print("Bob position max error...: {:.3e}\n", positionError);
+  if (angleError > angleTolerance || positionError > positionTolerance) {
+    throw abcg::RuntimeError(
+        "The vectorized kernels disagree with the scalar path");
+  }
+}
+
+void fill(PendulumSystem &pendulums, std::size_t count) {
+  pendulums.clear();
+  pendulums.reserve(count);
+  for (auto const index : iter::range(count)) {
+    auto const phase{2.0f * glm::pi<float>() * static_cast<float>(index) /
+                     static_cast<float>(count)};
+    pendulums.add(1.0f, glm::radians(45.0f), phase);
+  }
+}
+} // namespace
+
+int main(int argc, char **argv) {
+  try {
+    std::size_t repeat{5};
+    bench::parseOptions(argc, argv, repeat);
+
+    checkKernels();
+
+    PendulumSystem pendulums;
+    fmt::print("Update:\n");
+    for (auto const count : counts) {
+      fill(pendulums, count);
+      auto const steps{std::max<std::size_t>(updatesPerRun / count, 1)};
+      auto const time{bench::measure(repeat, [&] {
+        for ([[maybe_unused]] auto const step : iter::range(steps)) {
+          pendulums.update(1.0f / 120.0f);
+        }
+      })};
+      auto const updates{static_cast<double>(count) *
+                         static_cast<double>(steps)};
+      fmt::print("{:>10} pendulums: {:>6} steps in {:>8.2f} ms "
+                 "({:.3e} pendulums/s)\n",
+                 count, steps, time, updates / (time / 1000.0));
+    }
+
+    std::vector<glm::vec3> positions;
+    fmt::print("Bob positions:\n");
+    for (auto const count : counts) {
+      fill(pendulums, count);
+      positions.resize(count);
+      auto const steps{std::max<std::size_t>(updatesPerRun / count, 1)};
+      auto const time{bench::measure(repeat, [&] {
+        for (auto const step : iter::range(steps)) {
+          pendulums.computeBobPositions(glm::vec3{0.0f}, positions,
+                                        static_cast<float>(step) * 1e-3f);
+        }
+      })};
+      auto const updates{static_cast<double>(count) *
+                         static_cast<double>(steps)};
+      fmt::print("{:>10} pendulums: {:>6} steps in {:>8.2f} ms "
+                 "({:.3e} pendulums/s)\n",
+                 count, steps, time, updates / (time / 1000.0));
+    }
+  } catch (std::exception const &e) {
+    fmt::print("Exception: {}\n", e.what());
+    return -1;
+  }
+  return 0;
+}
@@ -0,0 +1,57 @@
+// linebatch.cpp
+#include "linebatch.hpp"
+
+#include <algorithm>
+#include <bit>
+
+void LineBatch::create(GLuint program) {
+  m_program = program;
+
+  glGenVertexArrays(1, &m_VAO);
+  glGenBuffers(1, &m_VBO);
+
+  // The attribute layout never changes, so it is recorded in the VAO once
+  glBindVertexArray(m_VAO);
+  glBindBuffer(GL_ARRAY_BUFFER, m_VBO);
+
+  GLint positionAttribute = glGetAttribLocation(m_program, "inPosition");
+  glEnableVertexAttribArray(positionAttribute);
+  glVertexAttribPointer(positionAttribute, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), nullptr);
+
+  glBindVertexArray(0);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void LineBatch::clear() { m_vertices.clear(); }
+
+void LineBatch::add(glm::vec3 const &start, glm::vec3 const &end) {
+  m_vertices.push_back(start);
+  m_vertices.push_back(end);
+}
+
+void LineBatch::paint() {
+  if (m_vertices.empty())
+    return;
+
+  glBindBuffer(GL_ARRAY_BUFFER, m_VBO);
+
+  // Grow geometrically so that the storage is rarely reallocated. Otherwise,
+  // orphan it: re-specifying it with the same size lets the driver return new
+  // memory without synchronizing with pending draws.
+  m_capacity = std::max(m_capacity, std::bit_ceil(m_vertices.size()));
+  glBufferData(GL_ARRAY_BUFFER, m_capacity * sizeof(glm::vec3), nullptr, GL_STREAM_DRAW);
+  glBufferSubData(GL_ARRAY_BUFFER, 0, m_vertices.size() * sizeof(glm::vec3), m_vertices.data());
+
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+  glBindVertexArray(m_VAO);
+  glDrawArrays(GL_LINES, 0, static_cast<GLsizei>(m_vertices.size()));
+  glBindVertexArray(0);
+}
+
+void LineBatch::destroy() {
+  glDeleteBuffers(1, &m_VBO);
+  glDeleteVertexArrays(1, &m_VAO);
+  m_vertices.clear();
+  m_capacity = 0;
+}
@@ -0,0 +1,39 @@
+// linebatch.hpp
+#ifndef LINEBATCH_HPP_
+#define LINEBATCH_HPP_
+
+#include "abcgOpenGL.hpp"
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+// Collects line segments into a CPU staging array and draws them all with a
+// single glDrawArrays(GL_LINES) call.
+//
+// The VBO is kept across frames and only reallocated when it needs to grow.
+// Each paint() orphans its storage before uploading, so the driver can hand
+// out fresh memory instead of waiting for the previous frame's draw to finish.
+class LineBatch {
+ public:
+  void create(GLuint program);
+  void clear();
+  void add(glm::vec3 const &start, glm::vec3 const &end);
+  void paint();
+  void destroy();
+
+  [[nodiscard]] std::size_t size() const noexcept {
+    return m_vertices.size() / 2;
+  }
+
+ private:
+  GLuint m_VAO{};
+  GLuint m_VBO{};
+
+  std::vector<glm::vec3> m_vertices;
+  std::size_t m_capacity{}; // Capacity of the VBO, in vertices
+
+  GLuint m_program{};
+};
+
+#endif
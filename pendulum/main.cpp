@@ -5,7 +5,10 @@ int main(int argc, char **argv) {
   try {
     abcg::Application app(argc, argv);
     Window window;
-    window.setWindowSettings({.width = 800, .height = 600, .title = "Pêndulo Cônico em 3D"});
+    window.setWindowSettings({.width = 800,
+                              .height = 600,
+                              .title = "Pêndulo Cônico em 3D",
+                              .fixedUpdateRate = 120.0});
     app.run(window);
   } catch (std::exception const &e) {
     fmt::print("Exception: {}\n", e.what());
@@ -0,0 +1,178 @@
+// pendulumsystem.cpp
+#include "pendulumsystem.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#include <glm/gtc/constants.hpp>
+#include <gsl/gsl>
+
+// Runtime CPU dispatch: GCC and Clang emit one clone of the function per
+// target and an ifunc resolver that picks the best clone at load time.
+#if defined(__x86_64__) && defined(__linux__) &&                              \
+    (defined(__GNUC__) || defined(__clang__))
+#define PENDULUM_SIMD_CLONES                                                   \
+  __attribute__((target_clones("avx512f", "avx2", "sse4.2", "default")))
+#else
+#define PENDULUM_SIMD_CLONES
+#endif
+
+namespace {
+// Branch-free single-precision sine and cosine (Cephes sinf/cosf
+// polynomials). Unlike std::sin/std::cos, this is inlined into the callers'
+// loops so they can be vectorized. The maximum absolute error is below 2e-7
+// for |x| < 8192.
+inline void sinCos(float x, float &sine, float &cosine) {
+  constexpr float twoOverPi{0.636619772367581343f};
+  // π/2 split into three parts for an accurate Cody-Waite reduction
+  constexpr float halfPi1{1.5703125f};
+  constexpr float halfPi2{4.837512969970703125e-4f};
+  constexpr float halfPi3{7.54978995489188216e-8f};
+
+  // Quadrant, rounded half away from zero
+  auto const quadrant{
+      static_cast<int>(x * twoOverPi + std::copysign(0.5f, x))};
+  auto const quadrantF{static_cast<float>(quadrant)};
+
+  // Reduce to [-π/4, π/4]
+  auto const y{((x - quadrantF * halfPi1) - quadrantF * halfPi2) -
+               quadrantF * halfPi3};
+  auto const z{y * y};
+
+  auto const sinPoly{
+      y + y * z *
+              (-1.6666654611e-1f +
+               z * (8.3321608736e-3f + z * -1.9515295891e-4f))};
+  auto const cosPoly{
+      1.0f - 0.5f * z +
+      z * z *
+          (4.166664568298827e-2f +
+           z * (-1.388731625493765e-3f + z * 2.443315711809948e-5f))};
+
+  // Swap and negate according to the quadrant. This is done arithmetically
+  // rather than with selects, which would be control flow for the vectorizer.
+  auto const swap{static_cast<float>(quadrant & 1)};
+  auto const sineSign{1.0f - static_cast<float>(quadrant & 2)};
+  auto const cosineSign{1.0f - static_cast<float>((quadrant + 1) & 2)};
+  sine = sineSign * (sinPoly + swap * (cosPoly - sinPoly));
+  cosine = cosineSign * (cosPoly + swap * (sinPoly - cosPoly));
+}
+
+// Advances each angle by rate * step and wraps it to [0, 2π). Truncating
+// through an integer conversion is equivalent to std::floor for non-negative
+// angles, but unlike std::fmod it keeps the loop vectorizable.
+PENDULUM_SIMD_CLONES
+void advanceAngles(float *__restrict angles, float const *__restrict rates,
+                   std::size_t count, float step) {
+  auto const twoPi{2.0f * glm::pi<float>()};
+  auto const invTwoPi{1.0f / twoPi};
+  for (std::size_t index = 0; index < count; ++index) {
+    auto const angle{angles[index] + rates[index] * step};
+    auto const turns{static_cast<float>(static_cast<int>(angle * invTwoPi))};
+    angles[index] = angle - turns * twoPi;
+  }
+}
+
+// Writes interleaved xyz bob positions to `positions`, with each angle
+// advanced by rate * timeOffset
+PENDULUM_SIMD_CLONES
+void bobPositions(float const *__restrict angles,
+                  float const *__restrict rates,
+                  float const *__restrict radii,
+                  float const *__restrict drops, std::size_t count,
+                  float timeOffset, float pivotX, float pivotY, float pivotZ,
+                  float *__restrict positions) {
+  for (std::size_t index = 0; index < count; ++index) {
+    float sine{};
+    float cosine{};
+    sinCos(angles[index] + rates[index] * timeOffset, sine, cosine);
+    positions[3 * index + 0] = pivotX + radii[index] * cosine;
+    positions[3 * index + 1] = pivotY - drops[index];
+    positions[3 * index + 2] = pivotZ + radii[index] * sine;
+  }
+}
+} // namespace
+
+void PendulumSystem::clear() {
+  m_angles.clear();
+  m_angularVelocities.clear();
+  m_ropeLengths.clear();
+  m_inclinations.clear();
+  m_radii.clear();
+  m_drops.clear();
+}
+
+void PendulumSystem::reserve(std::size_t count) {
+  m_angles.reserve(count);
+  m_angularVelocities.reserve(count);
+  m_ropeLengths.reserve(count);
+  m_inclinations.reserve(count);
+  m_radii.reserve(count);
+  m_drops.reserve(count);
+}
+
+std::size_t PendulumSystem::add(float ropeLength, float inclination,
+                                float angle) {
+  m_angles.push_back(angle);
+  m_angularVelocities.push_back(angularVelocity(ropeLength, inclination));
+  m_ropeLengths.push_back(ropeLength);
+  m_inclinations.push_back(inclination);
+  m_radii.push_back(ropeLength * std::sin(inclination));
+  m_drops.push_back(ropeLength * std::cos(inclination));
+  return m_angles.size() - 1;
+}
+
+void PendulumSystem::setParameters(float ropeLength, float inclination) {
+  auto const rate{angularVelocity(ropeLength, inclination)};
+  std::fill(m_angularVelocities.begin(), m_angularVelocities.end(), rate);
+  std::fill(m_ropeLengths.begin(), m_ropeLengths.end(), ropeLength);
+  std::fill(m_inclinations.begin(), m_inclinations.end(), inclination);
+  std::fill(m_radii.begin(), m_radii.end(),
+            ropeLength * std::sin(inclination));
+  std::fill(m_drops.begin(), m_drops.end(),
+            ropeLength * std::cos(inclination));
+}
+
+void PendulumSystem::setParameters(std::size_t index, float ropeLength,
+                                   float inclination) {
+  m_angularVelocities.at(index) = angularVelocity(ropeLength, inclination);
+  m_ropeLengths.at(index) = ropeLength;
+  m_inclinations.at(index) = inclination;
+  m_radii.at(index) = ropeLength * std::sin(inclination);
+  m_drops.at(index) = ropeLength * std::cos(inclination);
+}
+
+void PendulumSystem::update(float deltaTime, float speedFactor) {
+  advanceAngles(m_angles.data(), m_angularVelocities.data(), m_angles.size(),
+                deltaTime * speedFactor);
+}
+
+glm::vec3 PendulumSystem::bobPosition(std::size_t index,
+                                      glm::vec3 const &pivot) const {
+  auto const radius{m_radii[index]};
+  auto const angle{m_angles[index]};
+
+  return {pivot.x + radius * std::cos(angle), pivot.y - m_drops[index],
+          pivot.z + radius * std::sin(angle)};
+}
+
+// Computes the positions of all bobs at once. `positions` must have at least
+// size() elements. `timeOffset` (in seconds, already scaled by the speed
+// factor) extrapolates the angles past the last update, e.g. to interpolate
+// between fixed-timestep updates.
+void PendulumSystem::computeBobPositions(glm::vec3 const &pivot,
+                                         std::span<glm::vec3> positions,
+                                         float timeOffset) const {
+  Expects(positions.size() >= size());
+  if (m_angles.empty())
+    return;
+  static_assert(sizeof(glm::vec3) == 3 * sizeof(float));
+  bobPositions(m_angles.data(), m_angularVelocities.data(), m_radii.data(),
+               m_drops.data(), size(), timeOffset, pivot.x, pivot.y, pivot.z,
+               &positions.front().x);
+}
+
+// ω in radians per second
+float PendulumSystem::angularVelocity(float ropeLength, float inclination) {
+  return std::sqrt((gravity * std::tan(inclination)) / ropeLength);
+}
@@ -0,0 +1,173 @@
+// sim.cpp
+//
+// Headless pendulum simulation. Runs the pendulum physics for a fixed number
+// of steps as fast as possible, without a window or graphics context, and
+// streams the state to a file.
+//
+// Usage: pendulum-sim [--count N] [--steps N] [--dt SECONDS]
+//                     [--rope-length METERS] [--inclination DEGREES]
+//                     [--every N] [--format bin|csv] [--output FILE]
+//
+// The binary format is a header with the magic "PSIM", the number of
+// pendulums (uint32) and the time step (float32), followed by one record per
+// saved step: the simulation time (float32) and the azimuth of each pendulum
+// (float32 each). All values are in the native byte order of the machine that
+// wrote the file. The CSV format has one row per saved step, with the time
+// followed by the azimuth of each pendulum.
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <span>
+#include <string>
+#include <string_view>
+
+#include <glm/gtc/constants.hpp>
+
+#include "abcgApplication.hpp"
+#include "abcgException.hpp"
+#include "abcgExternal.hpp"
+#include "pendulumsystem.hpp"
+
+namespace {
+struct Options {
+  std::size_t count{1000};
+  std::size_t steps{10000};
+  float deltaTime{1.0f / 120.0f};
+  float ropeLength{1.0f};
+  float inclination{glm::radians(45.0f)};
+  std::size_t every{1};
+  bool csv{false};
+  std::string output;
+};
+
+Options parseOptions(int argc, char **argv) {
+  Options options;
+  std::span const args{argv, static_cast<std::size_t>(argc)};
+  for (std::size_t index = 1; index < args.size(); ++index) {
+    std::string_view const arg{args[index]};
+    if (index + 1 == args.size()) {
+      throw abcg::RuntimeError(fmt::format("Missing value for {}", arg));
+    }
+    std::string const value{args[++index]};
+    if (arg == "--count") {
+      options.count = std::stoul(value);
+    } else if (arg == "--steps") {
+      options.steps = std::stoul(value);
+    } else if (arg == "--dt") {
+      options.deltaTime = std::stof(value);
+    } else if (arg == "--rope-length") {
+      options.ropeLength = std::stof(value);
+    } else if (arg == "--inclination") {
+      options.inclination = glm::radians(std::stof(value));
+    } else if (arg == "--every") {
+      options.every = std::max<std::size_t>(std::stoul(value), 1);
+    } else if (arg == "--format") {
+      if (value != "bin" && value != "csv") {
+        throw abcg::RuntimeError(fmt::format("Unknown format {}", value));
+      }
+      options.csv = value == "csv";
+    } else if (arg == "--output") {
+      options.output = value;
+    } else {
+      throw abcg::RuntimeError(fmt::format("Unknown option {}", arg));
+    }
+  }
+  return options;
+}
+
+template <typename T> void writeBinary(std::ofstream &stream, T const &value) {
+  stream.write(reinterpret_cast<char const *>(&value), sizeof(value));
+}
+
+void writeHeader(std::ofstream &stream, Options const &options) {
+  if (options.csv) {
+    stream << "time";
+    for (std::size_t index = 0; index < options.count; ++index) {
+      stream << ",angle" << index;
+    }
+    stream << '\n';
+  } else {
+    stream.write("PSIM", 4);
+    writeBinary(stream, static_cast<std::uint32_t>(options.count));
+    writeBinary(stream, options.deltaTime);
+  }
+}
+
+void writeState(std::ofstream &stream, Options const &options, float time,
+                PendulumSystem const &pendulums) {
+  auto const angles{pendulums.angles()};
+  if (options.csv) {
+    stream << time;
+    for (auto const angle : angles) {
+      stream << ',' << angle;
+    }
+    stream << '\n';
+  } else {
+    writeBinary(stream, time);
+    stream.write(reinterpret_cast<char const *>(angles.data()),
+                 static_cast<std::streamsize>(angles.size_bytes()));
+  }
+}
+} // namespace
+
+int main(int argc, char **argv) {
+  try {
+    abcg::Application app(argc, argv);
+    auto const options{parseOptions(argc, argv)};
+
+    PendulumSystem pendulums;
+    pendulums.reserve(options.count);
+    for (std::size_t index = 0; index < options.count; ++index) {
+      auto const phase{2.0f * glm::pi<float>() * static_cast<float>(index) /
+                       static_cast<float>(options.count)};
+      pendulums.add(options.ropeLength, options.inclination, phase);
+    }
+
+    std::ofstream stream;
+    if (!options.output.empty()) {
+      stream.open(options.output, options.csv
+                                      ? std::ios::out
+                                      : std::ios::out | std::ios::binary);
+      if (!stream) {
+        throw abcg::RuntimeError(
+            fmt::format("Failed to open {}", options.output));
+      }
+      writeHeader(stream, options);
+    }
+
+    std::size_t step{};
+    auto const start{std::chrono::steady_clock::now()};
+    app.runHeadless([&] {
+      if (step == options.steps)
+        return false;
+      pendulums.update(options.deltaTime);
+      ++step;
+      if (stream.is_open() && step % options.every == 0) {
+        writeState(stream, options,
+                   static_cast<float>(step) * options.deltaTime, pendulums);
+      }
+      return true;
+    });
+    std::chrono::duration<double> const elapsed{
+        std::chrono::steady_clock::now() - start};
+
+    if (stream.is_open()) {
+      stream.flush();
+      if (!stream) {
+        throw abcg::RuntimeError(
+            fmt::format("Failed to write {}", options.output));
+      }
+    }
+
+    auto const updates{static_cast<double>(options.count) *
+                       static_cast<double>(options.steps)};
+    fmt::print("{} pendulums, {} steps in {:.3f} s ({:.3e} pendulum steps/s)\n",
+               options.count, options.steps, elapsed.count(),
+               elapsed.count() > 0.0 ? updates / elapsed.count() : 0.0);
+  } catch (std::exception const &e) {
+    fmt::print("Exception: {}\n", e.what());
+    return -1;
+  }
+  return 0;
+}
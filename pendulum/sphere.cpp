@@ -3,6 +3,9 @@
 
 #include <vector>
 #include <cmath>
+#include <cstddef>
+
+#include "abcgMeshOptimizer.hpp"
 
 void Sphere::create(GLuint program) {
   m_program = program;
@@ -26,21 +29,31 @@ void Sphere::create(GLuint program) {
     }
   }
 
-  bool oddRow = false;
+  // Triangle list, skipping the degenerate triangles at the poles
+  auto vertexIndex = [](unsigned int x, unsigned int y) { return y * (X_SEGMENTS + 1) + x; };
   for (unsigned int y = 0; y < Y_SEGMENTS; ++y) {
-    if (!oddRow) {
-      for (unsigned int x = 0; x <= X_SEGMENTS; ++x) {
-        indices.push_back(y * (X_SEGMENTS + 1) + x);
-        indices.push_back((y + 1) * (X_SEGMENTS + 1) + x);
+    for (unsigned int x = 0; x < X_SEGMENTS; ++x) {
+      if (y != 0) {
+        indices.insert(indices.end(),
+                       {vertexIndex(x, y), vertexIndex(x, y + 1), vertexIndex(x + 1, y)});
       }
-    } else {
-      for (int x = X_SEGMENTS; x >= 0; --x) {
-        indices.push_back((y + 1) * (X_SEGMENTS + 1) + x);
-        indices.push_back(y * (X_SEGMENTS + 1) + x);
+      if (y != Y_SEGMENTS - 1) {
+        indices.insert(indices.end(),
+                       {vertexIndex(x + 1, y), vertexIndex(x, y + 1), vertexIndex(x + 1, y + 1)});
       }
     }
-    oddRow = !oddRow;
   }
+
+  // Reorder for the post-transform cache, overdraw and vertex fetch, then
+  // store positions as half floats and indices as 16-bit integers
+  abcg::optimizeVertexCache(indices, positions.size());
+  abcg::optimizeOverdraw(indices, positions);
+  auto const remap = abcg::optimizeVertexFetch(indices, positions.size());
+  positions = abcg::remapVertices<glm::vec3>(positions, remap);
+
+  auto const halfPositions = abcg::quantizePositions(positions);
+  m_indexSize = abcg::selectIndexSize(positions.size());
+  auto const indexData = abcg::packIndices(indices, m_indexSize);
   m_indicesCount = static_cast<int>(indices.size());
 
   // Generate buffers
@@ -51,26 +64,83 @@ void Sphere::create(GLuint program) {
   glBindVertexArray(m_VAO);
 
   glBindBuffer(GL_ARRAY_BUFFER, m_VBO);
-  glBufferData(GL_ARRAY_BUFFER, positions.size() * sizeof(glm::vec3), positions.data(), GL_STATIC_DRAW);
+  glBufferData(GL_ARRAY_BUFFER, halfPositions.size() * sizeof(glm::u16vec4), halfPositions.data(),
+               GL_STATIC_DRAW);
 
   glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_EBO);
-  glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint), indices.data(), GL_STATIC_DRAW);
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexData.size(), indexData.data(), GL_STATIC_DRAW);
 
   // Position attribute
   GLint positionAttribute = glGetAttribLocation(m_program, "inPosition");
   glEnableVertexAttribArray(positionAttribute);
-  glVertexAttribPointer(positionAttribute, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), nullptr);
+  glVertexAttribPointer(positionAttribute, 4, GL_HALF_FLOAT, GL_FALSE, sizeof(glm::u16vec4), nullptr);
 
   glBindVertexArray(0);
 }
 
+void Sphere::createInstanced(GLuint program) {
+  glGenVertexArrays(1, &m_instancedVAO);
+  glGenBuffers(1, &m_instanceVBO);
+
+  glBindVertexArray(m_instancedVAO);
+
+  // Share the geometry with the non-instanced VAO
+  glBindBuffer(GL_ARRAY_BUFFER, m_VBO);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_EBO);
+
+  GLint positionAttribute = glGetAttribLocation(program, "inPosition");
+  glEnableVertexAttribArray(positionAttribute);
+  glVertexAttribPointer(positionAttribute, 4, GL_HALF_FLOAT, GL_FALSE, sizeof(glm::u16vec4), nullptr);
+
+  // Per-instance attributes, advanced once per instance
+  glBindBuffer(GL_ARRAY_BUFFER, m_instanceVBO);
+
+  GLint translationScaleAttribute = glGetAttribLocation(program, "inTranslationScale");
+  glEnableVertexAttribArray(translationScaleAttribute);
+  glVertexAttribPointer(translationScaleAttribute, 4, GL_FLOAT, GL_FALSE, sizeof(SphereInstance),
+                        reinterpret_cast<void *>(offsetof(SphereInstance, translationScale)));
+  glVertexAttribDivisor(translationScaleAttribute, 1);
+
+  GLint colorAttribute = glGetAttribLocation(program, "inColor");
+  glEnableVertexAttribArray(colorAttribute);
+  glVertexAttribPointer(colorAttribute, 4, GL_FLOAT, GL_FALSE, sizeof(SphereInstance),
+                        reinterpret_cast<void *>(offsetof(SphereInstance, color)));
+  glVertexAttribDivisor(colorAttribute, 1);
+
+  glBindVertexArray(0);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+GLenum Sphere::indexType() const {
+  return m_indexSize == sizeof(GLushort) ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+}
+
 void Sphere::paint() {
   glBindVertexArray(m_VAO);
-  glDrawElements(GL_TRIANGLE_STRIP, m_indicesCount, GL_UNSIGNED_INT, nullptr);
+  glDrawElements(GL_TRIANGLES, m_indicesCount, indexType(), nullptr);
+  glBindVertexArray(0);
+}
+
+void Sphere::paintInstanced(std::span<SphereInstance const> instances) {
+  if (instances.empty())
+    return;
+
+  // Orphan the previous storage so the driver does not stall on draws that
+  // still read from it
+  glBindBuffer(GL_ARRAY_BUFFER, m_instanceVBO);
+  glBufferData(GL_ARRAY_BUFFER, instances.size_bytes(), nullptr, GL_STREAM_DRAW);
+  glBufferSubData(GL_ARRAY_BUFFER, 0, instances.size_bytes(), instances.data());
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+  glBindVertexArray(m_instancedVAO);
+  glDrawElementsInstanced(GL_TRIANGLES, m_indicesCount, indexType(), nullptr,
+                          static_cast<GLsizei>(instances.size()));
   glBindVertexArray(0);
 }
 
 void Sphere::destroy() {
+  glDeleteBuffers(1, &m_instanceVBO);
+  glDeleteVertexArrays(1, &m_instancedVAO);
   glDeleteBuffers(1, &m_VBO);
   glDeleteBuffers(1, &m_EBO);
   glDeleteVertexArrays(1, &m_VAO);
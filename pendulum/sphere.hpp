@@ -4,20 +4,40 @@
 
 #include "abcgOpenGL.hpp"
 
+#include <cstddef>
+#include <span>
+
 #include <glm/glm.hpp>
 
+// Per-instance data of the instanced sphere path
+struct SphereInstance {
+  glm::vec4 translationScale{}; // xyz: translation, w: uniform scale
+  glm::vec4 color{};
+};
+
 class Sphere {
  public:
   void create(GLuint program);
+  // Sets up the instanced path. Must be called after create().
+  void createInstanced(GLuint program);
   void paint();
+  // Draws all instances with a single draw call
+  void paintInstanced(std::span<SphereInstance const> instances);
   void destroy();
 
  private:
+  // GL_UNSIGNED_SHORT or GL_UNSIGNED_INT, depending on m_indexSize
+  GLenum indexType() const;
+
   GLuint m_VAO{};
   GLuint m_VBO{};
   GLuint m_EBO{};
 
+  GLuint m_instancedVAO{};
+  GLuint m_instanceVBO{};
+
   int m_indicesCount{};
+  std::size_t m_indexSize{sizeof(GLuint)};
 
   GLuint m_program{};
 };
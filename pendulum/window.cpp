@@ -57,6 +57,10 @@ void Window::onCreate() {
 
   auto const assetsPath{abcg::Application::getAssetsPath()};
 
+  // Reuse the program binaries of previous runs, if supported by the driver
+  abcg::setOpenGLProgramCachePath(abcg::Application::getBasePath() +
+                                  "/shadercache");
+
   abcg::ShaderSource vertexShader;
   vertexShader.source = assetsPath + "vertex_shader.glsl";
   vertexShader.stage = abcg::ShaderStage::Vertex;
@@ -65,22 +69,51 @@ void Window::onCreate() {
   fragmentShader.source = assetsPath + "fragment_shader.glsl";
   fragmentShader.stage = abcg::ShaderStage::Fragment;
 
-  program = abcg::createOpenGLProgram({vertexShader, fragmentShader});
+  // Both programs are submitted before waiting for either, so that the driver
+  // can compile them concurrently
+  abcg::OpenGLProgramBuilder programBuilder;
+  auto programFuture{programBuilder.submit({vertexShader, fragmentShader})};
+
+  abcg::ShaderSource instancedVertexShader;
+  instancedVertexShader.source = assetsPath + "instanced_vertex_shader.glsl";
+  instancedVertexShader.stage = abcg::ShaderStage::Vertex;
+
+  abcg::ShaderSource instancedFragmentShader;
+  instancedFragmentShader.source = assetsPath + "instanced_fragment_shader.glsl";
+  instancedFragmentShader.stage = abcg::ShaderStage::Fragment;
+
+  auto instancedProgramFuture{
+      programBuilder.submit({instancedVertexShader, instancedFragmentShader})};
+
+  program = programFuture.get();
+  m_instancedProgram = instancedProgramFuture.get();
 
   // Get location of uniform variables
   modelMatrixLoc = glGetUniformLocation(program, "modelMatrix");
-  viewMatrixLoc = glGetUniformLocation(program, "viewMatrix");
-  projMatrixLoc = glGetUniformLocation(program, "projMatrix");
   colorLoc = glGetUniformLocation(program, "color");
 
+  // Both programs read the camera matrices from the same uniform buffer
+  for (auto const prog : {program, m_instancedProgram}) {
+    auto const blockIndex{glGetUniformBlockIndex(prog, "CameraBlock")};
+    glUniformBlockBinding(prog, blockIndex, cameraBlockBinding);
+  }
+
+  glGenBuffers(1, &m_cameraUBO);
+  glBindBuffer(GL_UNIFORM_BUFFER, m_cameraUBO);
+  glBufferData(GL_UNIFORM_BUFFER, sizeof(CameraBlock), nullptr,
+               GL_DYNAMIC_DRAW);
+  glBindBuffer(GL_UNIFORM_BUFFER, 0);
+  glBindBufferBase(GL_UNIFORM_BUFFER, cameraBlockBinding, m_cameraUBO);
+
   // Enable depth testing
   glEnable(GL_DEPTH_TEST);
 
   // Create the sphere
   m_sphere.create(program);
+  m_sphere.createInstanced(m_instancedProgram);
 
-  // Create the line
-  m_line.create(program);
+  // Create the line batch
+  m_lines.create(program);
 
   // Set the mouse capture state
   SDL_SetRelativeMouseMode(m_mouseCaptured ? SDL_TRUE : SDL_FALSE);
@@ -162,8 +195,10 @@ void Window::onCreate() {
   float fixedAngle = 0.0f;
 
   // Calculate initial angular velocity
-  float tanTheta = std::tan(theta);
-  angularVelocity = std::sqrt((gravity * tanTheta) / actualRopeLength); // ω in radians per second
+  angularVelocity = PendulumSystem::angularVelocity(actualRopeLength, theta);
+
+  // Create the simulated pendulums
+  resetPendulums();
 
   float r = actualRopeLength * std::sin(theta);
   float x = r * std::cos(fixedAngle);
@@ -186,27 +221,17 @@ void Window::onUpdate() {
   // Update deltaTime
   deltaTime = static_cast<float>(getDeltaTime());
 
-  // Convert theta to radians
-  float theta = glm::radians(static_cast<float>(thetaDegrees));
-
-  // Define actualRopeLength
-  actualRopeLength = static_cast<float>(ropeLength) / 100.0f; // Converts percentage to meters
-
-  // Calculate angular velocity based on rope length and theta
-  float tanTheta = std::tan(theta);
-  angularVelocity = std::sqrt((gravity * tanTheta) /
-                              actualRopeLength); // ω in radians per second
-
-  // Update the angle based on calculated angular velocity and animation speed
-  angle += angularVelocity * (static_cast<float>(animationSpeed) / 100.0f) * deltaTime;
-
-  // Keep angle within [0, 2π]
-  angle = std::fmod(angle, 2.0f * glm::pi<float>());
-
   // Handle camera input
   handleInput();
 }
 
+void Window::onFixedUpdate(double fixedDeltaTime) {
+  // Advance all pendulums using the animation speed as a time scale. This runs
+  // at a fixed rate so the simulation does not depend on the frame rate.
+  m_pendulums.update(static_cast<float>(fixedDeltaTime),
+                     static_cast<float>(animationSpeed) / 100.0f);
+}
+
 void Window::onPaint() {
   // Set the clear color to dark gray
   glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
@@ -214,6 +239,9 @@ void Window::onPaint() {
   // Clear the screen
   glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
+  // Reset the draw call counter
+  m_drawCalls = 0;
+
   glUseProgram(program);
 
   // Set up view and projection matrices
@@ -224,8 +252,12 @@ void Window::onPaint() {
   float aspect = static_cast<float>(m_viewportSize.x) / m_viewportSize.y;
   m_projMatrix = glm::perspective(glm::radians(45.0f), aspect, 0.1f, 100.0f);
 
-  glUniformMatrix4fv(viewMatrixLoc, 1, GL_FALSE, &m_viewMatrix[0][0]);
-  glUniformMatrix4fv(projMatrixLoc, 1, GL_FALSE, &m_projMatrix[0][0]);
+  // Upload the camera state once for all programs
+  static_assert(sizeof(CameraBlock) == 2 * 16 * sizeof(float));
+  CameraBlock const camera{m_viewMatrix, m_projMatrix};
+  glBindBuffer(GL_UNIFORM_BUFFER, m_cameraUBO);
+  glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(camera), &camera);
+  glBindBuffer(GL_UNIFORM_BUFFER, 0);
 
   // Render the pendulum
   renderPendulum();
@@ -248,6 +280,7 @@ void Window::onPaintUI() {
   bool thetaChanged = ImGui::SliderInt("Ângulo de Inclinação (°)", &thetaDegrees, 20, 85);
   bool ropeLengthChanged = ImGui::SliderInt("Comprimento da Corda (%)", &ropeLength, 1, 200);
   bool animationChanged = ImGui::SliderInt("Velocidade da Animação (%)", &animationSpeed, 100, 1000);
+  bool countChanged = ImGui::SliderInt("Número de Pêndulos", &pendulumCount, 1, 4096);
 
   // Add color picker for the ball
   ImGui::ColorEdit3("Cor da Esfera", &ballColor[0]);
@@ -255,12 +288,18 @@ void Window::onPaintUI() {
   // Update actualRopeLength
   actualRopeLength = static_cast<float>(ropeLength) / 100.0f; // Converts percentage to meters
 
+  if (countChanged) {
+    resetPendulums();
+  }
+
   if (ropeLengthChanged || thetaChanged || animationChanged) {
     // Recalculate angular velocity
     float theta = glm::radians(static_cast<float>(thetaDegrees));
-    float tanTheta = std::tan(theta);
 
-    angularVelocity = std::sqrt((gravity * tanTheta) / actualRopeLength); // ω in radians per second
+    angularVelocity = PendulumSystem::angularVelocity(actualRopeLength, theta); // ω in radians per second
+
+    // Update the simulated pendulums, keeping their current phases
+    m_pendulums.setParameters(actualRopeLength, theta);
 
     // Recalculate rope length and angular speed in pixels using fixed camera parameters
     glm::vec3 fixedCameraPosition{0.0f, 2.5f, 5.0f};
@@ -303,12 +342,51 @@ void Window::onPaintUI() {
   // Display the calculated angular speed in pixels/sec
   ImGui::Text("Velocidade Angular: %.2f pixels/s", m_angularSpeedInPixels);
 
+  // Compare the instanced and per-ball rendering paths
+  ImGui::Separator();
+  ImGui::Checkbox("Renderização Instanciada", &m_instancedRendering);
+  ImGui::Text("Draw calls: %d", m_drawCalls);
+  ImGui::Text("Tempo de quadro: %.3f ms", 1000.0f / ImGui::GetIO().Framerate);
+  ImGui::Text("Tempo de CPU das esferas: %.3f ms", m_bobsCPUTime);
+
+  auto windowSettings{getWindowSettings()};
+  if (ImGui::Checkbox("Mostrar Profiler", &windowSettings.showProfiler)) {
+    setWindowSettings(windowSettings);
+  }
+
+#if !defined(__EMSCRIPTEN__)
+  // Record a Chrome trace (open it in chrome://tracing or ui.perfetto.dev)
+  if (abcg::TraceRecorder::isRecording()) {
+    if (ImGui::Button("Parar e Salvar Trace")) {
+      abcg::TraceRecorder::stop();
+      abcg::TraceRecorder::save("pendulum_trace.json");
+    }
+  } else if (ImGui::Button("Gravar Trace")) {
+    abcg::TraceRecorder::start();
+  }
+
+  // Record a 10-second video at a fixed resolution and frame rate. The frames
+  // are rendered offscreen, so this may run faster than real time.
+  if (isCapturing()) {
+    if (ImGui::Button("Parar Gravação")) {
+      stopCapture();
+    }
+  } else if (ImGui::Button("Gravar Vídeo (pendulum.y4m)")) {
+    startCapture({.path = "pendulum.y4m",
+                  .format = abcg::OpenGLCaptureFormat::Y4M,
+                  .width = 1920,
+                  .height = 1080,
+                  .frameRate = 60,
+                  .frameCount = 600});
+  }
+#endif
+
   ImGui::End();
 }
 
 void Window::onDestroy() {
   m_sphere.destroy();
-  m_line.destroy();
+  m_lines.destroy();
 
   // Delete ground plane buffers
   glDeleteBuffers(1, &groundVBO);
@@ -318,6 +396,8 @@ void Window::onDestroy() {
   // Release the mouse cursor
   SDL_SetRelativeMouseMode(SDL_FALSE);
 
+  glDeleteBuffers(1, &m_cameraUBO);
+  glDeleteProgram(m_instancedProgram);
   glDeleteProgram(program);
 }
 
@@ -414,59 +494,105 @@ void Window::renderGround() {
 
   // Draw the ground plane using element array
   glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, nullptr);
+  ++m_drawCalls;
 
   // Unbind the VAO
   glBindVertexArray(0);
 }
 
+void Window::resetPendulums() {
+  float theta = glm::radians(static_cast<float>(thetaDegrees));
+
+  // Spread the pendulums evenly around the pole
+  m_pendulums.clear();
+  m_pendulums.reserve(static_cast<std::size_t>(pendulumCount));
+  for (int index = 0; index < pendulumCount; ++index) {
+    float phase = 2.0f * glm::pi<float>() * static_cast<float>(index) /
+                  static_cast<float>(pendulumCount);
+    m_pendulums.add(actualRopeLength, theta, phase);
+  }
+}
+
 void Window::renderPendulum() {
+  ABCG_PROFILE_ZONE("renderPendulum");
+
   // Define the height of the pole
   float poleHeight = 2.0f;
 
-  // Convert theta to radians
-  float theta = glm::radians(static_cast<float>(thetaDegrees));
+  glm::vec3 pivot(0.0f, poleHeight, 0.0f);
+
+  // Compute the positions of all balls at once, extrapolated by the time
+  // accumulated since the last fixed update so that motion stays smooth
+  auto const timeOffset{static_cast<float>(getFixedUpdateAlpha() *
+                                           getFixedDeltaTime()) *
+                        static_cast<float>(animationSpeed) / 100.0f};
+  m_bobPositions.resize(m_pendulums.size());
+  m_pendulums.computeBobPositions(pivot, m_bobPositions, timeOffset);
+
+  // Render the balls, timing how long the CPU takes to submit them
+  abcg::Timer bobsTimer;
+  if (m_instancedRendering) {
+    renderBobsInstanced();
+  } else {
+    renderBobs();
+  }
+  auto const bobsTime{static_cast<float>(bobsTimer.elapsed()) * 1000.0f};
+  m_bobsCPUTime = glm::mix(m_bobsCPUTime, bobsTime, 0.05f);
 
-  // Define actualRopeLength
-  actualRopeLength = static_cast<float>(ropeLength) / 100.0f;
+  // Reset the model matrix for the ropes and pole
+  glm::mat4 modelMatrix = glm::mat4(1.0f);
+  glUniformMatrix4fv(modelMatrixLoc, 1, GL_FALSE, &modelMatrix[0][0]);
 
-  // Compute the horizontal radius (r)
-  float r = actualRopeLength * std::sin(theta);
+  // Set the color to white for the ropes and pole
+  glUniform4f(colorLoc, 1.0f, 1.0f, 1.0f, 1.0f);
 
-  // Compute the position of the ball
-  float y = poleHeight - actualRopeLength *
-                             std::cos(theta); // Vertical position of the ball
-  float x = r * std::cos(angle);              // Horizontal position along X
-  float z = r * std::sin(angle);              // Horizontal position along Z
+  // Set the line width
+  glLineWidth(2.0f);
 
-  // Model matrix for the ball
-  glm::mat4 modelMatrix = glm::translate(glm::mat4(1.0f), glm::vec3(x, y, z));
-  modelMatrix =
-      glm::scale(modelMatrix, glm::vec3(0.1f)); // Scale down the sphere
-  glUniformMatrix4fv(modelMatrixLoc, 1, GL_FALSE, &modelMatrix[0][0]);
+  // Collect the ropes (from top of the pole to each ball) and the pole, then
+  // render all of them at once
+  m_lines.clear();
+  for (auto const &position : m_bobPositions) {
+    m_lines.add(pivot, position);
+  }
+  glm::vec3 poleStart(0.0f, 0.0f, 0.0f);
+  m_lines.add(poleStart, pivot);
+
+  m_lines.paint();
+  ++m_drawCalls;
+}
 
+void Window::renderBobs() {
   // Set the color to the selected ball color
   glUniform4f(colorLoc, ballColor.r, ballColor.g, ballColor.b, 1.0f);
 
-  // Render the ball
-  m_sphere.paint();
+  // One draw call per ball
+  for (auto const &position : m_bobPositions) {
+    // Model matrix for the ball
+    glm::mat4 modelMatrix = glm::translate(glm::mat4(1.0f), position);
+    modelMatrix =
+        glm::scale(modelMatrix, glm::vec3(0.1f)); // Scale down the sphere
+    glUniformMatrix4fv(modelMatrixLoc, 1, GL_FALSE, &modelMatrix[0][0]);
 
-  // Reset the model matrix for the rope and pole
-  modelMatrix = glm::mat4(1.0f);
-  glUniformMatrix4fv(modelMatrixLoc, 1, GL_FALSE, &modelMatrix[0][0]);
+    m_sphere.paint();
+    ++m_drawCalls;
+  }
+}
 
-  // Set the color to white for the rope and pole
-  glUniform4f(colorLoc, 1.0f, 1.0f, 1.0f, 1.0f);
+void Window::renderBobsInstanced() {
+  // Pack the per-ball data
+  m_sphereInstances.resize(m_bobPositions.size());
+  for (std::size_t index = 0; index < m_bobPositions.size(); ++index) {
+    m_sphereInstances[index].translationScale =
+        glm::vec4(m_bobPositions[index], 0.1f);
+    m_sphereInstances[index].color = glm::vec4(ballColor, 1.0f);
+  }
 
-  // Set the line width
-  glLineWidth(2.0f);
+  // Draw all balls with a single draw call
+  glUseProgram(m_instancedProgram);
 
-  // Render the rope (from top of the pole to the ball)
-  glm::vec3 ropeStart(0.0f, poleHeight, 0.0f);
-  glm::vec3 ropeEnd(x, y, z);
-  m_line.paint(ropeStart, ropeEnd);
+  m_sphere.paintInstanced(m_sphereInstances);
+  ++m_drawCalls;
 
-  // Render the pole
-  glm::vec3 poleStart(0.0f, 0.0f, 0.0f);
-  glm::vec3 poleEnd(0.0f, poleHeight, 0.0f);
-  m_line.paint(poleStart, poleEnd);
-}
\ No newline at end of file
+  glUseProgram(program);
+}
@@ -8,18 +8,28 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
-#include "line.hpp"
+#include "linebatch.hpp"
+#include "pendulumsystem.hpp"
 #include "sphere.hpp"
 
-const float gravity{9.81f};
 const float pivotHeight{2.0f};
 
+// Binding point of the CameraBlock uniform block
+const GLuint cameraBlockBinding{0};
+
+// Layout of the CameraBlock uniform block (std140)
+struct CameraBlock {
+  glm::mat4 viewMatrix;
+  glm::mat4 projMatrix;
+};
+
 class Window : public abcg::OpenGLWindow {
 protected:
   void onCreate() override;
   void onPaint() override;
   void onPaintUI() override;
   void onUpdate() override;
+  void onFixedUpdate(double fixedDeltaTime) override;
   void onDestroy() override;
   void onEvent(SDL_Event const &event) override;
   void onResize(glm::ivec2 const &size) override;
@@ -29,9 +39,11 @@ private:
   int ropeLength{100};
   int animationSpeed{100};
   int thetaDegrees{30}; // Inclination angle in degrees
+  int pendulumCount{1};
 
   // Simulation variables
-  float angle{0.0f};
+  PendulumSystem m_pendulums;
+  std::vector<glm::vec3> m_bobPositions;
   float deltaTime{0.0f};
   float angularVelocity{0.0f};
   float actualRopeLength{};
@@ -50,18 +62,28 @@ private:
   // OpenGL variables
   GLuint program{};
   GLint modelMatrixLoc{};
-  GLint viewMatrixLoc{};
-  GLint projMatrixLoc{};
   GLint colorLoc{};
 
+  // Instanced sphere program
+  GLuint m_instancedProgram{};
+
+  // Uniform buffer with the view and projection matrices (CameraBlock)
+  GLuint m_cameraUBO{};
+
   // Ground plane variables
   GLuint groundVAO{};
   GLuint groundVBO{};
   GLuint groundEBO{};
 
-  // Sphere & Line
+  // Sphere & lines
   Sphere m_sphere;
-  Line m_line;
+  LineBatch m_lines;
+  std::vector<SphereInstance> m_sphereInstances;
+
+  // Rendering statistics
+  bool m_instancedRendering{true};
+  int m_drawCalls{};
+  float m_bobsCPUTime{}; // Smoothed time to submit the balls (ms)
 
   // Ground plane color
   glm::vec3 groundColor{0.5f, 0.25f, 0.0f}; // Brown color
@@ -87,8 +109,11 @@ private:
   // Helper methods
   void handleInput();
   void renderPendulum();
+  void renderBobs();
+  void renderBobsInstanced();
   void renderGround();
   void calculateMeasurements();
+  void resetPendulums();
 
   // Function declarations
   float calculateRopeLengthInPixels(const glm::vec3 &ropeStart, const glm::vec3 &ropeEnd,
@@ -0,0 +1,79 @@
+// bench.hpp
+//
+// Helpers shared by the benchmarks: median timing of repeated runs and parsing
+// of command-line options.
+#ifndef TOOLS_BENCH_HPP_
+#define TOOLS_BENCH_HPP_
+
+#include <algorithm>
+#include <chrono>
+#include <concepts>
+#include <functional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <cppitertools/itertools.hpp>
+#include <fmt/core.h>
+#include <gsl/gsl>
+
+#include "abcgException.hpp"
+
+namespace bench {
+// Returns the median time of `repeat` calls of the function, in milliseconds.
+// The function may take the index of the call as argument.
+template <typename Function>
+double measure(std::size_t repeat, Function &&function) {
+  std::vector<double> times;
+  times.reserve(repeat);
+  for (auto const index : iter::range(std::max<std::size_t>(repeat, 1))) {
+    auto const start{std::chrono::steady_clock::now()};
+    if constexpr (std::invocable<Function, std::size_t>) {
+      function(index);
+    } else {
+      function();
+    }
+    std::chrono::duration<double, std::milli> const elapsed{
+        std::chrono::steady_clock::now() - start};
+    times.push_back(elapsed.count());
+  }
+  auto const median{times.begin() + gsl::narrow<long>(times.size() / 2)};
+  std::ranges::nth_element(times, median);
+  return *median;
+}
+
+// Handles the option `name` with its value, or a positional argument if `name`
+// is empty. Returns false if the option is unknown.
+using OptionHandler =
+    std::function<bool(std::string_view name, std::string const &value)>;
+
+// Parses arguments of the form `--name value` and positional arguments.
+// `--repeat N` is handled here and sets `repeat` to at least 1.
+//
+// Throws abcg::RuntimeError on unknown options or missing values.
+inline void parseOptions(int argc, char **argv, std::size_t &repeat,
+                         OptionHandler const &handler = {}) {
+  std::span const args{argv, static_cast<std::size_t>(argc)};
+  for (std::size_t index = 1; index < args.size(); ++index) {
+    std::string_view const arg{args[index]};
+    if (!arg.starts_with("--")) {
+      if (!handler || !handler({}, std::string{arg})) {
+        throw abcg::RuntimeError(fmt::format("Unexpected argument {}", arg));
+      }
+      continue;
+    }
+    if (index + 1 == args.size()) {
+      throw abcg::RuntimeError(fmt::format("Missing value for {}", arg));
+    }
+    std::string const value{args[++index]};
+    if (arg == "--repeat") {
+      repeat = std::max<std::size_t>(std::stoul(value), 1);
+    } else if (!handler || !handler(arg.substr(2), value)) {
+      throw abcg::RuntimeError(fmt::format("Unknown option {}", arg));
+    }
+  }
+}
+} // namespace bench
+
+#endif
@@ -0,0 +1,199 @@
+// glshaderbench.cpp
+//
+// Startup-time benchmark of the OpenGL program binary cache. Builds a program
+// with abcg::createOpenGLProgram in three ways:
+//
+// - Uncached: the program binary cache is disabled.
+// - Cold: the cache directory is cleared first, so the program is compiled,
+//   linked and its binary written to the cache.
+// - Warm: the same program is built again and loaded from the cache.
+//
+// Every repetition appends a unique comment to the sources. This changes the
+// cache key and defeats the shader caches of the driver, so the uncached and
+// cold times include a full compilation.
+//
+// If no shaders are given, a vertex and fragment shader with per-pixel
+// lighting are used.
+//
+// Usage: abcg-glshaderbench [--repeat N] [--vertex FILE --fragment FILE]
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "abcg.hpp"
+#include "abcgOpenGL.hpp"
+#include "bench.hpp"
+
+namespace {
+constexpr std::string_view defaultVertexShader{R"glsl(#version 300 es
+layout(location = 0) in vec3 inPosition;
+layout(location = 1) in vec3 inNormal;
+layout(location = 2) in vec2 inTexCoord;
+
+uniform mat4 modelMatrix;
+uniform mat4 viewMatrix;
+uniform mat4 projMatrix;
+uniform mat3 normalMatrix;
+
+out vec3 fragPosition;
+out vec3 fragNormal;
+out vec2 fragTexCoord;
+
+void main() {
+  vec4 position = viewMatrix * modelMatrix * vec4(inPosition, 1.0);
+  fragPosition = position.xyz;
+  fragNormal = normalize(normalMatrix * inNormal);
+  fragTexCoord = inTexCoord;
+  gl_Position = projMatrix * position;
+}
+)glsl"};
+
+constexpr std::string_view defaultFragmentShader{R"glsl(#version 300 es
+precision mediump float;
+
+in vec3 fragPosition;
+in vec3 fragNormal;
+in vec2 fragTexCoord;
+
+uniform sampler2D diffuseTex;
+uniform vec4 lightDirection;
+uniform vec4 Ia, Id, Is;
+uniform vec4 Ka, Kd, Ks;
+uniform float shininess;
+
+out vec4 outColor;
+
+void main() {
+  vec3 N = normalize(fragNormal);
+  vec3 L = normalize(-lightDirection.xyz);
+  vec3 V = normalize(-fragPosition);
+  vec3 H = normalize(L + V);
+  vec4 map = texture(diffuseTex, fragTexCoord);
+  float lambertian = max(dot(N, L), 0.0);
+  float specular =
+      lambertian > 0.0 ? pow(max(dot(H, N), 0.0), shininess) : 0.0;
+  outColor = Ka * Ia * map + lambertian * Kd * Id * map + specular * Ks * Is;
+}
+)glsl"};
+
+[[nodiscard]] std::string readFile(std::string const &path) {
+  std::ifstream stream(path);
+  if (!stream) {
+    throw abcg::RuntimeError(fmt::format("Failed to read {}", path));
+  }
+  std::stringstream buffer;
+  buffer << stream.rdbuf();
+  return buffer.str();
+}
+
+class BenchWindow : public abcg::OpenGLWindow {
+public:
+  BenchWindow(std::size_t repeat, std::string vertexShader,
+              std::string fragmentShader)
+      : m_repeat{repeat}, m_vertexShader{std::move(vertexShader)},
+        m_fragmentShader{std::move(fragmentShader)} {}
+
+protected:
+  void onCreate() override {
+    auto const cachePath{std::filesystem::temp_directory_path() /
+                         "abcg-glshaderbench"};
+    std::filesystem::remove_all(cachePath);
+
+    // A unique suffix per run and repetition keeps the driver from reusing
+    // programs compiled by previous runs of the benchmark
+    auto const runId{
+        std::chrono::steady_clock::now().time_since_epoch().count()};
+    auto const sources{[&](std::string_view tag, std::size_t index) {
+      auto const comment{fmt::format("\n// {} {} {}\n", tag, runId, index)};
+      return std::vector<abcg::ShaderSource>{
+          {.source = m_vertexShader + comment,
+           .stage = abcg::ShaderStage::Vertex},
+          {.source = m_fragmentShader + comment,
+           .stage = abcg::ShaderStage::Fragment}};
+    }};
+    auto const build{[](std::vector<abcg::ShaderSource> const &program) {
+      auto const handle{abcg::createOpenGLProgram(program)};
+      abcg::glDeleteProgram(handle);
+    }};
+
+    abcg::setOpenGLProgramCachePath({});
+    auto const uncachedTime{bench::measure(m_repeat, [&](std::size_t index) {
+      build(sources("uncached", index));
+    })};
+
+    abcg::setOpenGLProgramCachePath(cachePath.string());
+    auto const coldTime{bench::measure(m_repeat, [&](std::size_t index) {
+      std::filesystem::remove_all(cachePath);
+      build(sources("cached", index));
+    })};
+    auto const cached{std::filesystem::exists(cachePath) &&
+                      !std::filesystem::is_empty(cachePath)};
+
+    // The cache directory holds the binary of the last cold repetition
+    auto const warmTime{bench::measure(m_repeat, [&](std::size_t) {
+      build(sources("cached", m_repeat - 1));
+    })};
+
+    abcg::setOpenGLProgramCachePath({});
+    std::filesystem::remove_all(cachePath);
+
+    fmt::print("{}\n", reinterpret_cast<char const *>(
+                           abcg::glGetString(GL_RENDERER)));
+    if (!cached) {
+      fmt::print("  Program binaries are not supported by this driver\n");
+    }
+    fmt::print("  Uncached.....: {:>9.2f} ms\n", uncachedTime);
+    fmt::print("  Cold cache...: {:>9.2f} ms\n", coldTime);
+    fmt::print("  Warm cache...: {:>9.2f} ms ({:.1f}x faster)\n", warmTime,
+               uncachedTime / warmTime);
+
+    SDL_Event quit{};
+    quit.type = SDL_QUIT;
+    SDL_PushEvent(&quit);
+  }
+
+private:
+  std::size_t m_repeat{};
+  std::string m_vertexShader;
+  std::string m_fragmentShader;
+};
+} // namespace
+
+int main(int argc, char **argv) {
+  try {
+    abcg::Application app(argc, argv);
+
+    std::size_t repeat{5};
+    std::string vertexShader{defaultVertexShader};
+    std::string fragmentShader{defaultFragmentShader};
+    bench::parseOptions(argc, argv, repeat,
+                        [&](std::string_view name, std::string const &value) {
+                          if (name == "vertex") {
+                            vertexShader = readFile(value);
+                          } else if (name == "fragment") {
+                            fragmentShader = readFile(value);
+                          } else {
+                            return false;
+                          }
+                          return true;
+                        });
+
+    BenchWindow window{repeat, std::move(vertexShader),
+                       std::move(fragmentShader)};
+    window.setWindowSettings({.width = 320,
+                              .height = 240,
+                              .showFPS = false,
+                              .showFullscreenButton = false,
+                              .title = "abcg-glshaderbench"});
+    app.run(window);
+  } catch (std::exception const &e) {
+    fmt::print("Exception: {}\n", e.what());
+    return -1;
+  }
+  return 0;
+}
@@ -0,0 +1,128 @@
+// imagebench.cpp
+//
+// Micro-benchmark of the image flip functions of abcgImage. Times horizontal
+// and vertical flips of 4K and 8K RGB and RGBA images with the previous
+// per-pixel implementation (as a reference), with the current kernels on one
+// thread, and with the current kernels on all hardware threads.
+//
+// Usage: abcg-imagebench [--repeat N]
+#include <algorithm>
+#include <array>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <cppitertools/itertools.hpp>
+#include <gsl/gsl>
+
+#include "abcgException.hpp"
+#include "abcgExternal.hpp"
+#include "abcgImage.hpp"
+#include "bench.hpp"
+
+namespace {
+// Previous implementation, kept as a reference: copies one pixel at a time
+// into a temporary row
+void referenceFlipHorizontally(SDL_Surface &surface) {
+  auto const bytesPerPixel{gsl::narrow<int>(surface.format->BytesPerPixel)};
+  auto const widthInBytes{gsl::narrow<std::size_t>(surface.w * bytesPerPixel)};
+  auto const pitch{gsl::narrow<std::size_t>(surface.pitch)};
+  auto *const pixels{static_cast<std::byte *>(surface.pixels)};
+  std::vector<std::byte> pixelRow(widthInBytes);
+
+  for (auto const rowIndex : iter::range(gsl::narrow<std::size_t>(surface.h))) {
+    auto *const row{pixels + rowIndex * pitch};
+    auto *source{row + widthInBytes};
+    auto destination{pixelRow.begin()};
+    for ([[maybe_unused]] auto const pixelIndex : iter::range(surface.w)) {
+      source -= bytesPerPixel;
+      std::copy(source, source + bytesPerPixel, destination);
+      destination += bytesPerPixel;
+    }
+    std::copy(pixelRow.begin(), pixelRow.end(), row);
+  }
+}
+
+// Previous implementation, kept as a reference: three copies per row pair
+// through a temporary row
+void referenceFlipVertically(SDL_Surface &surface) {
+  auto const widthInBytes{gsl::narrow<std::size_t>(
+      surface.w * surface.format->BytesPerPixel)};
+  auto const pitch{gsl::narrow<std::size_t>(surface.pitch)};
+  auto const height{gsl::narrow<std::size_t>(surface.h)};
+  auto *const pixels{static_cast<std::byte *>(surface.pixels)};
+  std::vector<std::byte> pixelRow(widthInBytes);
+
+  for (auto const rowIndex : iter::range(height / 2)) {
+    auto *const top{pixels + rowIndex * pitch};
+    auto *const bottom{pixels + (height - rowIndex - 1) * pitch};
+    std::copy(top, top + widthInBytes, pixelRow.begin());
+    std::copy(bottom, bottom + widthInBytes, top);
+    std::copy(pixelRow.begin(), pixelRow.end(), bottom);
+  }
+}
+} // namespace
+
+int main(int argc, char **argv) {
+  try {
+    std::size_t repeat{11};
+    bench::parseOptions(argc, argv, repeat);
+
+    auto const threads{std::max(std::thread::hardware_concurrency(), 1U)};
+
+    struct Size {
+      std::string_view name;
+      int width;
+      int height;
+    };
+    std::array const sizes{Size{"4K", 3840, 2160}, Size{"8K", 7680, 4320}};
+    std::array const formats{SDL_PIXELFORMAT_RGB24, SDL_PIXELFORMAT_RGBA32};
+
+    fmt::print("{:<10} {:<10} {:>12} {:>12} {:>12}\n", "image", "flip",
+               "reference", "1 thread", fmt::format("{} threads", threads));
+
+    for (auto const &size : sizes) {
+      for (auto const format : formats) {
+        auto *const surface{SDL_CreateRGBSurfaceWithFormat(
+            0, size.width, size.height, 0, format)};
+        if (surface == nullptr) {
+          throw abcg::RuntimeError(
+              fmt::format("Failed to create surface: {}", SDL_GetError()));
+        }
+        auto const name{fmt::format("{} {}", size.name,
+                                    surface->format->BytesPerPixel == 3
+                                        ? "RGB"
+                                        : "RGBA")};
+
+        auto const print{[&](std::string_view flip, double reference,
+                             double single, double multi) {
+          fmt::print("{:<10} {:<10} {:>9.2f} ms {:>9.2f} ms {:>9.2f} ms\n",
+                     name, flip, reference, single, multi);
+        }};
+
+        print("horizontal", bench::measure(repeat, [&] {
+                referenceFlipHorizontally(*surface);
+              }),
+              bench::measure(repeat,
+                             [&] { abcg::flipHorizontally(*surface); }),
+              bench::measure(repeat, [&] {
+                abcg::flipHorizontally(*surface, threads);
+              }));
+        print("vertical", bench::measure(repeat, [&] {
+                referenceFlipVertically(*surface);
+              }),
+              bench::measure(repeat, [&] { abcg::flipVertically(*surface); }),
+              bench::measure(repeat, [&] {
+                abcg::flipVertically(*surface, threads);
+              }));
+
+        SDL_FreeSurface(surface);
+      }
+    }
+  } catch (std::exception const &e) {
+    fmt::print("Exception: {}\n", e.what());
+    return -1;
+  }
+  return 0;
+}
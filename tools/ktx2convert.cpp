@@ -0,0 +1,659 @@
+// ktx2convert.cpp
+//
+// Offline converter from PNG/JPEG images to KTX2 textures that can be loaded
+// by abcg::loadOpenGLTexture, abcg::OpenGLTextureLoader and
+// abcg::VulkanImage. The mip chain is built in linear space and each level is
+// encoded to a GPU block-compressed format, so the loaders only map the file
+// and upload it.
+//
+// Usage: abcg-ktx2convert [options] input.png output.ktx2
+//   --format F     rgba8, bc1, bc3 (default: bc3 if the image has
+//                  transparent texels, bc1 otherwise), bc4 (red channel) or
+//                  bc5 (red and green channels, e.g., for normal maps)
+//   --linear       Store the color channels as linear instead of sRGB
+//                  (bc4 and bc5 are always linear)
+//   --no-mipmaps   Store only the base level
+//   --flip-y       Store the image upside down (bottom row first), as PNG and
+//                  JPEG images loaded with flipUpsideDown = true
+//
+// ETC2 and ASTC files made by other tools (e.g., toktx) can also be loaded,
+// as long as they are not supercompressed.
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <numeric>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <cppitertools/itertools.hpp>
+#include <gsl/gsl>
+
+#include "abcgException.hpp"
+#include "abcgExternal.hpp"
+#include "abcgImage.hpp"
+#include "abcgKTX2.hpp"
+
+namespace {
+enum class Format { RGBA8, BC1, BC3, BC4, BC5 };
+
+struct Options {
+  std::string input;
+  std::string output;
+  std::optional<Format> format;
+  bool sRGB{true};
+  bool mipmaps{true};
+  bool flipY{};
+};
+
+// An image with 4 bytes per texel, rows tightly packed
+struct Image {
+  std::uint32_t width{};
+  std::uint32_t height{};
+  std::vector<std::uint8_t> texels;
+
+  [[nodiscard]] std::uint8_t const *at(std::uint32_t x,
+                                       std::uint32_t y) const {
+    return &texels.at((std::size_t{y} * width + x) * 4);
+  }
+};
+
+// Block of 4x4 texels, 4 channels each
+using Block = std::array<std::array<std::uint8_t, 4>, 16>;
+
+float toLinear(std::uint8_t value) {
+  auto const channel{static_cast<float>(value) / 255.0f};
+  return channel <= 0.04045f ? channel / 12.92f
+                             : std::pow((channel + 0.055f) / 1.055f, 2.4f);
+}
+
+std::uint8_t fromLinear(float value) {
+  auto const channel{value <= 0.0031308f
+                         ? value * 12.92f
+                         : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f};
+  return static_cast<std::uint8_t>(
+      std::lround(std::clamp(channel, 0.0f, 1.0f) * 255.0f));
+}
+
+// Halves the image with a box filter. Color channels are averaged in linear
+// space if they are sRGB-encoded.
+Image downsample(Image const &image, bool sRGB) {
+  std::array<float, 256> linear{};
+  for (auto const value : iter::range(256)) {
+    linear.at(gsl::narrow_cast<std::size_t>(value)) =
+        sRGB ? toLinear(gsl::narrow_cast<std::uint8_t>(value))
+             : static_cast<float>(value) / 255.0f;
+  }
+
+  auto const width{std::max(image.width / 2, 1U)};
+  auto const height{std::max(image.height / 2, 1U)};
+  Image result{.width = width,
+               .height = height,
+               .texels = std::vector<std::uint8_t>(std::size_t{width} *
+                                                   height * 4)};
+
+  for (auto const y : iter::range(result.height)) {
+    for (auto const x : iter::range(result.width)) {
+      // Odd sizes repeat the last row or column
+      auto const x0{std::min(x * 2, image.width - 1)};
+      auto const x1{std::min(x * 2 + 1, image.width - 1)};
+      auto const y0{std::min(y * 2, image.height - 1)};
+      auto const y1{std::min(y * 2 + 1, image.height - 1)};
+      std::array const sources{image.at(x0, y0), image.at(x1, y0),
+                               image.at(x0, y1), image.at(x1, y1)};
+
+      auto *const destination{
+          &result.texels.at((std::size_t{y} * result.width + x) * 4)};
+      for (auto const channel : iter::range(4)) {
+        if (channel < 3) {
+          auto const sum{std::accumulate(
+              sources.begin(), sources.end(), 0.0f,
+              [&](float total, std::uint8_t const *source) {
+                return total + linear.at(source[channel]);
+              })};
+          destination[channel] =
+              sRGB ? fromLinear(sum / 4.0f)
+                   : static_cast<std::uint8_t>(
+                         std::lround(sum / 4.0f * 255.0f));
+        } else {
+          auto const sum{std::accumulate(
+              sources.begin(), sources.end(), 0,
+              [&](int total, std::uint8_t const *source) {
+                return total + source[channel];
+              })};
+          destination[channel] = static_cast<std::uint8_t>((sum + 2) / 4);
+        }
+      }
+    }
+  }
+  return result;
+}
+
+// Reads a 4x4 block. Texels past the edges repeat the last row or column.
+Block readBlock(Image const &image, std::uint32_t blockX,
+                std::uint32_t blockY) {
+  Block block{};
+  for (auto const index : iter::range(16U)) {
+    auto const x{std::min(blockX * 4 + index % 4, image.width - 1)};
+    auto const y{std::min(blockY * 4 + index / 4, image.height - 1)};
+    std::copy_n(image.at(x, y), 4, block.at(index).begin());
+  }
+  return block;
+}
+
+void append(std::vector<std::uint8_t> &output, std::uint64_t value,
+            std::size_t size) {
+  for (auto const byte : iter::range(size)) {
+    output.push_back(static_cast<std::uint8_t>(value >> (byte * 8)));
+  }
+}
+
+std::uint16_t to565(std::array<float, 3> const &color) {
+  auto const quantize{[](float value, int max) {
+    return static_cast<std::uint16_t>(
+        std::lround(std::clamp(value, 0.0f, 255.0f) * max / 255.0f));
+  }};
+  return gsl::narrow_cast<std::uint16_t>(quantize(color[0], 31) << 11 |
+                                         quantize(color[1], 63) << 5 |
+                                         quantize(color[2], 31));
+}
+
+std::array<int, 3> from565(std::uint16_t color) {
+  auto const red{(color >> 11) & 31};
+  auto const green{(color >> 5) & 63};
+  auto const blue{color & 31};
+  return {(red << 3) | (red >> 2), (green << 2) | (green >> 4),
+          (blue << 3) | (blue >> 2)};
+}
+
+// BC1 color block. The endpoints are the extremes of the texels projected on
+// the principal axis of their colors.
+void encodeColor(Block const &block, std::vector<std::uint8_t> &output) {
+  std::array<float, 3> mean{};
+  for (auto const &texel : block) {
+    for (auto const channel : iter::range(3)) {
+      mean.at(channel) += static_cast<float>(texel.at(channel)) / 16.0f;
+    }
+  }
+
+  std::array<float, 6> covariance{}; // rr, rg, rb, gg, gb, bb
+  for (auto const &texel : block) {
+    std::array<float, 3> delta{};
+    for (auto const channel : iter::range(3)) {
+      delta.at(channel) =
+          static_cast<float>(texel.at(channel)) - mean.at(channel);
+    }
+    covariance[0] += delta[0] * delta[0];
+    covariance[1] += delta[0] * delta[1];
+    covariance[2] += delta[0] * delta[2];
+    covariance[3] += delta[1] * delta[1];
+    covariance[4] += delta[1] * delta[2];
+    covariance[5] += delta[2] * delta[2];
+  }
+
+  // Power iteration
+  std::array<float, 3> axis{1.0f, 1.0f, 1.0f};
+  for ([[maybe_unused]] auto const iteration : iter::range(8)) {
+    std::array const next{
+        covariance[0] * axis[0] + covariance[1] * axis[1] +
+            covariance[2] * axis[2],
+        covariance[1] * axis[0] + covariance[3] * axis[1] +
+            covariance[4] * axis[2],
+        covariance[2] * axis[0] + covariance[4] * axis[1] +
+            covariance[5] * axis[2]};
+    auto const length{std::max({std::abs(next[0]), std::abs(next[1]),
+                                std::abs(next[2])})};
+    if (length < 1e-6f)
+      break;
+    axis = {next[0] / length, next[1] / length, next[2] / length};
+  }
+
+  auto minProjection{std::numeric_limits<float>::max()};
+  auto maxProjection{std::numeric_limits<float>::lowest()};
+  for (auto const &texel : block) {
+    auto projection{0.0f};
+    for (auto const channel : iter::range(3)) {
+      projection += (static_cast<float>(texel.at(channel)) - mean.at(channel)) *
+                    axis.at(channel);
+    }
+    minProjection = std::min(minProjection, projection);
+    maxProjection = std::max(maxProjection, projection);
+  }
+
+  auto const axisLength{axis[0] * axis[0] + axis[1] * axis[1] +
+                        axis[2] * axis[2]};
+  std::array<float, 3> low{};
+  std::array<float, 3> high{};
+  for (auto const channel : iter::range(3)) {
+    auto const scale{axisLength > 0.0f ? axis.at(channel) / axisLength : 0.0f};
+    low.at(channel) = mean.at(channel) + minProjection * scale;
+    high.at(channel) = mean.at(channel) + maxProjection * scale;
+  }
+
+  auto color0{to565(high)};
+  auto color1{to565(low)};
+  if (color0 < color1) {
+    std::swap(color0, color1);
+  }
+
+  std::uint32_t indices{};
+  if (color0 != color1) {
+    // Four-color mode: color0, color1, 2/3 color0 + 1/3 color1, and 1/3
+    // color0 + 2/3 color1
+    auto const endpoint0{from565(color0)};
+    auto const endpoint1{from565(color1)};
+    std::array<std::array<int, 3>, 4> palette{endpoint0, endpoint1};
+    for (auto const channel : iter::range(3)) {
+      palette[2].at(channel) =
+          (2 * endpoint0.at(channel) + endpoint1.at(channel)) / 3;
+      palette[3].at(channel) =
+          (endpoint0.at(channel) + 2 * endpoint1.at(channel)) / 3;
+    }
+
+    for (auto &&[index, texel] : iter::enumerate(block)) {
+      auto best{0U};
+      auto bestDistance{std::numeric_limits<int>::max()};
+      for (auto const entry : iter::range(4U)) {
+        auto distance{0};
+        for (auto const channel : iter::range(3)) {
+          auto const delta{texel.at(channel) - palette.at(entry).at(channel)};
+          distance += delta * delta;
+        }
+        if (distance < bestDistance) {
+          bestDistance = distance;
+          best = entry;
+        }
+      }
+      indices |= best << (index * 2);
+    }
+  }
+
+  append(output, color0, 2);
+  append(output, color1, 2);
+  append(output, indices, 4);
+}
+
+// BC4 block of one channel, in the eight-value mode
+void encodeChannel(Block const &block, std::size_t channel,
+                   std::vector<std::uint8_t> &output) {
+  auto const [minTexel, maxTexel]{std::ranges::minmax_element(
+      block, {}, [=](auto const &texel) { return texel.at(channel); })};
+  int const value0{maxTexel->at(channel)};
+  int const value1{minTexel->at(channel)};
+
+  std::uint64_t indices{};
+  if (value0 != value1) {
+    // Palette: value0, value1, then 6 values interpolated from value0 to
+    // value1
+    std::array<int, 8> palette{value0, value1};
+    for (auto const index : iter::range(1, 7)) {
+      palette.at(gsl::narrow_cast<std::size_t>(index + 1)) =
+          ((7 - index) * value0 + index * value1) / 7;
+    }
+
+    for (auto &&[index, texel] : iter::enumerate(block)) {
+      auto const value{static_cast<int>(texel.at(channel))};
+      auto const best{std::ranges::min_element(palette, {}, [=](int entry) {
+        return std::abs(entry - value);
+      })};
+      indices |= static_cast<std::uint64_t>(best - palette.begin())
+                 << (index * 3);
+    }
+  }
+
+  append(output, static_cast<std::uint64_t>(value0), 1);
+  append(output, static_cast<std::uint64_t>(value1), 1);
+  append(output, indices, 6);
+}
+
+std::vector<std::uint8_t> encode(Image const &image, Format format) {
+  std::vector<std::uint8_t> output;
+  if (format == Format::RGBA8) {
+    return image.texels;
+  }
+
+  auto const blocksX{(image.width + 3) / 4};
+  auto const blocksY{(image.height + 3) / 4};
+  for (auto const blockY : iter::range(blocksY)) {
+    for (auto const blockX : iter::range(blocksX)) {
+      auto const block{readBlock(image, blockX, blockY)};
+      switch (format) {
+      case Format::BC1:
+        encodeColor(block, output);
+        break;
+      case Format::BC3:
+        encodeChannel(block, 3, output);
+        encodeColor(block, output);
+        break;
+      case Format::BC4:
+        encodeChannel(block, 0, output);
+        break;
+      case Format::BC5:
+        encodeChannel(block, 0, output);
+        encodeChannel(block, 1, output);
+        break;
+      case Format::RGBA8:
+        break;
+      }
+    }
+  }
+  return output;
+}
+
+// Size of a block of 4x4 texels, or of a texel for RGBA8
+std::uint32_t getBlockSize(Format format) {
+  switch (format) {
+  case Format::RGBA8:
+    return 4;
+  case Format::BC1:
+  case Format::BC4:
+    return 8;
+  case Format::BC3:
+  case Format::BC5:
+    return 16;
+  }
+  return 0;
+}
+
+std::uint32_t getVkFormat(Format format, bool sRGB) {
+  switch (format) {
+  case Format::RGBA8:
+    return sRGB ? 43 : 37; // VK_FORMAT_R8G8B8A8_SRGB / _UNORM
+  case Format::BC1:
+    return sRGB ? 132 : 131; // VK_FORMAT_BC1_RGB_SRGB_BLOCK / _UNORM_BLOCK
+  case Format::BC3:
+    return sRGB ? 138 : 137; // VK_FORMAT_BC3_SRGB_BLOCK / _UNORM_BLOCK
+  case Format::BC4:
+    return 139; // VK_FORMAT_BC4_UNORM_BLOCK
+  case Format::BC5:
+    return 141; // VK_FORMAT_BC5_UNORM_BLOCK
+  }
+  return 0;
+}
+
+// Basic data format descriptor (Khronos Data Format Specification 1.3)
+std::vector<std::uint8_t> makeDataFormatDescriptor(Format format, bool sRGB) {
+  struct Sample {
+    std::uint32_t bitOffset;
+    std::uint32_t bitLength;
+    std::uint32_t channel;
+    std::uint32_t upper;
+  };
+
+  constexpr std::uint32_t linearQualifier{0x10};
+  auto const alpha{15U | (sRGB ? linearQualifier : 0U)};
+
+  std::uint32_t colorModel{};
+  std::vector<Sample> samples;
+  switch (format) {
+  case Format::RGBA8:
+    colorModel = 1; // KHR_DF_MODEL_RGBSDA
+    samples = {{0, 8, 0, 255}, {8, 8, 1, 255}, {16, 8, 2, 255},
+               {24, 8, alpha, 255}};
+    break;
+  case Format::BC1:
+    colorModel = 128; // KHR_DF_MODEL_BC1A
+    samples = {{0, 64, 0, 0xFFFFFFFF}};
+    break;
+  case Format::BC3:
+    colorModel = 130; // KHR_DF_MODEL_BC3
+    samples = {{0, 64, alpha, 0xFFFFFFFF}, {64, 64, 0, 0xFFFFFFFF}};
+    break;
+  case Format::BC4:
+    colorModel = 131; // KHR_DF_MODEL_BC4
+    samples = {{0, 64, 0, 0xFFFFFFFF}};
+    break;
+  case Format::BC5:
+    colorModel = 132; // KHR_DF_MODEL_BC5
+    samples = {{0, 64, 0, 0xFFFFFFFF}, {64, 64, 1, 0xFFFFFFFF}};
+    break;
+  }
+  auto const compressed{format != Format::RGBA8};
+  constexpr std::uint32_t primariesBT709{1};
+  auto const transfer{sRGB ? 2U : 1U};
+  auto const descriptorBlockSize{
+      gsl::narrow<std::uint32_t>(24 + 16 * samples.size())};
+
+  std::vector<std::uint8_t> output;
+  append(output, 4 + descriptorBlockSize, 4); // dfdTotalSize
+  append(output, 0, 4);                       // vendorId, descriptorType
+  append(output, 2U | descriptorBlockSize << 16, 4);
+  append(output, colorModel | primariesBT709 << 8 | transfer << 16, 4);
+  append(output, compressed ? (3U | 3U << 8) : 0U, 4);
+  append(output, getBlockSize(format), 4); // bytesPlane0
+  append(output, 0, 4);
+  for (auto const &sample : samples) {
+    append(output,
+           sample.bitOffset | (sample.bitLength - 1) << 16 |
+               sample.channel << 24,
+           4);
+    append(output, 0, 4); // samplePosition
+    append(output, 0, 4); // sampleLower
+    append(output, sample.upper, 4);
+  }
+  return output;
+}
+
+std::vector<std::uint8_t> makeKeyValueData(bool flipY) {
+  std::vector<std::uint8_t> output;
+  // Keys are sorted
+  for (auto const &[key, value] :
+       std::array<std::pair<std::string_view, std::string_view>, 2>{
+           {{"KTXorientation", flipY ? "ru" : "rd"},
+            {"KTXwriter", "abcg-ktx2convert"}}}) {
+    append(output, key.size() + value.size() + 2, 4);
+    output.insert(output.end(), key.begin(), key.end());
+    output.push_back(0);
+    output.insert(output.end(), value.begin(), value.end());
+    output.push_back(0);
+    output.resize((output.size() + 3) & ~std::size_t{3});
+  }
+  return output;
+}
+
+void writeKTX2(std::string const &path, Image const &base,
+               std::vector<std::vector<std::uint8_t>> const &levels,
+               Format format, bool sRGB, bool flipY) {
+  constexpr std::array<std::uint8_t, 12> identifier{
+      0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A};
+  constexpr std::size_t headerSize{80};
+  constexpr std::size_t levelIndexEntrySize{24};
+
+  auto const dfd{makeDataFormatDescriptor(format, sRGB)};
+  auto const kvd{makeKeyValueData(flipY)};
+  auto const dfdOffset{headerSize + levels.size() * levelIndexEntrySize};
+  auto const kvdOffset{dfdOffset + dfd.size()};
+
+  // Levels are stored from the smallest to the largest, each aligned to the
+  // least common multiple of the block size and 4 (the block size itself)
+  std::size_t const alignment{getBlockSize(format)};
+  std::vector<std::size_t> offsets(levels.size());
+  auto offset{kvdOffset + kvd.size()};
+  for (auto level{levels.size()}; level-- > 0;) {
+    offset = (offset + alignment - 1) / alignment * alignment;
+    offsets.at(level) = offset;
+    offset += levels.at(level).size();
+  }
+
+  std::vector<std::uint8_t> output(identifier.begin(), identifier.end());
+  append(output, getVkFormat(format, sRGB), 4);
+  append(output, 1, 4); // typeSize
+  append(output, base.width, 4);
+  append(output, base.height, 4);
+  append(output, 0, 4); // pixelDepth
+  append(output, 0, 4); // layerCount
+  append(output, 1, 4); // faceCount
+  append(output, levels.size(), 4);
+  append(output, 0, 4); // supercompressionScheme
+  append(output, dfdOffset, 4);
+  append(output, dfd.size(), 4);
+  append(output, kvdOffset, 4);
+  append(output, kvd.size(), 4);
+  append(output, 0, 8); // sgdByteOffset
+  append(output, 0, 8); // sgdByteLength
+  for (auto const level : iter::range(levels.size())) {
+    append(output, offsets.at(level), 8);
+    append(output, levels.at(level).size(), 8);
+    append(output, levels.at(level).size(), 8);
+  }
+  output.insert(output.end(), dfd.begin(), dfd.end());
+  output.insert(output.end(), kvd.begin(), kvd.end());
+  for (auto level{levels.size()}; level-- > 0;) {
+    output.resize(offsets.at(level));
+    output.insert(output.end(), levels.at(level).begin(),
+                  levels.at(level).end());
+  }
+
+  std::ofstream stream{path, std::ios::binary};
+  if (!stream.write(reinterpret_cast<char const *>(output.data()),
+                    gsl::narrow<std::streamsize>(output.size()))) {
+    throw abcg::RuntimeError(fmt::format("Failed to write {}", path));
+  }
+}
+
+Image loadImage(std::string const &path, bool flipY) {
+  auto *const surface{IMG_Load(path.c_str())};
+  if (surface == nullptr) {
+    throw abcg::RuntimeError(fmt::format("Failed to load {}", path));
+  }
+  auto *const formattedSurface{
+      SDL_ConvertSurfaceFormat(surface, SDL_PIXELFORMAT_RGBA32, 0)};
+  SDL_FreeSurface(surface);
+  if (formattedSurface == nullptr) {
+    throw abcg::RuntimeError(fmt::format("Failed to convert {}", path));
+  }
+  if (flipY) {
+    abcg::flipVertically(*formattedSurface);
+  }
+
+  auto const width{gsl::narrow<std::uint32_t>(formattedSurface->w)};
+  auto const height{gsl::narrow<std::uint32_t>(formattedSurface->h)};
+  auto const rowSize{std::size_t{width} * 4};
+  Image image{.width = width,
+              .height = height,
+              .texels = std::vector<std::uint8_t>(rowSize * height)};
+  auto const *const pixels{
+      static_cast<std::uint8_t const *>(formattedSurface->pixels)};
+  auto const pitch{gsl::narrow<std::size_t>(formattedSurface->pitch)};
+  for (auto const row : iter::range(std::size_t{height})) {
+    std::memcpy(image.texels.data() + row * rowSize, pixels + row * pitch,
+                rowSize);
+  }
+  SDL_FreeSurface(formattedSurface);
+  return image;
+}
+
+Options parseOptions(std::span<char *> args) {
+  Options options;
+  std::vector<std::string> paths;
+  for (std::size_t index = 1; index < args.size(); ++index) {
+    std::string_view const arg{args[index]};
+    if (arg == "--format" && index + 1 < args.size()) {
+      std::string_view const name{args[++index]};
+      if (name == "rgba8") {
+        options.format = Format::RGBA8;
+      } else if (name == "bc1") {
+        options.format = Format::BC1;
+      } else if (name == "bc3") {
+        options.format = Format::BC3;
+      } else if (name == "bc4") {
+        options.format = Format::BC4;
+      } else if (name == "bc5") {
+        options.format = Format::BC5;
+      } else {
+        throw abcg::RuntimeError(fmt::format("Unknown format {}", name));
+      }
+    } else if (arg == "--linear") {
+      options.sRGB = false;
+    } else if (arg == "--no-mipmaps") {
+      options.mipmaps = false;
+    } else if (arg == "--flip-y") {
+      options.flipY = true;
+    } else if (arg.starts_with("--")) {
+      throw abcg::RuntimeError(fmt::format("Unknown option {}", arg));
+    } else {
+      paths.emplace_back(arg);
+    }
+  }
+
+  if (paths.size() != 2) {
+    throw abcg::RuntimeError(
+        "Usage: abcg-ktx2convert [--format rgba8|bc1|bc3|bc4|bc5] [--linear] "
+        "[--no-mipmaps] [--flip-y] input output.ktx2");
+  }
+  options.input = paths.at(0);
+  options.output = paths.at(1);
+  return options;
+}
+} // namespace
+
+int main(int argc, char **argv) {
+  try {
+    auto options{parseOptions({argv, static_cast<std::size_t>(argc)})};
+
+    if (IMG_Init(IMG_INIT_JPG | IMG_INIT_PNG) == 0) {
+      throw abcg::RuntimeError("Failed to initialize SDL_image");
+    }
+    auto const quit{gsl::finally([] { IMG_Quit(); })};
+
+    auto const decodeStart{std::chrono::steady_clock::now()};
+    auto image{loadImage(options.input, options.flipY)};
+    std::chrono::duration<double, std::milli> const decodeTime{
+        std::chrono::steady_clock::now() - decodeStart};
+
+    if (!options.format.has_value()) {
+      auto opaque{true};
+      for (std::size_t index{3}; index < image.texels.size(); index += 4) {
+        opaque = opaque && image.texels.at(index) == 255;
+      }
+      options.format = opaque ? Format::BC1 : Format::BC3;
+    }
+    auto const format{*options.format};
+    auto const sRGB{options.sRGB && format != Format::BC4 &&
+                    format != Format::BC5};
+
+    std::vector<std::vector<std::uint8_t>> levels;
+    std::size_t uncompressedSize{};
+    auto const base{image};
+    while (true) {
+      uncompressedSize += image.texels.size();
+      levels.push_back(encode(image, format));
+      if (!options.mipmaps || (image.width == 1 && image.height == 1))
+        break;
+      image = downsample(image, sRGB);
+    }
+
+    writeKTX2(options.output, base, levels, format, sRGB, options.flipY);
+
+    // Compare with the cost of loading the source image
+    auto const loadStart{std::chrono::steady_clock::now()};
+    abcg::KTX2Texture texture;
+    texture.open(options.output);
+    texture.prefetch();
+    std::chrono::duration<double, std::milli> const loadTime{
+        std::chrono::steady_clock::now() - loadStart};
+
+    auto const toMiB{[](std::size_t size) {
+      return static_cast<double>(size) / (1024.0 * 1024.0);
+    }};
+    fmt::print("{} -> {}: {}x{}, {} levels\n", options.input, options.output,
+               base.width, base.height, levels.size());
+    fmt::print("  GPU memory: {:.2f} MiB (RGBA8 with the same levels: "
+               "{:.2f} MiB)\n",
+               toMiB(texture.getByteSize()), toMiB(uncompressedSize));
+    fmt::print("  CPU load time: {:.2f} ms (decoding the source image: "
+               "{:.2f} ms)\n",
+               loadTime.count(), decodeTime.count());
+  } catch (std::exception const &e) {
+    fmt::print(stderr, "{}\n", e.what());
+    return -1;
+  }
+  return 0;
+}
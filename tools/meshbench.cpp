@@ -0,0 +1,215 @@
+// meshbench.cpp
+//
+// Load-time benchmark of abcg::Mesh. Times loading a Wavefront OBJ file with
+// tiny_obj_loader (including vertex deduplication) against loading the
+// binary mesh file written from it. If no OBJ file is given, a tessellated
+// sphere with about two million triangles is generated in the temporary
+// directory.
+//
+// Also reports the time taken by abcg::Mesh::optimize and the ACMR/ATVR of a
+// 16-entry FIFO vertex cache before and after it. The program fails if the
+// optimized index buffer is not a permutation of the original triangles.
+//
+// The binary file is read right after being written, so the numbers are for
+// a warm page cache. "Load + read" also reads every vertex and index, as an
+// upload to the GPU would.
+//
+// Usage: abcg-meshbench [--repeat N] [file.obj]
+#include <algorithm>
+#include <array>
+#include <filesystem>
+#include <fstream>
+#include <numbers>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <cppitertools/itertools.hpp>
+#include <gsl/gsl>
+
+#include "abcgException.hpp"
+#include "abcgExternal.hpp"
+#include "abcgMesh.hpp"
+#include "abcgMeshOptimizer.hpp"
+#include "bench.hpp"
+
+namespace {
+// Writes a UV sphere with `stacks` x `slices` quads, with normals and texture
+// coordinates
+void writeSphere(std::filesystem::path const &path, int stacks, int slices) {
+  std::ofstream stream(path);
+  if (!stream) {
+    throw abcg::RuntimeError(
+        fmt::format("Failed to write {}", path.string()));
+  }
+
+  for (auto const stack : iter::range(stacks + 1)) {
+    auto const v{static_cast<float>(stack) / static_cast<float>(stacks)};
+    auto const theta{v * std::numbers::pi_v<float>};
+    for (auto const slice : iter::range(slices + 1)) {
+      auto const u{static_cast<float>(slice) / static_cast<float>(slices)};
+      auto const phi{u * 2.0f * std::numbers::pi_v<float>};
+      glm::vec3 const position{std::sin(theta) * std::cos(phi),
+                               std::cos(theta),
+                               std::sin(theta) * std::sin(phi)};
+      stream << fmt::format("v {} {} {}\nvn {} {} {}\nvt {} {}\n",
+                            position.x, position.y, position.z, position.x,
+                            position.y, position.z, u, 1.0f - v);
+    }
+  }
+
+  // OBJ indices are 1-based
+  auto const index{[&](int stack, int slice) {
+    return stack * (slices + 1) + slice + 1;
+  }};
+  for (auto const stack : iter::range(stacks)) {
+    for (auto const slice : iter::range(slices)) {
+      auto const a{index(stack, slice)};
+      auto const b{index(stack + 1, slice)};
+      auto const c{index(stack + 1, slice + 1)};
+      auto const d{index(stack, slice + 1)};
+      stream << fmt::format("f {0}/{0}/{0} {1}/{1}/{1} {2}/{2}/{2}\n"
+                            "f {0}/{0}/{0} {2}/{2}/{2} {3}/{3}/{3}\n",
+                            a, b, c, d);
+    }
+  }
+}
+
+// Reads every byte of the buffers, as an upload would
+[[nodiscard]] std::size_t readBuffers(abcg::Mesh const &mesh) {
+  std::size_t sum{};
+  for (auto const byte : std::as_bytes(mesh.getVertices())) {
+    sum += std::to_integer<std::size_t>(byte);
+  }
+  for (auto const byte : mesh.getIndexData()) {
+    sum += std::to_integer<std::size_t>(byte);
+  }
+  return sum;
+}
+
+[[nodiscard]] abcg::VertexCacheStatistics analyze(abcg::Mesh const &mesh) {
+  std::vector<std::uint32_t> indices(mesh.getIndexCount());
+  for (auto const position : iter::range(indices.size())) {
+    indices[position] = mesh.getIndex(position);
+  }
+  return abcg::analyzeVertexCache(indices, mesh.getVertices().size());
+}
+
+// Returns the triangles of the index buffer in lexicographic order
+[[nodiscard]] std::vector<std::array<std::uint32_t, 3>>
+sortedTriangles(std::span<std::uint32_t const> indices) {
+  std::vector<std::array<std::uint32_t, 3>> triangles(indices.size() / 3);
+  for (auto const triangle : iter::range(triangles.size())) {
+    std::ranges::copy(indices.subspan(triangle * 3, 3),
+                      triangles[triangle].begin());
+  }
+  std::ranges::sort(triangles);
+  return triangles;
+}
+
+// Throws if abcg::optimizeVertexCache followed by abcg::optimizeOverdraw does
+// not return a permutation of the triangles of the index buffer
+void checkPermutation(std::vector<std::uint32_t> indices,
+                      std::span<glm::vec3 const> positions) {
+  auto const expected{sortedTriangles(indices)};
+  abcg::optimizeVertexCache(indices, positions.size());
+  abcg::optimizeOverdraw(indices, positions);
+  if (sortedTriangles(indices) != expected) {
+    throw abcg::RuntimeError(
+        "The optimized index buffer is not a permutation of the triangles");
+  }
+}
+
+// Checks the optimizers on a degenerate triangle followed by a strip, and on
+// the triangles of the mesh
+void checkOptimizers(abcg::Mesh const &mesh) {
+  std::vector<glm::vec3> const stripPositions{
+      {0.0f, 0.0f, 0.0f}, {1.0f, 0.0f, 0.0f}, {0.0f, 1.0f, 0.0f},
+      {1.0f, 1.0f, 0.0f}, {0.0f, 2.0f, 0.0f}, {1.0f, 2.0f, 1.0f}};
+  checkPermutation({0, 0, 1, 2, 3, 4, 2, 4, 5}, stripPositions);
+
+  std::vector<std::uint32_t> indices(mesh.getIndexCount());
+  for (auto const position : iter::range(indices.size())) {
+    indices[position] = mesh.getIndex(position);
+  }
+  std::vector<glm::vec3> positions;
+  positions.reserve(mesh.getVertices().size());
+  for (auto const &vertex : mesh.getVertices()) {
+    positions.push_back(vertex.position);
+  }
+  checkPermutation(std::move(indices), positions);
+}
+} // namespace
+
+int main(int argc, char **argv) {
+  try {
+    std::size_t repeat{5};
+    std::filesystem::path objPath;
+    bench::parseOptions(argc, argv, repeat,
+                        [&](std::string_view name, std::string const &value) {
+                          if (!name.empty() || !objPath.empty()) {
+                            return false;
+                          }
+                          objPath = value;
+                          return true;
+                        });
+
+    auto const temporaryPath{std::filesystem::temp_directory_path()};
+    if (objPath.empty()) {
+      objPath = temporaryPath / "abcg-meshbench.obj";
+      writeSphere(objPath, 1000, 1000);
+    }
+    auto const cachePath{temporaryPath / "abcg-meshbench.mesh"};
+
+    abcg::Mesh mesh;
+    auto const objTime{
+        bench::measure(repeat, [&] { mesh.loadOBJ(objPath.string()); })};
+    checkOptimizers(mesh);
+    auto const before{analyze(mesh)};
+    auto const optimizeTime{bench::measure(1, [&] { mesh.optimize(); })};
+    auto const after{analyze(mesh)};
+    mesh.save(cachePath.string());
+    auto const reference{readBuffers(mesh)};
+
+    fmt::print("{}: {} triangles, {} vertices, {}-bit indices\n",
+               objPath.string(), mesh.getIndexCount() / 3,
+               mesh.getVertices().size(), mesh.getIndexSize() * 8);
+    fmt::print("  OBJ file.....: {:>9.2f} MiB\n",
+               static_cast<double>(std::filesystem::file_size(objPath)) /
+                   (1024.0 * 1024.0));
+    fmt::print("  Binary file..: {:>9.2f} MiB\n",
+               static_cast<double>(std::filesystem::file_size(cachePath)) /
+                   (1024.0 * 1024.0));
+
+    std::size_t sum{};
+    auto const loadTime{
+        bench::measure(repeat, [&] { mesh.load(cachePath.string()); })};
+    auto const readTime{bench::measure(repeat, [&] {
+      mesh.load(cachePath.string());
+      sum = readBuffers(mesh);
+    })};
+    if (sum != reference) {
+      throw abcg::RuntimeError("The binary mesh differs from the OBJ mesh");
+    }
+
+    fmt::print("  ACMR.........: {:>9.3f} -> {:.3f}\n", before.acmr,
+               after.acmr);
+    fmt::print("  ATVR.........: {:>9.3f} -> {:.3f}\n", before.atvr,
+               after.atvr);
+    fmt::print("  Optimize.....: {:>9.2f} ms\n", optimizeTime);
+    fmt::print("  OBJ load.....: {:>9.2f} ms\n", objTime);
+    fmt::print("  Binary load..: {:>9.2f} ms ({:.0f}x faster)\n", loadTime,
+               objTime / loadTime);
+    fmt::print("  Load + read..: {:>9.2f} ms ({:.0f}x faster)\n", readTime,
+               objTime / readTime);
+
+    mesh.clear();
+    std::filesystem::remove(cachePath);
+  } catch (std::exception const &e) {
+    fmt::print("Exception: {}\n", e.what());
+    return -1;
+  }
+  return 0;
+}
@@ -0,0 +1,171 @@
+// vkshaderbench.cpp
+//
+// Load-time benchmark of abcg::createVulkanShaders and the SPIR-V cache.
+// Builds a set of vertex and fragment shader variants in three ways:
+//
+// - Uncached: the SPIR-V cache is disabled, so every shader is compiled with
+//   glslang.
+// - Cold: the cache directory is cleared first, so every shader is compiled
+//   and its SPIR-V written to the cache.
+// - Warm: the same shaders are loaded from the cache.
+//
+// The first call, which also initializes glslang, is reported separately.
+//
+// Usage: abcg-vkshaderbench [--repeat N] [--variants N]
+#include <algorithm>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "abcg.hpp"
+#include "abcgVulkan.hpp"
+#include "bench.hpp"
+
+namespace {
+constexpr std::string_view vertexShader{R"glsl(
+layout(location = 0) in vec3 inPosition;
+layout(location = 1) in vec3 inNormal;
+
+layout(set = 0, binding = 0) uniform CameraBlock {
+  mat4 viewMatrix;
+  mat4 projMatrix;
+};
+
+layout(push_constant) uniform PushConstants {
+  mat4 modelMatrix;
+  vec4 color;
+};
+
+layout(location = 0) out vec3 fragPosition;
+layout(location = 1) out vec3 fragNormal;
+
+void main() {
+  vec4 position = viewMatrix * modelMatrix * vec4(inPosition * scale, 1.0);
+  fragPosition = position.xyz;
+  fragNormal = normalize(mat3(viewMatrix * modelMatrix) * inNormal);
+  gl_Position = projMatrix * position;
+}
+)glsl"};
+
+constexpr std::string_view fragmentShader{R"glsl(
+layout(location = 0) in vec3 fragPosition;
+layout(location = 1) in vec3 fragNormal;
+
+layout(push_constant) uniform PushConstants {
+  mat4 modelMatrix;
+  vec4 color;
+};
+
+layout(location = 0) out vec4 outColor;
+
+void main() {
+  vec3 N = normalize(fragNormal);
+  vec3 L = normalize(vec3(1.0, 1.0, 1.0));
+  vec3 V = normalize(-fragPosition);
+  vec3 H = normalize(L + V);
+  float lambertian = max(dot(N, L), 0.0);
+  float specular = lambertian > 0.0 ? pow(max(dot(H, N), 0.0), 32.0) : 0.0;
+  outColor = vec4(color.rgb * (0.1 + lambertian) + specular * scale, 1.0);
+}
+)glsl"};
+
+// Returns `count` vertex and `count` fragment shaders that differ only in a
+// constant, so that each one has its own cache entry
+[[nodiscard]] std::vector<abcg::ShaderSource> makeVariants(std::size_t count) {
+  std::vector<abcg::ShaderSource> sources;
+  sources.reserve(2 * count);
+  for (auto const index : iter::range(count)) {
+    auto const header{
+        fmt::format("#version 450\nconst float scale = {:.1f};\n",
+                    1.0 + 0.1 * static_cast<double>(index))};
+    sources.push_back({.source = header + std::string{vertexShader},
+                       .stage = abcg::ShaderStage::Vertex});
+    sources.push_back({.source = header + std::string{fragmentShader},
+                       .stage = abcg::ShaderStage::Fragment});
+  }
+  return sources;
+}
+
+class BenchWindow : public abcg::VulkanWindow {
+public:
+  BenchWindow(std::size_t repeat, std::size_t variants)
+      : m_repeat{repeat}, m_variants{variants} {}
+
+protected:
+  void onCreate() override {
+    auto const cachePath{std::filesystem::temp_directory_path() /
+                         "abcg-vkshaderbench"};
+    std::filesystem::remove_all(cachePath);
+
+    auto const sources{makeVariants(m_variants)};
+    auto const build{[&] {
+      for (auto &shader : abcg::createVulkanShaders(getDevice(), sources)) {
+        shader.destroy();
+      }
+    }};
+
+    abcg::setVulkanShaderCachePath({});
+    auto const firstTime{bench::measure(1, build)};
+    auto const uncachedTime{bench::measure(m_repeat, build)};
+
+    abcg::setVulkanShaderCachePath(cachePath.string());
+    auto const coldTime{bench::measure(m_repeat, [&] {
+      std::filesystem::remove_all(cachePath);
+      build();
+    })};
+    auto const warmTime{bench::measure(m_repeat, build)};
+
+    abcg::setVulkanShaderCachePath({});
+    std::filesystem::remove_all(cachePath);
+
+    fmt::print("{} shaders, {} hardware threads\n", sources.size(),
+               std::thread::hardware_concurrency());
+    fmt::print("  First call...: {:>9.2f} ms (includes glslang init)\n",
+               firstTime);
+    fmt::print("  Uncached.....: {:>9.2f} ms\n", uncachedTime);
+    fmt::print("  Cold cache...: {:>9.2f} ms\n", coldTime);
+    fmt::print("  Warm cache...: {:>9.2f} ms ({:.0f}x faster)\n", warmTime,
+               uncachedTime / warmTime);
+
+    SDL_Event quit{};
+    quit.type = SDL_QUIT;
+    SDL_PushEvent(&quit);
+  }
+
+private:
+  std::size_t m_repeat{};
+  std::size_t m_variants{};
+};
+} // namespace
+
+int main(int argc, char **argv) {
+  try {
+    abcg::Application app(argc, argv);
+
+    std::size_t repeat{5};
+    std::size_t variants{32};
+    bench::parseOptions(argc, argv, repeat,
+                        [&](std::string_view name, std::string const &value) {
+                          if (name != "variants") {
+                            return false;
+                          }
+                          variants =
+                              std::max<std::size_t>(std::stoul(value), 1);
+                          return true;
+                        });
+
+    BenchWindow window{repeat, variants};
+    window.setWindowSettings({.width = 320,
+                              .height = 240,
+                              .showFPS = false,
+                              .showFullscreenButton = false,
+                              .title = "abcg-vkshaderbench"});
+    app.run(window);
+  } catch (std::exception const &e) {
+    fmt::print("Exception: {}\n", e.what());
+    return -1;
+  }
+  return 0;
+}